@@ -0,0 +1,186 @@
+/**
+ * @file batch_queue.h
+ * @author Melissa Ip
+ *
+ * The BatchQueue class template is a bounded lock-free queue with any number of
+ * producer and consumer threads. It connects the stages of the pileup pipeline
+ * (see pileup_pipeline.h), which pass pointers to batches of sites, so the
+ * queue only holds small values and the batches themselves are never copied.
+ *
+ * The queue is a ring of cells that each carry a sequence number (Vyukov's
+ * bounded MPMC queue). A producer claims the next push position with a
+ * compare-and-swap and publishes its value by advancing the sequence number of
+ * the cell, and a consumer does the same on the pop position, so neither
+ * takes a lock. Push() and Pop() yield the thread while the queue is full or
+ * empty.
+ *
+ * The queue is created with the number of producers. Each producer calls
+ * Done() when it has pushed all of its values, and Pop() returns false once
+ * every producer is done and the queue is empty.
+ *
+ * Example usage:
+ *
+ *   BatchQueue<SiteBatch *> queue(64, 1);  // Capacity, producers.
+ *   queue.Push(batch);                     // Producer thread.
+ *   queue.Done();
+ *   SiteBatch *batch = nullptr;
+ *   while (queue.Pop(batch)) {             // Consumer threads.
+ *     ...
+ *   }
+ *
+ * The template is defined in this header because T can be any type.
+ */
+#ifndef BATCH_QUEUE_H
+#define BATCH_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+
+/**
+ * BatchQueue class template header. See top of file for a complete
+ * description.
+ */
+template <typename T>
+class BatchQueue {
+ public:
+  BatchQueue(int capacity, int producers);  // Capacity is rounded up to a power of 2.
+  bool TryPush(const T &value);  // False if the queue is full.
+  bool TryPop(T &value);  // False if the queue is empty.
+  void Push(const T &value);  // Waits while the queue is full.
+  bool Pop(T &value);  // Waits while the queue is empty. False once done.
+  void Done();  // Called by each producer after its last push.
+
+ private:
+  struct Cell {
+    atomic<size_t> sequence;
+    T value;
+  };
+
+  BatchQueue(const BatchQueue &other);  // Not copyable.
+  BatchQueue& operator=(const BatchQueue &other);
+
+  // Instance member variables.
+  size_t mask_;  // Capacity - 1.
+  unique_ptr<Cell[]> cells_;
+  alignas(64) atomic<size_t> push_position_;  // Separate cache lines for
+  alignas(64) atomic<size_t> pop_position_;   // producers and consumers.
+  alignas(64) atomic<int> producers_;  // Producers that are not done.
+};
+
+/**
+ * Constructor that numbers the cells of an empty queue.
+ *
+ * @param  capacity  Minimum number of values the queue holds.
+ * @param  producers Number of producers that will call Done().
+ */
+template <typename T>
+BatchQueue<T>::BatchQueue(int capacity, int producers)
+    : push_position_{0}, pop_position_{0}, producers_{producers} {
+  size_t size = 2;
+  while (size < (size_t) capacity) {
+    size *= 2;
+  }
+  mask_ = size - 1;
+  cells_.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i) {
+    cells_[i].sequence.store(i, memory_order_relaxed);
+  }
+}
+
+/**
+ * Pushes a value if the queue is not full.
+ *
+ * @param  value Value to be pushed.
+ * @return       False if the queue is full.
+ */
+template <typename T>
+bool BatchQueue<T>::TryPush(const T &value) {
+  size_t position = push_position_.load(memory_order_relaxed);
+  while (true) {
+    Cell &cell = cells_[position & mask_];
+    size_t sequence = cell.sequence.load(memory_order_acquire);
+    if (sequence == position) {
+      if (push_position_.compare_exchange_weak(position, position + 1,
+                                               memory_order_relaxed)) {
+        cell.value = value;
+        cell.sequence.store(position + 1, memory_order_release);
+        return true;
+      }
+    } else if (sequence < position) {
+      return false;  // The cell has not been popped since the last lap.
+    } else {
+      position = push_position_.load(memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * Pops the oldest value if the queue is not empty.
+ *
+ * @param  value Popped value.
+ * @return       False if the queue is empty.
+ */
+template <typename T>
+bool BatchQueue<T>::TryPop(T &value) {
+  size_t position = pop_position_.load(memory_order_relaxed);
+  while (true) {
+    Cell &cell = cells_[position & mask_];
+    size_t sequence = cell.sequence.load(memory_order_acquire);
+    if (sequence == position + 1) {
+      if (pop_position_.compare_exchange_weak(position, position + 1,
+                                              memory_order_relaxed)) {
+        value = cell.value;
+        cell.sequence.store(position + mask_ + 1, memory_order_release);
+        return true;
+      }
+    } else if (sequence < position + 1) {
+      return false;  // The cell has not been pushed yet.
+    } else {
+      position = pop_position_.load(memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * Pushes a value and yields the thread while the queue is full.
+ *
+ * @param  value Value to be pushed.
+ */
+template <typename T>
+void BatchQueue<T>::Push(const T &value) {
+  while (!BatchQueue::TryPush(value)) {
+    this_thread::yield();
+  }
+}
+
+/**
+ * Pops the oldest value and yields the thread while the queue is empty.
+ *
+ * @param  value Popped value.
+ * @return       False if every producer is done and the queue is empty.
+ */
+template <typename T>
+bool BatchQueue<T>::Pop(T &value) {
+  while (!BatchQueue::TryPop(value)) {
+    if (producers_.load() == 0) {
+      return BatchQueue::TryPop(value);  // Catches a push before the last Done().
+    }
+    this_thread::yield();
+  }
+  return true;
+}
+
+/**
+ * Marks one producer as done. Pop() returns false once all producers are done
+ * and the queue is empty.
+ */
+template <typename T>
+void BatchQueue<T>::Done() {
+  producers_.fetch_sub(1);
+}
+
+#endif
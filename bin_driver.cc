@@ -52,25 +52,29 @@
  * of 1.00 (100%) will go in the highest bin possible, bin 9.
  *
  * To compile on Herschel:
- * c++ -std=c++11 -L/usr/local/lib -I/usr/local/include -o bin_driver utility.cc bin_driver.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o bin_driver utility.cc gzip_reader.cc uring_reader.cc line_reader.cc bin_driver.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./bin_driver <input>.txt
+ * ./bin_driver <input>.txt [options]
+ *
+ * Options:
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
  */
 #include <fstream>
-#include <sstream>
 
-#include "utility.h"
+#include "line_reader.h"
 
 const int kNumBins = 10;  // 10 bins cover 0-100% with 10% intervals.
 
 /**
  * See case 1.
  *
- * @param  fin  File input stream.
+ * @param  reader Input file reader.
  */
-void CountBin(ifstream &fin) {
-  string line;
+void CountBin(LineReader &reader) {
+  StringView line;
   int bin = 0;
   int has_mutation = 0;
   int counts[kNumBins] = {0};
@@ -78,18 +82,16 @@ void CountBin(ifstream &fin) {
   double probability = 0.0;
   double has_mutation_percent = 0.0;
 
-  while (getline(fin, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> probability;
-    str >> has_mutation;
+  while (reader.NextLine(line)) {
+    char *field_end = nullptr;
+    probability = strtod(line.data, &field_end);
+    has_mutation = strtol(field_end, &field_end, 10);
     bin = (int) fmin(floor(probability * kNumBins), kNumBins - 1);
     totals[bin]++;
     if (has_mutation == 1) {
       counts[bin]++;
     }
   }
-  fin.close();
 
   for (int i = 0; i < kNumBins; ++i) {
     if (totals[i] > 0) {
@@ -105,10 +107,10 @@ void CountBin(ifstream &fin) {
 /**
  * See case 2.
  *
- * @param  fin  File input stream.
+ * @param  reader Input file reader.
  */
-void CountBinTrio(ifstream &fin) {
-  string line;
+void CountBinTrio(LineReader &reader) {
+  StringView line;
   int bin = 0;
   int total = 0;
   int probability_count = 0;  // Number of sites above the probability cut.
@@ -116,10 +118,8 @@ void CountBinTrio(ifstream &fin) {
   double probability;
   double probability_cut = 0.1;
 
-  while (getline(fin, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> probability;
+  while (reader.NextLine(line)) {
+    probability = strtod(line.data, nullptr);
     bin = (int) fmin(floor(probability * kNumBins), kNumBins - 1);
     total++;
 
@@ -133,7 +133,6 @@ void CountBinTrio(ifstream &fin) {
       counts[bin]++;
     }
   }
-  fin.close();
   
   double percent = (double) probability_count / total * 100;
   printf("%.2f%% or %d/%d sites have a probability greater than %.2f.\n",
@@ -153,28 +152,26 @@ void CountBinTrio(ifstream &fin) {
 /**
  * See case 3.
  *
- * @param  fin  File input stream.
+ * @param  reader Input file reader.
  */
-void CountProbability(ifstream &fin) {
+void CountProbability(LineReader &reader) {
     string output_name;
     cout << "Provide an output file name: ";
     getline(cin, output_name);
     ofstream fout(output_name);
 
-    string line;
-    int index = 0;  // Unused placeholder.
+    StringView line;
     int total_trios = 0;
     int has_mutation_total = 0;
     int has_no_mutation_total = 0;
     double probability = 0.0;
     vector<double> probabilities;
  
-    while (getline(fin, line)) {
-      line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-      stringstream str(line);
-      str >> index;
-      str >> has_mutation_total;
-      str >> has_no_mutation_total;
+    while (reader.NextLine(line)) {
+      char *field_end = nullptr;
+      strtol(line.data, &field_end, 10);  // Skips the index.
+      has_mutation_total = strtol(field_end, &field_end, 10);
+      has_no_mutation_total = strtol(field_end, &field_end, 10);
       total_trios = has_mutation_total + has_no_mutation_total;
       if (total_trios == 0) {
         probability = 0.0;
@@ -183,7 +180,6 @@ void CountProbability(ifstream &fin) {
       }
       probabilities.push_back(probability);
     }
-    fin.close();
 
     ostream_iterator<double> output_iter(fout, "\n");
     copy(probabilities.begin(), probabilities.end(), output_iter);
@@ -193,15 +189,15 @@ void CountProbability(ifstream &fin) {
 /**
  * See case 4.
  *
- * @param  fin  File input stream.
+ * @param  reader Input file reader.
  */
-void CountProbabilityIndex(ifstream &fin) {
+void CountProbabilityIndex(LineReader &reader) {
   string output_name;
   cout << "Provide an output file name: ";
   getline(cin, output_name);
   ofstream fout(output_name);
 
-  string line;
+  StringView line;
   int index = 0;
   int total_trios = 0;
   int has_mutation_total = 0;
@@ -211,17 +207,15 @@ void CountProbabilityIndex(ifstream &fin) {
   double probability = 0.0;
   vector<double> probabilities;
 
-  while (getline(fin, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> index;
-    str >> has_mutation_total;
-    str >> has_no_mutation_total;
+  while (reader.NextLine(line)) {
+    char *field_end = nullptr;
+    index = strtol(line.data, &field_end, 10);
+    has_mutation_total = strtol(field_end, &field_end, 10);
+    has_no_mutation_total = strtol(field_end, &field_end, 10);
     total_trios = has_mutation_total + has_no_mutation_total;
     has_mutation_totals[index] += has_mutation_total;
     trio_totals[index] += total_trios;
   }
-  fin.close();
 
   for (int i = 0; i < kTrioCount; ++i) {
     if (has_mutation_totals[i] == 0) {
@@ -240,33 +234,42 @@ void CountProbabilityIndex(ifstream &fin) {
 
 int main(int argc, const char *argv[]) {
   if (argc < 2) {        
-    Die("USAGE: bin_driver <input>.txt");
+    Die("USAGE: bin_driver <input>.txt [--io-backend <mmap|pread|io_uring>]");
   }
 
   const string file_name = argv[1];
+  ReadOptions read_options;
+  for (int i = 2; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
   char case_num = '0';  // Initially not a valid case number.
   cout << "Provide a case number: ";
   cin.get(case_num);
   cin.ignore(20, '\n');  // Flush buffer.
   cout << endl;
 
-  ifstream fin(file_name);
-  if (!fin.is_open() || 0 != fin.fail()) {
+  LineReader reader(file_name, read_options);
+  if (!reader.is_open()) {
     Die("Input file cannot be read.");
   }
   
   switch (case_num) {
   case '1':
-    CountBin(fin);
+    CountBin(reader);
     break;
   case '2':
-    CountBinTrio(fin);
+    CountBinTrio(reader);
     break;
   case '3':
-    CountProbability(fin);
+    CountProbability(reader);
     break;
   case '4':
-    CountProbabilityIndex(fin);
+    CountProbabilityIndex(reader);
     break;
   }
 
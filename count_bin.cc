@@ -20,27 +20,38 @@
  * of 1.00 (100%) will go in the highest bin possible, bin 9.
  *
  * To compile on Herschel:
- * c++ -std=c++11 -L/usr/local/lib -I/usr/local/include -o count_bin utility.cc count_bin.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o count_bin utility.cc gzip_reader.cc uring_reader.cc line_reader.cc count_bin.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./count_bin <input>.txt
+ * ./count_bin <input>.txt [options]
+ *
+ * Options:
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
  */
-#include <fstream>
-#include <sstream>
-
-#include "utility.h"
+#include "line_reader.h"
 
 const int kNumBins = 10;  // 10 bins cover 0-100% with 10% intervals.
 
 
 int main(int argc, const char *argv[]) {
   if (argc < 2) {        
-    Die("USAGE: count_bin <input>.txt");
+    Die("USAGE: count_bin <input>.txt [--io-backend <mmap|pread|io_uring>]");
   }
 
   const string file_name = argv[1];
-  ifstream f(file_name);
-  if (!f.is_open() || 0 != f.fail()) {
+  ReadOptions read_options;
+  for (int i = 2; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
+  LineReader reader(file_name, read_options);
+  if (!reader.is_open()) {
     Die("Input file cannot be read.");
   }
 
@@ -49,20 +60,18 @@ int main(int argc, const char *argv[]) {
   double probability = 0.0;
   int has_mutation = 0;
   int bin = 0;
-  string line;
+  StringView line;
 
-  while (getline(f, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> probability;
-    str >> has_mutation;
+  while (reader.NextLine(line)) {
+    char *field_end = nullptr;
+    probability = strtod(line.data, &field_end);
+    has_mutation = strtol(field_end, &field_end, 10);
     bin = (int) fmin(floor(probability * kNumBins), kNumBins - 1);
     totals[bin]++;
     if (has_mutation == 1) {
       counts[bin]++;
     }
   }
-  f.close();
 
   for (int i = 0; i < kNumBins; i++) {
     if (totals[i] > 0) {
@@ -19,31 +19,43 @@
  * -1 bin.
  *
  * To compile on Herschel:
- * c++ -std=c++11 -L/usr/local/lib -I/usr/local/include -o count_bin_trio utility.cc count_bin_trio.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o count_bin_trio utility.cc gzip_reader.cc uring_reader.cc line_reader.cc count_bin_trio.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./count_bin_trio <input>.txt
+ * ./count_bin_trio <input>.txt [options]
+ *
+ * Options:
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
  */
-#include <fstream>
-#include <sstream>
-
-#include "utility.h"
+#include "line_reader.h"
 
 const int kNumBins = 10;  // 10 bins cover 0-100% with 10% intervals.
 
 
 int main(int argc, const char *argv[]) {
   if (argc < 2) {        
-    Die("USAGE: count_bin_trio <input>.txt");
+    Die("USAGE: count_bin_trio <input>.txt "
+        "[--io-backend <mmap|pread|io_uring>]");
   }
 
   const string file_name = argv[1];
-  ifstream f(file_name);
-  if (!f.is_open() || 0 != f.fail()) {
+  ReadOptions read_options;
+  for (int i = 2; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
+  LineReader reader(file_name, read_options);
+  if (!reader.is_open()) {
     Die("Input file cannot be read.");
   }
 
-  string line;
+  StringView line;
   int bin = 0;
   int neg_bin = 0;
   int total = 0;
@@ -52,10 +64,8 @@ int main(int argc, const char *argv[]) {
   double probability_cut = 0.1;
   double probability = 0.0;
 
-  while (getline(f, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> probability;
+  while (reader.NextLine(line)) {
+    probability = strtod(line.data, nullptr);
     bin = (int) fmin(floor(probability * kNumBins), kNumBins - 1);
 
     if (probability > probability_cut) {
@@ -69,7 +79,6 @@ int main(int argc, const char *argv[]) {
     }
     total++;
   }
-  f.close();
   
   double percent = (double) probability_count / total * 100;
   printf("%.2f%% or %d/%d sites have a probability greater than %.2f.\n",
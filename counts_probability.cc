@@ -20,25 +20,39 @@
  * for each trio on a new line.
  *
  * To compile on Herschel:
- * c++ -std=c++11 -L/usr/local/lib -I/usr/local/include -o counts_probability utility.cc counts_probability.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o counts_probability utility.cc gzip_reader.cc uring_reader.cc line_reader.cc counts_probability.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./counts_probability <input>.txt <output>.txt
+ * ./counts_probability <input>.txt <output>.txt [options]
+ *
+ * Options:
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
  */
 #include <fstream>
-#include <sstream>
 
-#include "utility.h"
+#include "line_reader.h"
 
 
 int main(int argc, const char *argv[]) {
   if (argc < 3) {
-    Die("USAGE: counts_probability <input>.txt <output>.txt");
+    Die("USAGE: counts_probability <input>.txt <output>.txt "
+        "[--io-backend <mmap|pread|io_uring>]");
   }
 
   const string file_name = argv[1];
-  ifstream fin(file_name);
-  if (!fin.is_open() || 0 != fin.fail()) {
+  ReadOptions read_options;
+  for (int i = 3; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
+  LineReader reader(file_name, read_options);
+  if (!reader.is_open()) {
     Die("Input file cannot be read.");
   }
 
@@ -47,18 +61,16 @@ int main(int argc, const char *argv[]) {
 
   double probability = 0.0;
   vector<double> probabilities;
-  int index = 0;  // Currently unused.
   int has_mutation_total = 0;
   int has_no_mutation_total = 0;
   int total_trios = 0;
-  string line;
+  StringView line;
 
-  while (getline(fin, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> index;
-    str >> has_mutation_total;
-    str >> has_no_mutation_total;
+  while (reader.NextLine(line)) {
+    char *field_end = nullptr;
+    strtol(line.data, &field_end, 10);  // Skips the index.
+    has_mutation_total = strtol(field_end, &field_end, 10);
+    has_no_mutation_total = strtol(field_end, &field_end, 10);
     total_trios = has_mutation_total + has_no_mutation_total;
     if (total_trios == 0) {
       probability = 0.0;
@@ -67,7 +79,6 @@ int main(int argc, const char *argv[]) {
     }
     probabilities.push_back(probability);
   }
-  fin.close();
 
   ostream_iterator<double> output_iter(fout, "\n");
   copy(probabilities.begin(), probabilities.end(), output_iter);
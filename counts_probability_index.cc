@@ -22,25 +22,39 @@
  * for each trio on a new line.
  *
  * To compile on Herschel:
- * c++ -std=c++11 -L/usr/local/lib -I/usr/local/include -o counts_probability_index utility.cc counts_probability_index.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o counts_probability_index utility.cc gzip_reader.cc uring_reader.cc line_reader.cc counts_probability_index.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./counts_probability_index <input>.txt <output>.txt
+ * ./counts_probability_index <input>.txt <output>.txt [options]
+ *
+ * Options:
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
  */
 #include <fstream>
-#include <sstream>
 
-#include "utility.h"
+#include "line_reader.h"
 
 
 int main(int argc, const char *argv[]) {
   if (argc < 3) {
-    Die("USAGE: counts_probability_index <input>.txt <output>.txt");
+    Die("USAGE: counts_probability_index <input>.txt <output>.txt "
+        "[--io-backend <mmap|pread|io_uring>]");
   }
 
   const string file_name = argv[1];
-  ifstream fin(file_name);
-  if (!fin.is_open() || 0 != fin.fail()) {
+  ReadOptions read_options;
+  for (int i = 3; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
+  LineReader reader(file_name, read_options);
+  if (!reader.is_open()) {
     Die("Input file cannot be read.");
   }
 
@@ -55,19 +69,17 @@ int main(int argc, const char *argv[]) {
   int total_trios = 0;
   int has_mutation_totals[kTrioCount] = {0};
   int trio_totals[kTrioCount] = {0};
-  string line;
+  StringView line;
 
-  while (getline(fin, line)) {
-    line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-    stringstream str(line);
-    str >> index;
-    str >> has_mutation_total;
-    str >> has_no_mutation_total;
+  while (reader.NextLine(line)) {
+    char *field_end = nullptr;
+    index = strtol(line.data, &field_end, 10);
+    has_mutation_total = strtol(field_end, &field_end, 10);
+    has_no_mutation_total = strtol(field_end, &field_end, 10);
     total_trios = has_mutation_total + has_no_mutation_total;
     has_mutation_totals[index] += has_mutation_total;
     trio_totals[index] += total_trios;
   }
-  fin.close();
 
   for (int i = 0; i < kTrioCount; ++i) {
     if (has_mutation_totals[i] == 0) {
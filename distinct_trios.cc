@@ -0,0 +1,246 @@
+/**
+ * @file distinct_trios.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the TrioHistogram, TrioCounter and
+ * TrioLookup classes.
+ *
+ * See top of distinct_trios.h for a complete description.
+ */
+#include "distinct_trios.h"
+
+
+/**
+ * Returns the distinct trio of the reads of a site.
+ *
+ * @param  data_vec  Reads of the child, mother and father.
+ * @param  reference Reference nucleotide index of the priors, or -1.
+ * @return           Distinct trio.
+ */
+DistinctTrio MakeDistinctTrio(const ReadDataVector &data_vec, int reference) {
+  DistinctTrio trio;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    trio.keys[i] = data_vec[i].key;
+  }
+  trio.reference = reference;
+  return trio;
+}
+
+/**
+ * Default constructor of an empty histogram.
+ */
+TrioHistogram::TrioHistogram()
+    : stripes_{new Stripe[kTrioHistogramStripes]}, site_count_{0} {
+}
+
+/**
+ * Adds the site counts of distinct trios. The trios are grouped by stripe
+ * first, so each stripe is locked once.
+ *
+ * @param  counts Number of sites of each distinct trio.
+ */
+void TrioHistogram::Add(const TrioCounts &counts) {
+  DistinctTrioHash hash;
+  vector<vector<const TrioCounts::value_type*>> groups(kTrioHistogramStripes);
+  for (const TrioCounts::value_type &count : counts) {
+    groups[hash(count.first) % kTrioHistogramStripes].push_back(&count);
+  }
+  for (int i = 0; i < kTrioHistogramStripes; ++i) {
+    if (groups[i].empty()) {
+      continue;
+    }
+    lock_guard<mutex> lock(stripes_[i].lock);
+    for (const TrioCounts::value_type *count : groups[i]) {
+      stripes_[i].counts[count->first] += count->second;
+    }
+  }
+}
+
+/**
+ * Moves the trios of all stripes to entries(), sorted by their reads, so the
+ * order does not depend on the threads that counted them.
+ */
+void TrioHistogram::Finish() {
+  entries_.clear();
+  site_count_ = 0;
+  for (int i = 0; i < kTrioHistogramStripes; ++i) {
+    for (const TrioCounts::value_type &count : stripes_[i].counts) {
+      entries_.push_back({count.first, count.second, 0.0});
+      site_count_ += count.second;
+    }
+    TrioCounts().swap(stripes_[i].counts);
+  }
+  sort(entries_.begin(), entries_.end(),
+       [](const DistinctTrioEntry &a, const DistinctTrioEntry &b) {
+    return lexicographical_compare(a.trio.keys, a.trio.keys + kIndividualCount,
+                                   b.trio.keys, b.trio.keys + kIndividualCount)
+           || (equal(a.trio.keys, a.trio.keys + kIndividualCount, b.trio.keys)
+               && a.trio.reference < b.trio.reference);
+  });
+}
+
+/**
+ * Sorts entries() by decreasing probability and indexes their probabilities
+ * for Probability(). Trios with the same probability keep the order of their
+ * reads.
+ */
+void TrioHistogram::BuildLookup() {
+  stable_sort(entries_.begin(), entries_.end(),
+              [](const DistinctTrioEntry &a, const DistinctTrioEntry &b) {
+    return a.probability > b.probability;
+  });
+  probabilities_.reserve(entries_.size());
+  for (const DistinctTrioEntry &entry : entries_) {
+    probabilities_[entry.trio] = entry.probability;
+  }
+}
+
+/**
+ * Returns the probability of a distinct trio that was counted.
+ *
+ * @param  trio Distinct trio.
+ * @return      Probability of mutation.
+ */
+double TrioHistogram::Probability(const DistinctTrio &trio) const {
+  auto it = probabilities_.find(trio);
+  if (it == probabilities_.end()) {
+    Die("Site was not counted in the trio histogram.");
+  }
+  return it->second;
+}
+
+vector<DistinctTrioEntry>& TrioHistogram::entries() {
+  return entries_;
+}
+
+uint64_t TrioHistogram::site_count() const {
+  return site_count_;
+}
+
+/**
+ * Constructor of a counter that adds its sites to a histogram.
+ *
+ * @param  histogram Histogram.
+ */
+TrioCounter::TrioCounter(TrioHistogram &histogram)
+    : histogram_{&histogram}, reference_{-1} {
+}
+
+/**
+ * Copy constructor of a counter of another worker, which counts into its own
+ * local map and adds it to the same histogram.
+ *
+ * @param  other Counter that is copied.
+ */
+TrioCounter::TrioCounter(const TrioCounter &other)
+    : histogram_{other.histogram_}, reference_{other.reference_} {
+}
+
+/**
+ * Destructor that adds the local counts to the histogram.
+ */
+TrioCounter::~TrioCounter() {
+  TrioCounter::Flush();
+}
+
+/**
+ * Counts a site and returns a probability of 0, so the site is not written.
+ *
+ * @param  data_vec Reads of the child, mother and father.
+ * @return          0.
+ */
+double TrioCounter::MutationProbability(const ReadDataVector &data_vec) {
+  counts_[MakeDistinctTrio(data_vec, reference_)]++;
+  if (counts_.size() >= kTrioCounterFlushSize) {
+    TrioCounter::Flush();
+  }
+  return 0.0;
+}
+
+/**
+ * Site-specific rates are not supported, because the probability of a trio
+ * then depends on its site.
+ */
+double TrioCounter::MutationProbability(const ReadDataVector &/*data_vec*/,
+                                        double /*germline_mutation_rate*/) {
+  Die("Distinct trios are scored without a rate track.");
+  return 0.0;
+}
+
+/**
+ * Sets the reference nucleotide of the next sites.
+ *
+ * @param  reference_idx Index of the reference nucleotide, or -1.
+ */
+void TrioCounter::SetReference(int reference_idx) {
+  reference_ = reference_idx;
+}
+
+/**
+ * Site frequencies are not supported, because the probability of a trio then
+ * depends on its site.
+ */
+void TrioCounter::SetSiteFrequencies(const RowVector4d &/*frequencies*/) {
+  Die("Distinct trios are scored without population frequencies.");
+}
+
+void TrioCounter::ClearSiteFrequencies() {
+}
+
+/**
+ * Adds the local counts to the histogram and clears them.
+ */
+void TrioCounter::Flush() {
+  if (!counts_.empty()) {
+    histogram_->Add(counts_);
+    counts_.clear();
+  }
+}
+
+/**
+ * Constructor of a lookup of the probabilities of a histogram after
+ * BuildLookup().
+ *
+ * @param  histogram Scored histogram.
+ */
+TrioLookup::TrioLookup(const TrioHistogram &histogram)
+    : histogram_{&histogram}, reference_{-1} {
+}
+
+/**
+ * Returns the probability of the distinct trio of a site.
+ *
+ * @param  data_vec Reads of the child, mother and father.
+ * @return          Probability of mutation.
+ */
+double TrioLookup::MutationProbability(const ReadDataVector &data_vec) {
+  return histogram_->Probability(MakeDistinctTrio(data_vec, reference_));
+}
+
+/**
+ * Site-specific rates are not supported, see TrioCounter.
+ */
+double TrioLookup::MutationProbability(const ReadDataVector &/*data_vec*/,
+                                       double /*germline_mutation_rate*/) {
+  Die("Distinct trios are scored without a rate track.");
+  return 0.0;
+}
+
+/**
+ * Sets the reference nucleotide of the next sites.
+ *
+ * @param  reference_idx Index of the reference nucleotide, or -1.
+ */
+void TrioLookup::SetReference(int reference_idx) {
+  reference_ = reference_idx;
+}
+
+/**
+ * Site frequencies are not supported, see TrioCounter.
+ */
+void TrioLookup::SetSiteFrequencies(const RowVector4d &/*frequencies*/) {
+  Die("Distinct trios are scored without population frequencies.");
+}
+
+void TrioLookup::ClearSiteFrequencies() {
+}
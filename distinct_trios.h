@@ -0,0 +1,215 @@
+/**
+ * @file distinct_trios.h
+ * @author Melissa Ip
+ *
+ * A genome has billions of sites but only millions of distinct child, mother
+ * and father reads, and without site-specific rates or frequencies every site
+ * with the same reads has the same probability of mutation. The distinct-trio
+ * mode of pileup_driver therefore scores in two phases:
+ *
+ *   1. The sites are counted into a TrioHistogram of their distinct reads
+ *      (and reference nucleotide if the priors are conditioned on it).
+ *   2. Each distinct trio is scored once by ScoreHistogram() on several
+ *      threads.
+ *
+ * The output is then either the histogram itself, i.e. each distinct trio with
+ * its probability and number of sites, or the usual output of every site,
+ * whose probability is looked up in the histogram in another pass.
+ *
+ * The histogram is a concurrent hash map that is split into
+ * kTrioHistogramStripes stripes with one lock each. TrioCounter objects count
+ * sites into a local map and add it to the histogram once it holds
+ * kTrioCounterFlushSize trios, so the threads rarely wait for a lock.
+ *
+ * TrioCounter and TrioLookup have the interface of the trio models that
+ * ScoreSite() uses, so the counting and lookup passes reuse every reader of
+ * the pileup files, i.e. shards, regions, the pipeline, SAM files and trio
+ * count files. TrioCounter returns a probability of 0 for every site, so the
+ * counting pass writes nothing.
+ *
+ * Example usage:
+ *
+ *   TrioHistogram histogram;
+ *   TrioCounter counter(histogram);
+ *   ScorePileup(counter, pileups, default_rate, options, sink);
+ *   counter.Flush();
+ *   histogram.Finish();
+ *   ScoreHistogram(params, histogram, false, 8);  // No reference priors.
+ *   TrioLookup lookup(histogram);
+ *   ScorePileup(lookup, pileups, default_rate, options, writer);
+ */
+#ifndef DISTINCT_TRIOS_H
+#define DISTINCT_TRIOS_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "trio_model.h"
+
+
+// Number of stripes of the histogram, each with its own lock.
+const int kTrioHistogramStripes = 64;
+
+// Number of distinct trios that a TrioCounter holds before it adds them to the
+// histogram.
+const size_t kTrioCounterFlushSize = 1 << 16;
+
+// Number of trios that a thread of ScoreHistogram() takes at a time.
+const int kHistogramChunkSize = 256;
+
+/**
+ * Reads of a trio and the reference nucleotide index of the priors, -1 if the
+ * priors are not conditioned on the reference.
+ */
+struct DistinctTrio {
+  bool operator==(const DistinctTrio &other) const {
+    return keys[0] == other.keys[0] && keys[1] == other.keys[1] &&
+           keys[2] == other.keys[2] && reference == other.reference;
+  }
+  uint64_t keys[kIndividualCount];  // ReadData::key of child, mother and father.
+  int reference;
+};
+
+/**
+ * Hash of a DistinctTrio that mixes the bits of all reads.
+ */
+struct DistinctTrioHash {
+  size_t operator()(const DistinctTrio &trio) const {
+    uint64_t hash = trio.reference + 1;
+    for (int i = 0; i < kIndividualCount; ++i) {
+      hash = (hash ^ trio.keys[i]) * 0x9e3779b97f4a7c15ULL;
+      hash ^= hash >> 29;
+    }
+    return hash;
+  }
+};
+
+typedef unordered_map<DistinctTrio, uint64_t, DistinctTrioHash> TrioCounts;
+
+/**
+ * Distinct trio of the histogram with its number of sites and probability.
+ */
+struct DistinctTrioEntry {
+  DistinctTrio trio;
+  uint64_t site_count;
+  double probability;
+};
+
+/**
+ * TrioHistogram class header. See top of file for a complete description.
+ */
+class TrioHistogram {
+ public:
+  TrioHistogram();
+  void Add(const TrioCounts &counts);  // Thread-safe until Finish().
+  void Finish();  // Moves the trios to entries() in a fixed order.
+  void BuildLookup();  // Sorts entries() by probability and indexes them.
+  double Probability(const DistinctTrio &trio) const;  // After BuildLookup().
+  vector<DistinctTrioEntry>& entries();
+  uint64_t site_count() const;
+
+ private:
+  struct Stripe {
+    mutex lock;
+    TrioCounts counts;
+  };
+
+  // Instance member variables.
+  unique_ptr<Stripe[]> stripes_;
+  vector<DistinctTrioEntry> entries_;
+  unordered_map<DistinctTrio, double, DistinctTrioHash> probabilities_;
+  uint64_t site_count_;
+};
+
+/**
+ * TrioCounter class header. See top of file for a complete description.
+ */
+class TrioCounter {
+ public:
+  TrioCounter(TrioHistogram &histogram);
+  TrioCounter(const TrioCounter &other);  // Copies of workers count on their own.
+  ~TrioCounter();  // Flushes the local counts.
+  double MutationProbability(const ReadDataVector &data_vec);  // Counts the site.
+  double MutationProbability(const ReadDataVector &data_vec,
+                             double germline_mutation_rate);
+  void SetReference(int reference_idx);
+  void SetSiteFrequencies(const RowVector4d &frequencies);
+  void ClearSiteFrequencies();
+  void Flush();  // Adds the local counts to the histogram.
+
+ private:
+  // Instance member variables.
+  TrioHistogram *histogram_;
+  TrioCounts counts_;
+  int reference_;
+};
+
+/**
+ * TrioLookup class header. See top of file for a complete description.
+ */
+class TrioLookup {
+ public:
+  TrioLookup(const TrioHistogram &histogram);
+  double MutationProbability(const ReadDataVector &data_vec);  // From the histogram.
+  double MutationProbability(const ReadDataVector &data_vec,
+                             double germline_mutation_rate);
+  void SetReference(int reference_idx);
+  void SetSiteFrequencies(const RowVector4d &frequencies);
+  void ClearSiteFrequencies();
+
+ private:
+  // Instance member variables.
+  const TrioHistogram *histogram_;
+  int reference_;
+};
+
+/**
+ * Scores every distinct trio of a finished histogram once. Each thread scores
+ * chunks of kHistogramChunkSize trios with its own copy of the model, which
+ * selects the priors of the reference of the trio.
+ *
+ * @param  params           GenericTrioModel or GenericUnorderedTrioModel
+ *                          object.
+ * @param  histogram        Finished histogram.
+ * @param  reference_priors True if the priors are conditioned on the reference.
+ * @param  threads          Number of threads, including the calling thread.
+ */
+template <typename Model>
+void ScoreHistogram(const Model &params, TrioHistogram &histogram,
+                    bool reference_priors, int threads) {
+  vector<DistinctTrioEntry> &entries = histogram.entries();
+  atomic<size_t> next_entry{0};
+  auto score_entries = [&]() {
+    Model worker_params(params);
+    ReadDataVector data_vec(kIndividualCount);
+    for (size_t begin = next_entry.fetch_add(kHistogramChunkSize);
+         begin < entries.size();
+         begin = next_entry.fetch_add(kHistogramChunkSize)) {
+      const size_t end = min(begin + kHistogramChunkSize, entries.size());
+      for (size_t i = begin; i < end; ++i) {
+        DistinctTrioEntry &entry = entries[i];
+        for (int j = 0; j < kIndividualCount; ++j) {
+          data_vec[j].key = entry.trio.keys[j];
+        }
+        if (reference_priors) {
+          worker_params.SetReference(entry.trio.reference);
+        }
+        entry.probability = (double) worker_params.MutationProbability(data_vec);
+      }
+    }
+  };
+
+  vector<thread> workers;
+  for (int i = 1; i < threads; ++i) {
+    workers.emplace_back(score_entries);
+  }
+  score_entries();
+  for (thread &worker : workers) {
+    worker.join();
+  }
+}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file frequency_track.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the FrequencyTrack class.
+ *
+ * See top of frequency_track.h for a complete description.
+ */
+#include "frequency_track.h"
+
+
+/**
+ * Constructor that opens the frequency file.
+ *
+ * @param  file_name Frequency file name.
+ */
+FrequencyTrack::FrequencyTrack(const string &file_name)
+    : track_{file_name}, has_site_{false}, position_{0} {
+  if (!track_.is_open()) {
+    Die("Frequency file cannot be read.");
+  }
+}
+
+/**
+ * Looks up the population allele frequencies of a site. Moves the file to the
+ * contig of the site when the queries move to another contig and skips the
+ * sites that come before the queried site.
+ *
+ * @param  contig      Contig of the site.
+ * @param  position    1-based position of the site as in the pileup files.
+ * @param  frequencies Set to the frequencies of A, C, G and T if found.
+ * @return             True if the site is in the frequency file.
+ */
+bool FrequencyTrack::Frequencies(const string &contig, int position,
+                                 RowVector4d &frequencies) {
+  if (contig != query_contig_) {
+    query_contig_ = contig;
+    has_site_ = track_.StartContig(contig) && FrequencyTrack::ParseSite();
+  }
+
+  while (has_site_ && position_ < position) {
+    has_site_ = track_.NextLine() && FrequencyTrack::ParseSite();
+  }
+
+  if (has_site_ && position_ == position) {
+    frequencies = frequencies_;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+/**
+ * Skips the sites of a contig that comes before the first queried site,
+ * e.g. when a shard of the pileup files starts after the contig.
+ *
+ * @param  contig Contig that is not queried.
+ */
+void FrequencyTrack::SkipContig(const string &contig) {
+  track_.SkipContig(contig);
+}
+
+/**
+ * Sets the order of the contigs in the pileup files, e.g. when only the
+ * regions of a BED file are scanned, so the file does not need to look ahead
+ * for contigs that it does not have.
+ *
+ * @param  contigs Contigs in pileup order.
+ */
+void FrequencyTrack::SetContigOrder(const vector<string> &contigs) {
+  track_.SetContigOrder(contigs);
+}
+
+/**
+ * Parses the site of the current line of the file.
+ *
+ * @return  True.
+ */
+bool FrequencyTrack::ParseSite() {
+  stringstream str(track_.line());
+  string contig;
+  str >> contig >> position_;
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    str >> frequencies_(i);
+  }
+  if (str.fail() || frequencies_.minCoeff() < 0.0 || frequencies_.sum() <= 0.0) {
+    Die("Frequency file line is not in the format: contig position A C G T.");
+  }
+  frequencies_ /= frequencies_.sum();
+  return true;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file frequency_track.h
+ * @author Melissa Ip
+ *
+ * The FrequencyTrack class streams population allele frequencies of known
+ * polymorphic sites from a tab separated file alongside the pileup files.
+ * Each line holds the 1-based position of a site and the frequencies of
+ * A, C, G and T in the population:
+ *
+ *   <contig>  <position>  <A>  <C>  <G>  <T>
+ *
+ * The frequencies are normalized to sum to 1. The sites must be sorted by
+ * position within a contig. The file is streamed contig by contig with a
+ * TrackReader (see track_reader.h), so it may have contigs that the pileup
+ * files do not have and vice versa, but the contigs that both have must
+ * appear in the same order.
+ *
+ * Example usage:
+ *
+ *   FrequencyTrack track("frequencies.txt");
+ *   RowVector4d frequencies;
+ *   if (track.Frequencies("1", 10468, frequencies)) {
+ *     params.SetSiteFrequencies(frequencies);
+ *   } else {
+ *     params.ClearSiteFrequencies();
+ *   }
+ */
+#ifndef FREQUENCY_TRACK_H
+#define FREQUENCY_TRACK_H
+
+#include <sstream>
+
+#include "track_reader.h"
+
+
+/**
+ * FrequencyTrack class header. See top of file for a complete description.
+ */
+class FrequencyTrack {
+ public:
+  FrequencyTrack(const string &file_name);
+  bool Frequencies(const string &contig, int position,
+                   RowVector4d &frequencies);  // Positions must be queried in pileup order.
+  void SkipContig(const string &contig);  // Contig before the first query.
+  void SetContigOrder(const vector<string> &contigs);  // Contigs in pileup order.
+
+ private:
+  bool ParseSite();
+
+  // Instance member variables.
+  TrackReader track_;
+  bool has_site_;  // False at the end of the contig of the last query.
+  int position_;  // Current site.
+  RowVector4d frequencies_;
+  string query_contig_;  // Contig of the last query.
+};
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ * @file gzip_reader.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the GzipReader class.
+ *
+ * See top of gzip_reader.h for a complete description.
+ */
+#include <unistd.h>
+
+#include "gzip_reader.h"
+
+// Number of bytes of a BGZF header, including the BC field.
+const size_t kBgzfHeaderSize = 18;
+
+// Number of bytes of the CRC32 and ISIZE fields at the end of a gzip member.
+const size_t kGzipFooterSize = 8;
+
+
+/**
+ * Returns a little-endian integer of the given number of bytes.
+ *
+ * @param  data  Bytes of the integer.
+ * @param  bytes Number of bytes.
+ * @return       Integer.
+ */
+uint32_t ReadLittleEndian(const char *data, int bytes) {
+  uint32_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+/**
+ * Returns true if the header of a gzip member is a BGZF header, i.e. it has
+ * an extra field with the BC subfield.
+ *
+ * @param  header First kBgzfHeaderSize bytes of the member.
+ * @return        True if the member is a BGZF block.
+ */
+bool IsBgzfHeader(const char *header) {
+  return IsGzipData(header, kBgzfHeaderSize) && header[2] == 8 &&
+         (header[3] & 4) != 0 && ReadLittleEndian(header + 10, 2) == 6 &&
+         header[12] == 'B' && header[13] == 'C' &&
+         ReadLittleEndian(header + 14, 2) == 2;
+}
+
+/**
+ * Constructor that checks if the file is a BGZF file and starts the inflate
+ * threads.
+ *
+ * @param  fd          Descriptor of the compressed file.
+ * @param  is_seekable True if the file can be read with pread().
+ * @param  offset      Offset of the first compressed byte after prefix.
+ * @param  prefix      Compressed bytes that were read from fd before.
+ * @param  threads     Number of inflate threads. BGZF blocks are inflated
+ *                     on the calling thread if 0.
+ */
+GzipReader::GzipReader(int fd, bool is_seekable, off_t offset,
+                       const string &prefix, int threads)
+    : fd_{fd}, is_seekable_{is_seekable}, is_bgzf_{false},
+      input_offset_{offset - (off_t) prefix.size()},
+      last_block_offset_{numeric_limits<off_t>::max()}, prefix_{prefix},
+      prefix_offset_{0}, is_input_done_{false}, stream_(),
+      is_member_end_{false}, next_read_{0}, next_inflate_{0}, next_return_{0},
+      is_stopped_{false} {
+  char header[kBgzfHeaderSize];
+  size_t bytes = GzipReader::ReadInput(header, kBgzfHeaderSize);
+  is_bgzf_ = bytes == kBgzfHeaderSize && IsBgzfHeader(header);
+  prefix_ = string(header, bytes) + prefix_.substr(prefix_offset_);  // Puts the header back.
+  prefix_offset_ = 0;
+  input_offset_ -= bytes;
+
+  if (inflateInit2(&stream_, is_bgzf_ ? -MAX_WBITS : MAX_WBITS + 16) != Z_OK) {
+    Die("Compressed file cannot be inflated.");
+  }
+  if (!is_bgzf_) {
+    input_.resize(kGzipBlockSize);
+    output_.resize(kGzipBlockSize);
+    return;
+  }
+
+  blocks_.resize(max(threads, 1) * kGzipBlocksPerThread);
+  for (unique_ptr<Block> &block : blocks_) {
+    block.reset(new Block());
+    block->is_ready = true;
+  }
+  for (int i = 0; i < threads; ++i) {
+    threads_.emplace_back(&GzipReader::Inflate, this);
+  }
+}
+
+/**
+ * Destructor that stops the inflate threads once they have inflated the
+ * blocks that were read.
+ */
+GzipReader::~GzipReader() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  block_read_.notify_all();
+  for (thread &worker : threads_) {
+    worker.join();
+  }
+  inflateEnd(&stream_);
+}
+
+/**
+ * Returns the next block of uncompressed data. The block is valid until the
+ * next call to NextBlock() or Seek().
+ *
+ * @param  block        View of the uncompressed data.
+ * @param  block_offset Compressed offset of the BGZF block or -1 if the file
+ *                      is not a BGZF file.
+ * @return              False if there is no data left.
+ */
+bool GzipReader::NextBlock(StringView &block, off_t &block_offset) {
+  if (!is_bgzf_) {
+    block_offset = -1;
+    return GzipReader::NextStreamBlock(block);
+  }
+
+  while (true) {
+    // Reads the compressed blocks ahead into the free slots of the ring.
+    while (!is_input_done_ && next_read_ - next_return_ < blocks_.size()) {
+      Block &next = *blocks_[next_read_ % blocks_.size()];
+      if (!GzipReader::ReadBgzfBlock(next)) {
+        is_input_done_ = true;
+        break;
+      }
+      if (threads_.empty()) {
+        InflateBgzfBlock(stream_, next.compressed, next.data, next.size);
+        next_read_++;
+        continue;
+      }
+      {
+        lock_guard<mutex> lock(mutex_);  // Publishes the block.
+        next.is_ready = false;
+        next_read_++;
+      }
+      block_read_.notify_one();
+    }
+    if (next_return_ == next_read_) {
+      return false;
+    }
+
+    Block &next = *blocks_[next_return_ % blocks_.size()];
+    GzipReader::WaitUntilReady(next);
+    next_return_++;
+    if (next.size > 0) {  // Skips empty blocks, e.g. the end-of-file marker.
+      block = StringView(next.data.data(), next.size);
+      block_offset = next.offset;
+      return true;
+    }
+  }
+}
+
+/**
+ * Moves the reader to the BGZF blocks that start in a range of compressed
+ * offsets, e.g. the blocks of a region in the pileup index.
+ *
+ * @param  block_offset      Compressed offset of the first block.
+ * @param  last_block_offset Compressed offset of the last block.
+ */
+void GzipReader::Seek(off_t block_offset, off_t last_block_offset) {
+  if (!is_bgzf_ || !is_seekable_) {
+    Die("Only regular BGZF files can be read by range.");
+  }
+  GzipReader::Drain();
+  prefix_.clear();
+  prefix_offset_ = 0;
+  input_offset_ = block_offset;
+  last_block_offset_ = last_block_offset;
+  is_input_done_ = false;
+}
+
+bool GzipReader::is_bgzf() const {
+  return is_bgzf_;
+}
+
+/**
+ * Reads compressed bytes, first from the prefix and then from the file.
+ *
+ * @param  data Buffer of at least size bytes.
+ * @param  size Number of bytes to read.
+ * @return      Number of bytes read, which is less than size only at the end
+ *              of the file.
+ */
+size_t GzipReader::ReadInput(char *data, size_t size) {
+  size_t total = 0;
+  if (prefix_offset_ < prefix_.size()) {
+    total = min(size, prefix_.size() - prefix_offset_);
+    memcpy(data, prefix_.data() + prefix_offset_, total);
+    prefix_offset_ += total;
+  }
+  while (total < size) {
+    ssize_t bytes = 0;
+    if (is_seekable_) {
+      bytes = pread(fd_, data + total, size - total, input_offset_ + total);
+    } else {
+      bytes = read(fd_, data + total, size - total);
+    }
+    if (bytes == -1 && errno == EINTR) {
+      continue;
+    } else if (bytes == -1) {
+      Die("Compressed file cannot be read.");
+    } else if (bytes == 0) {
+      break;
+    }
+    total += bytes;
+  }
+  input_offset_ += total;
+  return total;
+}
+
+/**
+ * Reads the next compressed BGZF block.
+ *
+ * @param  block Block whose compressed bytes and offset are overwritten.
+ * @return       False if there are no blocks left in the range.
+ */
+bool GzipReader::ReadBgzfBlock(Block &block) {
+  if (input_offset_ > last_block_offset_) {
+    return false;
+  }
+  block.offset = input_offset_;
+  block.compressed.resize(kBgzfHeaderSize);
+  size_t bytes = GzipReader::ReadInput(block.compressed.data(),
+                                       kBgzfHeaderSize);
+  if (bytes == 0) {
+    return false;
+  } else if (bytes < kBgzfHeaderSize ||
+             !IsBgzfHeader(block.compressed.data())) {
+    Die("Compressed file is not a valid BGZF file.");
+  }
+
+  size_t block_size = ReadLittleEndian(block.compressed.data() + 16, 2) + 1;
+  if (block_size < kBgzfHeaderSize + kGzipFooterSize) {
+    Die("Compressed file is not a valid BGZF file.");
+  }
+  block.compressed.resize(block_size);
+  bytes = GzipReader::ReadInput(block.compressed.data() + kBgzfHeaderSize,
+                                block_size - kBgzfHeaderSize);
+  if (bytes != block_size - kBgzfHeaderSize) {
+    Die("Compressed file is truncated.");
+  }
+  return true;
+}
+
+/**
+ * Inflates the next block of a gzip stream that is not BGZF. Concatenated
+ * gzip members are inflated one after the other.
+ *
+ * @param  block View of the uncompressed data.
+ * @return       False if there is no data left.
+ */
+bool GzipReader::NextStreamBlock(StringView &block) {
+  stream_.next_out = reinterpret_cast<Bytef *>(output_.data());
+  stream_.avail_out = output_.size();
+  while (stream_.avail_out == output_.size()) {
+    if (stream_.avail_in == 0) {
+      size_t bytes = GzipReader::ReadInput(input_.data(), input_.size());
+      if (bytes == 0) {
+        if (!is_member_end_) {
+          Die("Compressed file is truncated.");
+        }
+        return false;
+      }
+      stream_.next_in = reinterpret_cast<Bytef *>(input_.data());
+      stream_.avail_in = bytes;
+    }
+    int status = inflate(&stream_, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      is_member_end_ = true;
+      inflateReset(&stream_);  // Next member.
+    } else if (status == Z_OK) {
+      is_member_end_ = false;
+    } else if (status != Z_BUF_ERROR) {
+      Die("Compressed file is corrupt.");
+    }
+  }
+  block = StringView(output_.data(), output_.size() - stream_.avail_out);
+  return true;
+}
+
+/**
+ * Loop of an inflate thread. Claims the next block that was read, inflates it
+ * without holding the lock, and waits while there are no blocks to inflate.
+ */
+void GzipReader::Inflate() {
+  z_stream stream = z_stream();
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    Die("Compressed file cannot be inflated.");
+  }
+  unique_lock<mutex> lock(mutex_);
+  while (true) {
+    block_read_.wait(lock, [this]() {
+      return next_inflate_ < next_read_ || is_stopped_;
+    });
+    if (next_inflate_ == next_read_) {
+      break;  // Stopped.
+    }
+    Block &block = *blocks_[next_inflate_++ % blocks_.size()];
+    lock.unlock();
+    InflateBgzfBlock(stream, block.compressed, block.data, block.size);
+    lock.lock();
+    block.is_ready = true;
+    block_inflated_.notify_one();
+  }
+  inflateEnd(&stream);
+}
+
+/**
+ * Waits until an inflate thread has inflated a block.
+ *
+ * @param  block Block that was read.
+ */
+void GzipReader::WaitUntilReady(const Block &block) {
+  unique_lock<mutex> lock(mutex_);
+  block_inflated_.wait(lock, [&block]() { return block.is_ready; });
+}
+
+/**
+ * Waits until the inflate threads have finished the blocks that were read
+ * ahead and drops them.
+ */
+void GzipReader::Drain() {
+  for (; next_return_ < next_read_; ++next_return_) {
+    GzipReader::WaitUntilReady(*blocks_[next_return_ % blocks_.size()]);
+  }
+}
+
+/**
+ * Returns true if data starts with the magic bytes of a gzip file.
+ *
+ * @param  data Bytes at the start of a file.
+ * @param  size Number of bytes.
+ * @return      True if the file is gzip compressed.
+ */
+bool IsGzipData(const char *data, size_t size) {
+  return size >= 2 && static_cast<unsigned char>(data[0]) == 0x1f &&
+         static_cast<unsigned char>(data[1]) == 0x8b;
+}
+
+/**
+ * Inflates a BGZF block and checks its size and CRC32.
+ *
+ * @param  stream     Raw inflate stream of the thread.
+ * @param  compressed Compressed block including header and footer.
+ * @param  data       Uncompressed data.
+ * @param  size       Number of uncompressed bytes.
+ */
+void InflateBgzfBlock(z_stream &stream, const vector<char> &compressed,
+                      vector<char> &data, size_t &size) {
+  const char *footer = compressed.data() + compressed.size() - kGzipFooterSize;
+  uint32_t crc = ReadLittleEndian(footer, 4);
+  size = ReadLittleEndian(footer + 4, 4);
+  if (size > kGzipBlockSize) {
+    Die("Compressed file is not a valid BGZF file.");
+  }
+  data.resize(max(size, (size_t) 1));
+
+  inflateReset(&stream);
+  stream.next_in = reinterpret_cast<Bytef *>(
+    const_cast<char *>(compressed.data()) + kBgzfHeaderSize
+  );
+  stream.avail_in = compressed.size() - kBgzfHeaderSize - kGzipFooterSize;
+  stream.next_out = reinterpret_cast<Bytef *>(data.data());
+  stream.avail_out = size;
+  int status = inflate(&stream, Z_FINISH);
+  if (status != Z_STREAM_END || stream.avail_out != 0 ||
+      crc32(0L, reinterpret_cast<Bytef *>(data.data()), size) != crc) {
+    Die("Compressed file is corrupt.");
+  }
+}
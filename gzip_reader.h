@@ -0,0 +1,113 @@
+/**
+ * @file gzip_reader.h
+ * @author Melissa Ip
+ *
+ * The GzipReader class inflates a gzip compressed file with zlib and returns
+ * the uncompressed data in blocks, which LineReader splits into lines. Files
+ * compressed with bgzip are BGZF files, i.e. a series of gzip members of at
+ * most kGzipBlockSize uncompressed bytes each, with the compressed size of the
+ * member in the BC field of its header. The members of a BGZF file can be
+ * inflated independently, so the calling thread reads the compressed blocks
+ * ahead of the parser into a ring of blocks, and a pool of inflate threads
+ * claims the blocks by sequence number and inflates them in parallel. The
+ * blocks are returned in file order. Idle inflate threads wait on a condition
+ * variable until a block is read, and the calling thread waits on another
+ * until the next block is inflated, so no thread spins.
+ *
+ * Other gzip files are inflated as a single stream on the calling thread,
+ * because a deflate stream cannot be split.
+ *
+ * A position in a BGZF file is a virtual offset, i.e. the compressed offset
+ * of a block shifted left by 16 bits plus the offset of the position in the
+ * uncompressed block, so the pileup index (see pileup_index.h) can point into
+ * compressed files and Seek() can start at any block.
+ *
+ * Example usage:
+ *
+ *   GzipReader reader(fd, true, 0, "", 4);  // Regular file, 4 threads.
+ *   StringView block;
+ *   off_t block_offset;
+ *   while (reader.NextBlock(block, block_offset)) {
+ *     ...
+ *   }
+ */
+#ifndef GZIP_READER_H
+#define GZIP_READER_H
+
+#include <sys/types.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <zlib.h>
+
+#include "utility.h"
+
+
+// Maximum number of uncompressed bytes of a block that NextBlock() returns.
+const size_t kGzipBlockSize = 64 << 10;
+
+// Number of BGZF blocks that are read ahead for each inflate thread.
+const int kGzipBlocksPerThread = 4;
+
+/**
+ * GzipReader class header. See top of file for a complete description.
+ */
+class GzipReader {
+ public:
+  GzipReader(int fd, bool is_seekable, off_t offset, const string &prefix,
+             int threads);  // Prefix holds bytes that were read from fd.
+  ~GzipReader();
+  bool NextBlock(StringView &block, off_t &block_offset);  // Offset is -1 if the file is not BGZF.
+  void Seek(off_t block_offset, off_t last_block_offset);  // Blocks that start in [block_offset, last_block_offset].
+  bool is_bgzf() const;
+
+ private:
+  struct Block {
+    vector<char> compressed;
+    vector<char> data;
+    size_t size;  // Uncompressed bytes.
+    off_t offset;  // Compressed offset.
+    bool is_ready;  // Guarded by mutex_.
+  };
+
+  GzipReader(const GzipReader &other);  // Not copyable.
+  GzipReader& operator=(const GzipReader &other);
+  size_t ReadInput(char *data, size_t size);
+  bool ReadBgzfBlock(Block &block);
+  bool NextStreamBlock(StringView &block);
+  void Inflate();
+  void WaitUntilReady(const Block &block);
+  void Drain();
+
+  // Instance member variables.
+  int fd_;
+  bool is_seekable_;
+  bool is_bgzf_;
+  off_t input_offset_;  // Compressed offset of the next byte of input.
+  off_t last_block_offset_;  // Offset of the last BGZF block that is read.
+  string prefix_;  // Input that was read before the reader was created.
+  size_t prefix_offset_;
+  bool is_input_done_;
+  z_stream stream_;  // Inflates blocks if there are no inflate threads.
+  vector<char> input_;  // Input and output of a stream that is not BGZF.
+  vector<char> output_;
+  bool is_member_end_;
+  vector<unique_ptr<Block>> blocks_;  // Ring of blocks read ahead.
+  size_t next_read_;  // Sequence numbers of blocks.
+  size_t next_inflate_;  // Guarded by mutex_.
+  size_t next_return_;
+  bool is_stopped_;  // Guarded by mutex_.
+  mutex mutex_;
+  condition_variable block_read_;  // Wakes the inflate threads.
+  condition_variable block_inflated_;  // Wakes the calling thread.
+  vector<thread> threads_;
+};
+
+// Forward declarations.
+bool IsGzipData(const char *data, size_t size);
+void InflateBgzfBlock(z_stream &stream, const vector<char> &compressed,
+                      vector<char> &data, size_t &size);
+
+#endif
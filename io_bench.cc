@@ -0,0 +1,156 @@
+/**
+ * @file io_bench.cc
+ * @author Melissa Ip
+ *
+ * This file reads the given files line by line with each read backend of
+ * LineReader (see line_reader.h) and prints the time and throughput of each
+ * backend, so the fastest backend of a host can be passed to pileup_driver
+ * and trio_convert with --io-backend. Every backend reads the same files, and
+ * the number of lines and bytes that each backend reads is checked against
+ * the first backend.
+ *
+ * To compile on Herschel:
+ * c++ -std=c++11 -pthread -O2 -L/usr/local/lib -I/usr/local/include -o io_bench utility.cc gzip_reader.cc uring_reader.cc line_reader.cc io_bench.cc -lz
+ *
+ * To run this file, provide the following command line inputs:
+ * ./io_bench <input>.pileup [<input>.pileup ...] [options]
+ *
+ * Options:
+ *   --backends <backend>,...
+ *                  Backends that are compared, in order. Defaults to
+ *                  mmap,pread,io_uring.
+ *   --repeat <n>   Reads the files n times with each backend and prints the
+ *                  fastest run. Defaults to 3.
+ *   --cold         Drops the clean pages of each file from the page cache
+ *                  before each run with posix_fadvise(), so the files are
+ *                  read from storage, e.g. to compare backends on a first
+ *                  run instead of a rerun.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#include "line_reader.h"
+
+
+/**
+ * Drops the clean pages of a file from the page cache.
+ *
+ * @param  file_name File name.
+ */
+void DropCache(const string &file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd == -1) {
+    Die("Input file cannot be read.");
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+/**
+ * Reads every line of the files with a backend. The first byte of each line is
+ * summed, so every line is touched as by a parser.
+ *
+ * @param  file_names Input file names.
+ * @param  options    Read backend of the readers.
+ * @param  is_uring   Set to false if a file fell back from io_uring.
+ * @param  line_count Number of lines that are read.
+ * @param  byte_count Number of bytes of the lines that are read.
+ * @return            Sum of the first byte of every line.
+ */
+uint64_t ReadFiles(const vector<string> &file_names,
+                   const ReadOptions &options, bool &is_uring,
+                   uint64_t &line_count, uint64_t &byte_count) {
+  uint64_t checksum = 0;
+  line_count = 0;
+  byte_count = 0;
+  is_uring = true;
+  for (const string &file_name : file_names) {
+    LineReader reader(file_name, options);
+    if (!reader.is_open()) {
+      Die("Input file cannot be read.");
+    }
+    is_uring = is_uring && reader.is_uring();
+    StringView line;
+    while (reader.NextLine(line)) {
+      line_count++;
+      byte_count += line.size + 1;
+      checksum += line.size > 0 ? (uint8_t) line.data[0] : 0;
+    }
+  }
+  return checksum;
+}
+
+int main(int argc, const char *argv[]) {
+  if (argc < 2) {
+    Die("USAGE: io_bench <input> [<input> ...] "
+        "[--backends <mmap|pread|io_uring>,...] [--repeat <n>] [--cold]");
+  }
+
+  vector<string> file_names;
+  vector<string> backends = {"mmap", "pread", "io_uring"};
+  int repeat = 3;
+  bool is_cold = false;
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (arg == "--backends" && i + 1 < argc) {
+      backends.clear();
+      stringstream str(argv[++i]);
+      string backend;
+      while (getline(str, backend, ',')) {
+        backends.push_back(backend);
+      }
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      repeat = max(stoi(argv[++i]), 1);
+    } else if (arg == "--cold") {
+      is_cold = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      Die("Unknown option.");
+    } else {
+      file_names.push_back(arg);
+    }
+  }
+
+  uint64_t expected_lines = 0;
+  uint64_t expected_checksum = 0;
+  cout << "backend\tseconds\tMB/s\tlines" << endl;
+  for (size_t b = 0; b < backends.size(); ++b) {
+    ReadOptions options;
+    options.backend = ReadBackend(backends[b]);
+    double best_seconds = numeric_limits<double>::max();
+    uint64_t line_count = 0;
+    uint64_t byte_count = 0;
+    uint64_t checksum = 0;
+    bool is_uring = false;
+    for (int run = 0; run < repeat; ++run) {
+      if (is_cold) {
+        for (const string &file_name : file_names) {
+          DropCache(file_name);
+        }
+      }
+      auto start = chrono::steady_clock::now();
+      checksum = ReadFiles(file_names, options, is_uring, line_count,
+                           byte_count);
+      chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+      best_seconds = min(best_seconds, seconds.count());
+    }
+    if (b == 0) {
+      expected_lines = line_count;
+      expected_checksum = checksum;
+    } else if (line_count != expected_lines || checksum != expected_checksum) {
+      Die("Backends read different lines.");
+    }
+
+    string name = backends[b];
+    if (name == "io_uring" && !is_uring) {
+      name += " (pread)";  // The kernel does not support io_uring.
+    }
+    cout << name << "\t" << fixed << setprecision(3) << best_seconds << "\t"
+         << setprecision(1) << byte_count / best_seconds / (1 << 20) << "\t"
+         << line_count << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file likelihood.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the Likelihood policies. The
+ * policies are explicitly instantiated for every scalar type at the bottom of
+ * this file.
+ *
+ * See top of likelihood.h for a complete description.
+ */
+#include "likelihood.h"
+
+
+/**
+ * Stores the 16 x 4 alpha frequencies matrix and tabulates the lgamma terms
+ * of the counts below kLogGammaTableSize.
+ *
+ * @param  alphas 16 x 4 Eigen matrix of Dirichlet multinomial alphas.
+ */
+template <typename T>
+void DirichletMultinomialLikelihood<T>::SetAlphas(const Matrix16_4T<T> &alphas) {
+  alphas_ = alphas;
+  count_terms_.resize(kGenotypeCount * kNucleotideCount * kLogGammaTableSize);
+  total_terms_.resize(kGenotypeCount * kLogGammaTableSize);
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    const RowVector4T<T> alpha = alphas_.row(i);
+    const T a = alpha.sum();  // Summed as in DirichletMultinomialLog().
+    for (int n = 0; n < kLogGammaTableSize; ++n) {
+      total_terms_[i * kLogGammaTableSize + n] = lgamma(a) - lgamma(n + a);
+      for (int j = 0; j < kNucleotideCount; ++j) {
+        count_terms_[(i * kNucleotideCount + j) * kLogGammaTableSize + n] = (
+          lgamma(alpha(j) + n) - lgamma(alpha(j))
+        );
+      }
+    }
+  }
+}
+
+/**
+ * Returns the Dirichlet multinomial log probability of the read data given
+ * the genotype. Counts below kLogGammaTableSize are looked up.
+ *
+ * @param  genotype_idx Index of genotype.
+ * @param  data         Read counts.
+ * @return              log_e(P) of the read data.
+ */
+template <typename T>
+T DirichletMultinomialLikelihood<T>::Log(int genotype_idx,
+                                         const ReadData &data) const {
+  const int n = data.reads[0] + data.reads[1] + data.reads[2] + data.reads[3];
+  if (n >= kLogGammaTableSize) {
+    return DirichletMultinomialLog<T>(alphas_.row(genotype_idx), data);
+  }
+  const T constant_term = total_terms_[genotype_idx * kLogGammaTableSize + n];
+  const T *count_terms = &count_terms_[genotype_idx * kNucleotideCount *
+                                       kLogGammaTableSize];
+  T product_term = 0.0;
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    product_term += count_terms[i * kLogGammaTableSize + data.reads[i]];
+  }
+  return constant_term + product_term;
+}
+
+/**
+ * Normalizes the 16 x 4 alpha frequencies matrix into nucleotide frequencies
+ * and caches their logarithms.
+ *
+ * @param  alphas 16 x 4 Eigen matrix of Dirichlet multinomial alphas.
+ */
+template <typename T>
+void MultinomialLikelihood<T>::SetAlphas(const Matrix16_4T<T> &alphas) {
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    log_frequencies_.row(i) = (alphas.row(i) / alphas.row(i).sum()).array().log();
+  }
+}
+
+/**
+ * Returns the multinomial log probability of the read data given the genotype
+ * without the multinomial coefficient.
+ *
+ * @param  genotype_idx Index of genotype.
+ * @param  data         Read counts.
+ * @return              log_e(P) of the read data up to a constant.
+ */
+template <typename T>
+T MultinomialLikelihood<T>::Log(int genotype_idx, const ReadData &data) const {
+  T log_probability = 0.0;
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    log_probability += data.reads[i] * log_frequencies_(genotype_idx, i);
+  }
+  return log_probability;
+}
+
+// Explicit instantiations for every scalar type.
+template class DirichletMultinomialLikelihood<float>;
+template class DirichletMultinomialLikelihood<double>;
+template class DirichletMultinomialLikelihood<long double>;
+template class MultinomialLikelihood<float>;
+template class MultinomialLikelihood<double>;
+template class MultinomialLikelihood<long double>;
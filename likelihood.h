@@ -0,0 +1,67 @@
+/**
+ * @file likelihood.h
+ * @author Melissa Ip
+ *
+ * This file contains the Likelihood policies used by GenericTrioModel to
+ * calculate log P(reads|somatic genotype) in SequencingProbabilityMat().
+ * Each policy caches whatever tables it needs when the alpha frequencies
+ * change, so the per-site cost is only the evaluation.
+ *
+ * DirichletMultinomialLikelihood is the model described in trio_model.h. It
+ * tabulates the lgamma terms of every genotype, nucleotide and count below
+ * kLogGammaTableSize when the alphas are set, so a site only looks up the
+ * terms of its counts. The table entries are the same expressions as in
+ * DirichletMultinomialLog(), so the results do not change, and larger counts
+ * fall back to lgamma. Quality-aware scoring evaluates one policy for each
+ * base quality bin of an individual (see trio_model.h), which the tables keep
+ * near the cost of a single evaluation with lgamma.
+ *
+ * MultinomialLikelihood is the simpler multinomial approximation used by the
+ * infinite sites model branch. It is the limit of the Dirichlet multinomial as
+ * the dispersion grows, needs no lgamma and is log-linear in the counts. The
+ * multinomial coefficient is left out because it is the same for every
+ * genotype of an individual and cancels in MutationProbability().
+ *
+ * A policy is a class template on the scalar type T and must provide:
+ *
+ *   void SetAlphas(const Matrix16_4T<T> &alphas);
+ *   T Log(int genotype_idx, const ReadData &data) const;
+ */
+#ifndef LIKELIHOOD_H
+#define LIKELIHOOD_H
+
+#include "utility.h"
+
+
+// Counts whose lgamma terms are tabulated by DirichletMultinomialLikelihood.
+const int kLogGammaTableSize = 256;
+
+/**
+ * Dirichlet multinomial policy. See top of file for a complete description.
+ */
+template <typename T>
+class DirichletMultinomialLikelihood {
+ public:
+  void SetAlphas(const Matrix16_4T<T> &alphas);
+  T Log(int genotype_idx, const ReadData &data) const;
+
+ private:
+  Matrix16_4T<T> alphas_;
+  vector<T> count_terms_;  // lgamma(alpha + n) - lgamma(alpha) by genotype, nucleotide and n.
+  vector<T> total_terms_;  // lgamma(sum(alpha)) - lgamma(n + sum(alpha)) by genotype and n.
+};
+
+/**
+ * Multinomial policy. See top of file for a complete description.
+ */
+template <typename T>
+class MultinomialLikelihood {
+ public:
+  void SetAlphas(const Matrix16_4T<T> &alphas);
+  T Log(int genotype_idx, const ReadData &data) const;
+
+ private:
+  Matrix16_4T<T> log_frequencies_;  // log(alpha_i / sum(alpha)) for each genotype.
+};
+
+#endif
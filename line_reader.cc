@@ -0,0 +1,413 @@
+/**
+ * @file line_reader.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the LineReader class.
+ *
+ * See top of line_reader.h for a complete description.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "line_reader.h"
+
+
+/**
+ * Returns the read backend of its name, e.g. of the --io-backend flag.
+ *
+ * @param  backend mmap, pread or io_uring.
+ * @return         kMmapBackend, kPreadBackend or kUringBackend.
+ */
+int ReadBackend(const string &backend) {
+  if (backend == "mmap") {
+    return kMmapBackend;
+  } else if (backend == "pread") {
+    return kPreadBackend;
+  } else if (backend == "io_uring") {
+    return kUringBackend;
+  }
+  Die("Read backend must be mmap, pread or io_uring.");
+  return kMmapBackend;
+}
+
+/**
+ * Constructor that opens the file and maps it if it is a regular file that is
+ * not compressed and the backend is mmap, or starts the reads of the io_uring
+ * backend.
+ *
+ * @param  file_name File name or "-" for standard input.
+ * @param  options   Read backend and number of threads that inflate the
+ *                   blocks of a BGZF file.
+ */
+LineReader::LineReader(const string &file_name, const ReadOptions &options)
+    : fd_{-1}, is_mapped_{false}, is_seekable_{false}, map_{nullptr},
+      map_size_{0}, map_offset_{0}, map_end_{0}, prefetch_offset_{0},
+      buffer_begin_{0}, buffer_end_{0}, file_offset_{0},
+      file_end_{numeric_limits<off_t>::max()}, is_eof_{false},
+      line_begin_{0}, block_skip_{0} {
+  if (file_name == "-") {
+    fd_ = STDIN_FILENO;
+  } else {
+    fd_ = open(file_name.c_str(), O_RDONLY);
+  }
+  if (fd_ == -1) {
+    return;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+    is_seekable_ = true;
+    file_offset_ = lseek(fd_, 0, SEEK_CUR);  // Standard input may be a file.
+    map_size_ = file_stat.st_size;
+    if (map_size_ == 0) {
+      is_eof_ = true;
+      return;
+    }
+    char magic[2];
+    if (pread(fd_, magic, 2, file_offset_) == 2 && IsGzipData(magic, 2)) {
+      gzip_.reset(new GzipReader(fd_, true, file_offset_, "",
+                                 options.inflate_threads));
+      buffer_.resize(kReadBufferSize + 1);
+      return;
+    }
+    if (options.backend == kUringBackend) {
+      uring_.reset(new UringReader(fd_, file_offset_, map_size_));
+      if (uring_->is_open()) {
+        buffer_.resize(kUringBlockSize + 1);
+        return;
+      }
+      uring_.reset();  // Falls back to pread().
+    } else if (options.backend == kMmapBackend) {
+      void *map = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (map != MAP_FAILED) {
+        is_mapped_ = true;
+        map_ = static_cast<const char*>(map);
+        map_offset_ = file_offset_ > 0 ? file_offset_ : 0;
+        map_end_ = map_size_;
+        madvise(map, map_size_, MADV_SEQUENTIAL);
+        return;
+      }
+    }
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buffer_.resize(kPreadBufferSize + 1);
+    return;
+  }
+  buffer_.resize(kReadBufferSize + 1);  // Leaves room for a terminator.
+
+  // Checks the first bytes of a pipe for the gzip magic bytes.
+  if (!is_seekable_ && !LineReader::FillBuffer()) {
+    is_eof_ = true;
+  } else if (!is_seekable_ && IsGzipData(buffer_.data(), buffer_end_)) {
+    gzip_.reset(new GzipReader(fd_, false, file_offset_,
+                               string(buffer_.data(), buffer_end_),
+                               options.inflate_threads));
+    buffer_end_ = 0;
+  }
+}
+
+/**
+ * Constructor that limits the reader to the lines that start in a byte range
+ * of a regular file.
+ *
+ * @param  file_name File name.
+ * @param  begin     Offset of the first line.
+ * @param  end       Offset after the last line, e.g. the start of the next
+ *                   line or the file size.
+ * @param  options   Read backend and number of threads that inflate the
+ *                   blocks of a BGZF file.
+ */
+LineReader::LineReader(const string &file_name, off_t begin, off_t end,
+                       const ReadOptions &options)
+    : LineReader(file_name, options) {
+  if (fd_ != -1) {
+    LineReader::SetRange(begin, end);
+  }
+}
+
+/**
+ * Destructor that unmaps and closes the file.
+ */
+LineReader::~LineReader() {
+  gzip_.reset();  // Stops the inflate threads.
+  uring_.reset();  // Waits for the pending reads.
+  if (is_mapped_) {
+    munmap(const_cast<char*>(map_), map_size_);
+  }
+  if (fd_ > STDIN_FILENO) {
+    close(fd_);
+  }
+}
+
+/**
+ * Returns the next line without its newline.
+ *
+ * @param  line View of the next line.
+ * @return      False if there are no lines left.
+ */
+bool LineReader::NextLine(StringView &line) {
+  if (fd_ == -1) {
+    return false;
+  } else if (is_mapped_) {
+    return LineReader::NextMappedLine(line);
+  } else {
+    return LineReader::NextBufferedLine(line);
+  }
+}
+
+/**
+ * Returns the next line of the memory-mapped file and prefetches the next
+ * kPrefetchSize bytes whenever the reader passes half of the prefetched region.
+ *
+ * @param  line View of the next line.
+ * @return      False if there are no lines left.
+ */
+bool LineReader::NextMappedLine(StringView &line) {
+  if (map_offset_ >= map_end_) {
+    return false;
+  }
+
+  if (map_offset_ + kPrefetchSize / 2 >= prefetch_offset_ &&
+      prefetch_offset_ < map_end_) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t begin = max(map_offset_, prefetch_offset_) / page_size * page_size;
+    size_t end = min(begin + kPrefetchSize, map_end_);
+    madvise(const_cast<char*>(map_) + begin, end - begin, MADV_WILLNEED);
+    prefetch_offset_ = end;
+  }
+
+  const char *begin = map_ + map_offset_;
+  size_t remaining = map_end_ - map_offset_;
+  line_begin_ = map_offset_;
+  const char *newline = static_cast<const char*>(memchr(begin, '\n', remaining));
+  if (newline != nullptr) {
+    line = StringView(begin, newline - begin);
+    map_offset_ += line.size + 1;
+  } else {
+    // The last line has no newline, so it is copied to add a terminator.
+    last_line_.assign(begin, remaining);
+    line = StringView(last_line_.data(), last_line_.size());
+    map_offset_ = map_end_;
+  }
+  return true;
+}
+
+/**
+ * Returns the next line from the buffer and refills the buffer whenever it
+ * does not hold a complete line. The buffer grows for lines that are longer
+ * than the buffer.
+ *
+ * @param  line View of the next line.
+ * @return      False if there are no lines left.
+ */
+bool LineReader::NextBufferedLine(StringView &line) {
+  while (true) {
+    if (is_eof_ && buffer_begin_ == buffer_end_) {
+      return false;
+    }
+    char *begin = buffer_.data() + buffer_begin_;
+    size_t remaining = buffer_end_ - buffer_begin_;
+    char *newline = static_cast<char*>(memchr(begin, '\n', remaining));
+    line_begin_ = buffer_begin_;
+    if (newline != nullptr) {
+      line = StringView(begin, newline - begin);
+      buffer_begin_ += line.size + 1;
+      return true;
+    }
+    if (is_eof_) {
+      begin[remaining] = '\0';  // Terminates a last line without newline.
+      line = StringView(begin, remaining);
+      buffer_begin_ = buffer_end_;
+      return true;
+    }
+    if (!LineReader::FillBuffer()) {
+      is_eof_ = true;
+    }
+  }
+}
+
+/**
+ * Moves the incomplete line to the front of the buffer and reads more data
+ * after it with pread() or read(), or inflates more data if the file is
+ * compressed.
+ *
+ * @return  False if the end of the file is reached.
+ */
+bool LineReader::FillBuffer() {
+  if (!buffer_blocks_.empty()) {
+    // Drops the BGZF blocks that end before the incomplete line.
+    size_t first = 0;
+    while (first + 1 < buffer_blocks_.size() &&
+           buffer_blocks_[first + 1].first <= (ssize_t) buffer_begin_) {
+      first++;
+    }
+    buffer_blocks_.erase(buffer_blocks_.begin(),
+                         buffer_blocks_.begin() + first);
+    for (pair<ssize_t, off_t> &block : buffer_blocks_) {
+      block.first -= buffer_begin_;
+    }
+  }
+  size_t remaining = buffer_end_ - buffer_begin_;
+  memmove(buffer_.data(), buffer_.data() + buffer_begin_, remaining);
+  buffer_begin_ = 0;
+  buffer_end_ = remaining;
+  if (buffer_end_ + 1 == buffer_.size()) {
+    buffer_.resize(2 * buffer_.size() - 1);
+  }
+  if (gzip_) {
+    return LineReader::FillCompressedBuffer();
+  } else if (uring_) {
+    return LineReader::FillUringBuffer();
+  }
+
+  size_t capacity = buffer_.size() - 1 - buffer_end_;
+  if (file_offset_ >= file_end_) {
+    return false;
+  } else if (file_end_ - file_offset_ < (off_t) capacity) {
+    capacity = file_end_ - file_offset_;
+  }
+  ssize_t bytes = 0;
+  do {
+    if (is_seekable_) {
+      bytes = pread(fd_, buffer_.data() + buffer_end_, capacity, file_offset_);
+    } else {
+      bytes = read(fd_, buffer_.data() + buffer_end_, capacity);
+    }
+  } while (bytes == -1 && errno == EINTR);
+  if (bytes == -1) {
+    Die("Input file cannot be read.");
+  }
+  buffer_end_ += bytes;
+  file_offset_ += bytes;
+  return bytes > 0;
+}
+
+/**
+ * Inflates blocks of the compressed file into the buffer after the incomplete
+ * line. The buffer positions of BGZF blocks are kept, so line_offset() can
+ * return virtual offsets, and blocks are cut at the ends of the range.
+ *
+ * @return  False if the end of the file or range is reached.
+ */
+bool LineReader::FillCompressedBuffer() {
+  if (buffer_.size() - 1 - buffer_end_ < kGzipBlockSize) {
+    buffer_.resize(buffer_end_ + kGzipBlockSize + 1);
+  }
+  const size_t filled = buffer_end_;
+  StringView block;
+  off_t block_offset = -1;
+  while (file_offset_ < file_end_ &&
+         buffer_.size() - 1 - buffer_end_ >= kGzipBlockSize) {
+    if (!gzip_->NextBlock(block, block_offset)) {
+      file_offset_ = file_end_;
+      break;
+    }
+    size_t skip = 0;
+    size_t size = block.size;
+    if (block_offset != -1) {
+      skip = min(block_skip_, size);  // Data before the start of the range.
+      block_skip_ = 0;
+      off_t virtual_offset = block_offset << 16;
+      if (file_end_ - virtual_offset <= (off_t) size) {
+        size = max(file_end_ - virtual_offset, (off_t) skip);
+        file_offset_ = file_end_;
+      }
+      buffer_blocks_.emplace_back((ssize_t) buffer_end_ - skip, block_offset);
+    }
+    memcpy(buffer_.data() + buffer_end_, block.data + skip, size - skip);
+    buffer_end_ += size - skip;
+  }
+  return buffer_end_ > filled;
+}
+
+/**
+ * Copies the next block that io_uring read after the incomplete line.
+ *
+ * @return  False if the end of the range is reached.
+ */
+bool LineReader::FillUringBuffer() {
+  StringView block;
+  if (!uring_->NextBlock(block)) {
+    return false;
+  }
+  if (buffer_.size() - 1 - buffer_end_ < block.size) {
+    buffer_.resize(buffer_end_ + block.size + 1);
+  }
+  memcpy(buffer_.data() + buffer_end_, block.data, block.size);
+  buffer_end_ += block.size;
+  file_offset_ += block.size;
+  return true;
+}
+
+/**
+ * Moves the reader to the lines that start in a byte range of a regular file,
+ * e.g. the next region of a BED file. Lines before the call are invalid.
+ *
+ * @param  begin Offset of the first line.
+ * @param  end   Offset after the last line, e.g. the start of the next line or
+ *               the file size. Offsets in BGZF files are virtual offsets.
+ */
+void LineReader::SetRange(off_t begin, off_t end) {
+  if (!is_seekable_) {
+    Die("Only regular files can be read by byte range.");
+  }
+  if (is_mapped_) {
+    map_offset_ = min((size_t) begin, map_size_);
+    map_end_ = min((size_t) end, map_size_);
+    prefetch_offset_ = map_offset_;
+  } else {
+    buffer_begin_ = 0;
+    buffer_end_ = 0;
+    file_offset_ = begin;
+    file_end_ = end;
+    is_eof_ = map_size_ == 0;
+    if (gzip_) {
+      buffer_blocks_.clear();
+      block_skip_ = begin & 0xffff;
+      gzip_->Seek(begin >> 16, end > begin ? (end - 1) >> 16 : -1);
+    } else if (uring_) {
+      uring_->Seek(begin, max(begin, min(end, (off_t) map_size_)));
+    }
+  }
+}
+
+/**
+ * Returns the offset of the last line that NextLine() returned. The offset in
+ * a BGZF file is a virtual offset.
+ *
+ * @return  Offset of the line or -1 if the file is compressed but not BGZF.
+ */
+off_t LineReader::line_offset() const {
+  if (is_mapped_) {
+    return line_begin_;
+  } else if (!gzip_) {
+    return file_offset_ - (off_t) (buffer_end_ - line_begin_);
+  }
+  for (auto it = buffer_blocks_.rbegin(); it != buffer_blocks_.rend(); ++it) {
+    if (it->first <= (ssize_t) line_begin_) {
+      return (it->second << 16) + (line_begin_ - it->first);
+    }
+  }
+  return -1;
+}
+
+bool LineReader::is_open() const {
+  return fd_ != -1;
+}
+
+bool LineReader::is_mapped() const {
+  return is_mapped_;
+}
+
+bool LineReader::is_compressed() const {
+  return gzip_ != nullptr;
+}
+
+bool LineReader::is_bgzf() const {
+  return gzip_ && gzip_->is_bgzf();
+}
+
+bool LineReader::is_uring() const {
+  return uring_ != nullptr;
+}
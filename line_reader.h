@@ -0,0 +1,135 @@
+/**
+ * @file line_reader.h
+ * @author Melissa Ip
+ *
+ * The LineReader class yields the lines of a text file as StringView objects
+ * without copying them into strings. Regular files are memory-mapped with
+ * madvise(MADV_SEQUENTIAL), and the next kPrefetchSize bytes are requested
+ * with MADV_WILLNEED as the reader advances, so the kernel reads ahead in
+ * large blocks. Pipes and other files that cannot be mapped are read through a
+ * buffer with pread(), or read() if the file is not seekable.
+ *
+ * Regular files that are not compressed are read with one of three backends,
+ * which is selected for each reader with ReadOptions, so each host can use the
+ * fastest backend for its storage (see io_bench.cc):
+ *
+ *   mmap      Memory-mapped as above (default), e.g. for page-cache-hot
+ *             reruns.
+ *   pread     Read through a buffer of kPreadBufferSize bytes with pread(),
+ *             e.g. for network filesystems that map poorly.
+ *   io_uring  Read with a deep queue of reads ahead of the parser (see
+ *             uring_reader.h), e.g. on NVMe drives. Falls back to pread if
+ *             the kernel does not support io_uring.
+ *
+ * Files that start with the gzip magic bytes are inflated by a GzipReader
+ * (see gzip_reader.h) into the buffer instead, with BGZF blocks inflated in
+ * parallel by the inflate_threads threads of ReadOptions.
+ *
+ * A reader can also be limited to the lines that start in a byte range of a
+ * regular file, e.g. a shard of a pileup file (see pileup_shard.h). The range
+ * must begin and end at the start of a line. Offsets in BGZF files are virtual
+ * offsets.
+ *
+ * Every line excludes its newline and is followed in memory by a '\n' or '\0',
+ * so strtod() and strtol() can parse its fields in place. A line is valid until
+ * the next call to NextLine().
+ *
+ * Example usage:
+ *
+ *   ReadOptions options;
+ *   options.backend = ReadBackend("pread");
+ *   LineReader reader("probabilities.txt", options);
+ *   StringView line;
+ *   while (reader.NextLine(line)) {
+ *     double probability = strtod(line.data, nullptr);
+ *   }
+ */
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <sys/types.h>
+
+#include "gzip_reader.h"
+#include "uring_reader.h"
+#include "utility.h"
+
+
+// Number of bytes that are prefetched ahead of a memory-mapped reader.
+const size_t kPrefetchSize = 64 << 20;
+
+// Initial buffer size of a reader that does not map its file.
+const size_t kReadBufferSize = 1 << 20;
+
+// Initial buffer size of a reader of a regular file with the pread backend.
+const size_t kPreadBufferSize = 16 << 20;
+
+// Read backends of regular files that are not compressed.
+const int kMmapBackend = 0;
+const int kPreadBackend = 1;
+const int kUringBackend = 2;
+
+/**
+ * Options of how a LineReader reads its file, e.g. set by the --io-backend and
+ * --inflate-threads flags of the drivers.
+ */
+struct ReadOptions {
+  ReadOptions() : backend{kMmapBackend}, inflate_threads{0} {}
+  int backend;  // Backend of a regular file that is not compressed.
+  int inflate_threads;  // Threads that inflate the blocks of a BGZF file.
+};
+
+/**
+ * LineReader class header. See top of file for a complete description.
+ */
+class LineReader {
+ public:
+  LineReader(const string &file_name,
+             const ReadOptions &options=ReadOptions());  // "-" reads standard input.
+  LineReader(const string &file_name, off_t begin, off_t end,
+             const ReadOptions &options=ReadOptions());  // Lines in [begin, end).
+  ~LineReader();
+  bool NextLine(StringView &line);  // False at the end of the file.
+  void SetRange(off_t begin, off_t end);  // Lines in [begin, end) of a regular file.
+  off_t line_offset() const;  // Offset of the last line, -1 if it has none.
+  bool is_open() const;
+  bool is_mapped() const;
+  bool is_compressed() const;
+  bool is_bgzf() const;  // True if compressed lines have offsets.
+  bool is_uring() const;  // True if the file is read with io_uring.
+
+ private:
+  LineReader(const LineReader &other);  // Not copyable.
+  LineReader& operator=(const LineReader &other);
+  bool NextMappedLine(StringView &line);
+  bool NextBufferedLine(StringView &line);
+  bool FillBuffer();
+  bool FillCompressedBuffer();
+  bool FillUringBuffer();
+
+  // Instance member variables.
+  int fd_;
+  bool is_mapped_;
+  bool is_seekable_;
+  const char *map_;  // Memory-mapped file.
+  size_t map_size_;
+  size_t map_offset_;  // Start of the next line.
+  size_t map_end_;  // End of the mapped lines that are read.
+  size_t prefetch_offset_;  // End of the prefetched region.
+  string last_line_;  // Copy of a last line without newline.
+  vector<char> buffer_;  // Buffered reads.
+  size_t buffer_begin_;  // Start of the next line.
+  size_t buffer_end_;  // End of the data read so far.
+  off_t file_offset_;  // Offset of the next pread().
+  off_t file_end_;  // End of the buffered lines that are read.
+  bool is_eof_;
+  size_t line_begin_;  // Start of the last line in the map or buffer.
+  unique_ptr<GzipReader> gzip_;  // Inflates a compressed file.
+  vector<pair<ssize_t, off_t>> buffer_blocks_;  // Buffer position and compressed offset of BGZF blocks.
+  size_t block_skip_;  // Bytes of the next BGZF block before the range.
+  unique_ptr<UringReader> uring_;  // Reads a regular file with io_uring.
+};
+
+// Forward declarations.
+int ReadBackend(const string &backend);
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file lru_cache.h
+ * @author Melissa Ip
+ *
+ * The LruCache class template is a small keyed pool of precomputed values with
+ * least recently used eviction. It is used to cache matrices that depend on a
+ * quantized site-specific parameter, so a parameter that varies from site to
+ * site only costs a lookup once its values have been computed.
+ *
+ * Values are kept in at most capacity slots that are filled on demand with
+ * Eigen::aligned_allocator, because fixed-size Eigen matrices must be aligned.
+ * Once full, the slot of the least recently used value is overwritten. Pointers
+ * returned by Find() and Insert() must not be kept across the next Insert().
+ *
+ * Example usage:
+ *
+ *   LruCache<long, Matrix16_256d> cache(64);
+ *   Matrix16_256d *mat = cache.Find(key);
+ *   if (mat == nullptr) {
+ *     mat = &cache.Insert(key, ComputeMatrix(key));
+ *   }
+ *
+ * The template is defined in this header because Value can be any type.
+ */
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "Eigen/Core"
+
+using namespace std;
+
+
+/**
+ * LruCache class template header. See top of file for a complete description.
+ */
+template <typename Key, typename Value>
+class LruCache {
+ public:
+  LruCache(int capacity);
+  Value* Find(const Key &key);  // Returns nullptr if key is not cached.
+  Value& Insert(const Key &key, const Value &value);  // Evicts the least recently used value if full.
+  void Clear();
+  int size() const;
+  int capacity() const;
+
+ private:
+  void Unlink(int slot);  // Helper functions for the recency list.
+  void PushFront(int slot);
+
+  // Instance member variables.
+  size_t capacity_;
+  size_t size_;
+  int head_;  // Most recently used slot.
+  int tail_;  // Least recently used slot.
+  vector<Key> keys_;
+  vector<int> prev_;
+  vector<int> next_;
+  vector<Value, Eigen::aligned_allocator<Value>> values_;
+  unordered_map<Key, int> index_;  // Key to slot.
+};
+
+/**
+ * Constructor that reserves the slots without constructing any values.
+ *
+ * @param  capacity Maximum number of cached values. Must at least be 1.
+ */
+template <typename Key, typename Value>
+LruCache<Key, Value>::LruCache(int capacity)
+    : capacity_(capacity), size_{0}, head_{-1}, tail_{-1},
+      keys_(capacity), prev_(capacity, -1), next_(capacity, -1) {
+  values_.reserve(capacity);
+  index_.reserve(capacity);
+}
+
+/**
+ * Looks up a key and marks it as most recently used.
+ *
+ * @param  key Key of the value.
+ * @return     Pointer to the cached value or nullptr if key is not cached.
+ */
+template <typename Key, typename Value>
+Value* LruCache<Key, Value>::Find(const Key &key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  int slot = it->second;
+  if (slot != head_) {
+    LruCache::Unlink(slot);
+    LruCache::PushFront(slot);
+  }
+  return &values_[slot];
+}
+
+/**
+ * Inserts a value that is not cached yet as the most recently used value. If
+ * the cache is full, the slot of the least recently used value is reused.
+ *
+ * @param  key   Key of the value.
+ * @param  value Value to be cached.
+ * @return       Reference to the cached value.
+ */
+template <typename Key, typename Value>
+Value& LruCache<Key, Value>::Insert(const Key &key, const Value &value) {
+  int slot = 0;
+  if (size_ < capacity_) {
+    if (size_ < values_.size()) {
+      values_[size_] = value;  // Reuses a slot left by Clear().
+    } else {
+      values_.push_back(value);
+    }
+    slot = size_++;
+  } else {
+    slot = tail_;
+    index_.erase(keys_[slot]);
+    LruCache::Unlink(slot);
+    values_[slot] = value;
+  }
+  keys_[slot] = key;
+  index_[key] = slot;
+  LruCache::PushFront(slot);
+  return values_[slot];
+}
+
+/**
+ * Removes all cached values. The slots stay allocated and are reused.
+ */
+template <typename Key, typename Value>
+void LruCache<Key, Value>::Clear() {
+  index_.clear();
+  size_ = 0;
+  head_ = -1;
+  tail_ = -1;
+}
+
+/**
+ * Removes a slot from the recency list.
+ *
+ * @param  slot Index of slot.
+ */
+template <typename Key, typename Value>
+void LruCache<Key, Value>::Unlink(int slot) {
+  if (prev_[slot] != -1) {
+    next_[prev_[slot]] = next_[slot];
+  } else {
+    head_ = next_[slot];
+  }
+  if (next_[slot] != -1) {
+    prev_[next_[slot]] = prev_[slot];
+  } else {
+    tail_ = prev_[slot];
+  }
+  prev_[slot] = -1;
+  next_[slot] = -1;
+}
+
+/**
+ * Adds a slot to the front of the recency list.
+ *
+ * @param  slot Index of slot.
+ */
+template <typename Key, typename Value>
+void LruCache<Key, Value>::PushFront(int slot) {
+  prev_[slot] = -1;
+  next_[slot] = head_;
+  if (head_ != -1) {
+    prev_[head_] = slot;
+  }
+  head_ = slot;
+  if (tail_ == -1) {
+    tail_ = slot;
+  }
+}
+
+template <typename Key, typename Value>
+int LruCache<Key, Value>::size() const {
+  return size_;
+}
+
+template <typename Key, typename Value>
+int LruCache<Key, Value>::capacity() const {
+  return capacity_;
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file multi_pileup.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the MultiPileupReader class.
+ *
+ * See top of multi_pileup.h for a complete description.
+ */
+#include "multi_pileup.h"
+
+
+/**
+ * Constructor that skips the leading lines with a N reference and reads the
+ * first valid line.
+ *
+ * @param  reader  Reader of the multi-sample pileup.
+ * @param  samples Index of the child, mother and father in the samples of the
+ *                 pileup.
+ */
+MultiPileupReader::MultiPileupReader(LineReader &reader,
+                                     const vector<int> &samples)
+    : reader_{&reader}, has_line_{false}, position_{0},
+      quality_bins_{nullptr} {
+  if (samples.size() != kIndividualCount) {
+    Die("Expected one sample for each of child, mother and father.");
+  }
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (samples[i] < 0) {
+      Die("Sample index must not be negative.");
+    }
+    samples_[i] = samples[i];
+  }
+
+  StringView line;
+  if (!TrimHeader(*reader_, line)) {
+    Die("Pileup file does not contain valid sequences (no N reference).");
+  }
+  if (!ParseMultiPileupLine(line.data, line.size, line_)) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  has_line_ = true;
+}
+
+/**
+ * Reads the next line and counts the bases of the child, mother and father.
+ *
+ * @param  site Reads of the position.
+ * @return      False once the file is exhausted.
+ */
+bool MultiPileupReader::NextSite(TrioSite &site) {
+  if (has_line_) {
+    has_line_ = false;
+  } else {
+    StringView line;
+    if (!reader_->NextLine(line)) {
+      return false;
+    }
+    if (!ParseMultiPileupLine(line.data, line.size, line_)) {
+      Die("Pileup line does not have the pileup columns.");
+    }
+  }
+  MultiPileupReader::ReadSite(site);
+  return true;
+}
+
+const string& MultiPileupReader::contig() const {
+  return contig_;
+}
+
+/**
+ * Counts the reads of each base quality bin of the trio into
+ * TrioSite::binned_vec in NextSite(), besides the reads of data_vec.
+ *
+ * @param  bins Quality bins. Must outlive the reader.
+ */
+void MultiPileupReader::SetQualityBins(const QualityBins &bins) {
+  quality_bins_ = &bins;
+}
+
+/**
+ * Checks the order of the current line and counts the bases of the samples of
+ * the trio.
+ *
+ * @param  site Reads of the position.
+ */
+void MultiPileupReader::ReadSite(TrioSite &site) {
+  if (contig_.size() == line_.contig.size &&
+      memcmp(contig_.data(), line_.contig.data, line_.contig.size) == 0) {
+    if (line_.position <= position_) {
+      Die("Pileup file is not sorted by position.");
+    }
+  } else {
+    if (!contig_.empty()) {
+      finished_contigs_.insert(contig_);
+    }
+    contig_.assign(line_.contig.data, line_.contig.size);
+    if (finished_contigs_.count(contig_) > 0) {
+      Die("Pileup file does not have its contigs in order.");
+    }
+  }
+  position_ = line_.position;
+
+  site.contig = StringView(contig_.data(), contig_.size());
+  site.position = line_.position;
+  site.ref_nucleotide = line_.ref_nucleotide;
+  site.data_vec.resize(kIndividualCount);
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (static_cast<size_t>(samples_[i]) >= line_.samples.size()) {
+      Die("Pileup line does not have a column of every sample of the trio.");
+    }
+    site.data_vec[i] = CountBases(line_.samples[samples_[i]].bases,
+                                  line_.ref_nucleotide);
+  }
+  if (quality_bins_ != nullptr) {
+    const int bin_count = quality_bins_->min_qualities.size();
+    site.binned_vec.resize(kIndividualCount * bin_count);
+    for (int i = 0; i < kIndividualCount; ++i) {
+      const PileupSample &sample = line_.samples[samples_[i]];
+      CountBinnedBases(sample.bases, sample.qualities, line_.ref_nucleotide,
+                       *quality_bins_, &site.binned_vec[i * bin_count]);
+    }
+  }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file multi_pileup.h
+ * @author Melissa Ip
+ *
+ * The MultiPileupReader class reads the child, mother and father from one
+ * multi-sample pileup, as written by samtools mpileup with the BAM files of
+ * several samples:
+ *
+ *   samtools mpileup -f ref.fa child.bam mother.bam father.bam |
+ *       pileup_driver output.txt - --mpileup
+ *
+ * Each line already has every sample at its position, so the lines are not
+ * merged like separate pileup files (see pileup_merger.h), and a single stream
+ * is parsed once. The stream may be standard input ("-") or a FIFO, so the
+ * upstream tool and pileup_driver run as one pipe without intermediate files.
+ *
+ * The samples are mapped to their roles by their index in the columns of the
+ * pileup, i.e. the order of the BAM files, so the pileup may have other
+ * samples, e.g. siblings, and the trio may be in any order. Samples without
+ * coverage at a position, whose bases column is * or empty, get reads of zero.
+ * As with separate pileup files, the leading lines with a N reference are
+ * skipped, positions must be sorted within a contig, and a contig must not
+ * return after another contig. As with PileupMerger, SetQualityBins() also
+ * counts the reads of each base quality bin into binned_vec.
+ *
+ * Example usage:
+ *
+ *   LineReader reader("-");  // Standard input.
+ *   MultiPileupReader pileup(reader, {2, 0, 1});  // Child is the third sample.
+ *   TrioSite site;
+ *   while (pileup.NextSite(site)) {
+ *     double probability = params.MutationProbability(site.data_vec);
+ *   }
+ */
+#ifndef MULTI_PILEUP_H
+#define MULTI_PILEUP_H
+
+#include <set>
+
+#include "line_reader.h"
+#include "pileup_merger.h"
+
+
+/**
+ * MultiPileupReader class header. See top of file for a complete description.
+ */
+class MultiPileupReader {
+ public:
+  MultiPileupReader(LineReader &reader, const vector<int> &samples);
+  bool NextSite(TrioSite &site);  // False once the file is exhausted.
+  const string& contig() const;  // Contig of the last site.
+  void SetQualityBins(const QualityBins &bins);  // Also counts binned reads.
+
+ private:
+  void ReadSite(TrioSite &site);
+
+  // Instance member variables.
+  LineReader *reader_;
+  int samples_[kIndividualCount];  // Sample index of child, mother and father.
+  MultiPileupSite line_;  // Columns of the current line.
+  bool has_line_;  // True if the first line is read but not returned.
+  string contig_;  // Contig of the last site.
+  int position_;  // Position of the last site.
+  set<string> finished_contigs_;  // Contigs before the current contig.
+  const QualityBins *quality_bins_;  // Bins of binned_vec or nullptr.
+};
+
+#endif
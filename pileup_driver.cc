@@ -4,32 +4,318 @@
  *
  * This file accepts 3 input pileup files. The pileup data is read and parsed
  * into sequencing read data that the TrioModel can process. Default parameter
- * values are used. Assume that all pileup files have the same number of sites
- * and thus can be aligned.
+ * values are used. The files are merged on (contig, position), so each file
+ * may omit the positions without coverage (see pileup_merger.h).
  * 
  * To compile on Herschel without using cmake and include GSL:
- * c++ -std=c++11 -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o pileup_driver pileup_utility.cc pileup_driver.cc
+ * c++ -std=c++11 -pthread -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o pileup_driver utility.cc read_dependent_data.cc likelihood.cc trio_model.cc unordered_trio_model.cc track_reader.cc rate_track.cc frequency_track.cc pileup_parser.cc gzip_reader.cc uring_reader.cc line_reader.cc pileup_merger.cc multi_pileup.cc sam_pileup.cc scan_checkpoint.cc trio_counts.cc distinct_trios.cc result_store.cc site_writer.cc pileup_pipeline.cc pileup_shard.cc pileup_index.cc pileup_utility.cc pileup_driver.cc -lz
  *
  * To run this file, provide the following command line inputs:
- * ./pileup_driver <output>.txt <child>.pileup <mother>.pileup <father>.pileup
+ * ./pileup_driver <output>.txt <child>.pileup <mother>.pileup <father>.pileup [options]
+ * ./pileup_driver <output>.txt <counts>.trio --trio-counts [options]
+ * samtools mpileup ... | ./pileup_driver <output>.txt - --mpileup [options]
+ *
+ * Options:
+ *   --unordered    Scores on the 10 unordered genotypes (UnorderedTrioModel).
+ *   --multinomial  Uses the cheaper multinomial likelihood instead of the
+ *                  Dirichlet multinomial, e.g. for screening passes.
+ *   --float        Scores with float matrices for bulk screening.
+ *   --long-double  Scores with long double matrices as a high-precision
+ *                  reference.
+ *   --rate-track <rates>.bed
+ *                  Scores each site with the germline mutation rate of its
+ *                  interval in the track (see rate_track.h). Matrices of each
+ *                  quantized rate are built once and cached.
+ *   --sequencing-error-rates <child>,<mother>,<father>
+ *   --dirichlet-dispersions <child>,<mother>,<father>
+ *                  Sets the parameters of each individual, e.g. if the family
+ *                  members were sequenced on different runs.
+ *   --quality-bins <q1>,<q2>,...
+ *                  Counts the bases of each base quality bin separately and
+ *                  scores them with the error rate of their bin, e.g. 20,30
+ *                  for the bins below 20, below 30 and 30 and above, so
+ *                  low-quality bases raise fewer false positives (see
+ *                  trio_model.h). Needs the qualities column of the pileups.
+ *                  Cannot be used with SAM files, trio counts, distinct trios
+ *                  or the pipeline.
+ *   --reference-priors
+ *                  Conditions the population priors on the reference
+ *                  nucleotide of each site.
+ *   --frequencies <frequencies>.txt
+ *                  Uses population priors of the allele frequencies of known
+ *                  polymorphic sites (see frequency_track.h). The parent
+ *                  genotypes are in Hardy-Weinberg proportions of the
+ *                  frequencies. Priors of each quantized frequency vector are
+ *                  computed once and cached.
+ *   --parse-threads <n>
+ *   --score-threads <n>
+ *                  Scores with a pipeline of n threads that count the bases
+ *                  and n threads that calculate the probabilities, e.g. 4 and
+ *                  28 on a 32-core node (see pileup_pipeline.h). The output is
+ *                  the same as that of a single-threaded run.
+ *   --shard-threads <n>
+ *                  Splits the pileup files into shards of about the same size
+ *                  and scans them with n threads that each read their own
+ *                  shards (see pileup_shard.h), e.g. on NVMe arrays. The
+ *                  files must be regular files. Overrides the pipeline flags.
+ *   --regions <regions>.bed
+ *                  Scores only the sites in the regions of a BED file, e.g.
+ *                  exome targets, and reads only their lines with the index of
+ *                  each pileup file, which is built by pileup_index_driver.
+ *                  The regions must be in the order of the pileup files.
+ *                  Overrides --shard-threads.
+ *   --inflate-threads <n>
+ *                  Inflates the blocks of BGZF compressed pileup files with
+ *                  n threads for each file (see gzip_reader.h). Pileup files
+ *                  that are gzip compressed are read without this flag, but
+ *                  only bgzip files are inflated in parallel and can be
+ *                  indexed. Compressed files cannot be split into shards.
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Reads regular files that are not compressed with memory
+ *                  maps (default), large pread() buffers or a deep queue of
+ *                  io_uring reads (see line_reader.h). io_bench compares the
+ *                  backends on the same inputs. The output does not depend on
+ *                  the backend.
+ *   --sam          Reads coordinate-sorted SAM files instead of pileup files
+ *                  and counts the bases of their alignments at each position
+ *                  (see sam_pileup.h), so samtools mpileup does not need to be
+ *                  run. SAM files are scored on one thread and cannot be read
+ *                  by region.
+ *   --min-mapping-quality <q>
+ *   --min-base-quality <q>
+ *                  Skips SAM alignments below mapping quality q and does not
+ *                  count SAM bases below base quality q, e.g. 20 and 13.
+ *   --output-format <sites|vcf|probabilities|binary|histogram>
+ *                  Writes each site with its position, reference and counts,
+ *                  as VCF-like lines, only its probability as in earlier
+ *                  versions (default), to a columnar binary file that
+ *                  result_query reads, or as a histogram of distinct trios
+ *                  with --distinct-trios (see site_writer.h).
+ *   --top-sites <k>
+ *                  Writes only the k sites with the highest probabilities, in
+ *                  the order of the files, e.g. for triage of a genome. The
+ *                  sites are kept in a heap of k sites for each shard, so
+ *                  memory does not grow with the number of sites, and sites
+ *                  below the lowest kept site are not written once the heap
+ *                  is full (see site_writer.h). Every site is still scored.
+ *                  Cannot be used with histogram output or checkpoints.
+ *   --distinct-trios
+ *                  Counts the distinct child, mother and father reads of the
+ *                  sites first and scores each of them once with the shard or
+ *                  score threads (see distinct_trios.h), e.g. for whole-genome
+ *                  summaries. With --output-format histogram, only the
+ *                  distinct trios are written with their probabilities and
+ *                  numbers of sites. Cannot be used with a rate track or
+ *                  frequencies.
+ *   --trio-counts  Scores the sites of a trio count file that trio_convert
+ *                  wrote from the pileups, instead of parsing the pileups
+ *                  again (see trio_counts.h). Its records are split into
+ *                  shards with --shard-threads.
+ *   --mpileup      Reads the trio from one multi-sample pileup of samtools
+ *                  mpileup, which may be standard input (-) or a FIFO, so
+ *                  samtools and pileup_driver run as one pipe (see
+ *                  multi_pileup.h). Scored on one thread without regions.
+ *   --samples <child>,<mother>,<father>
+ *                  Indices of the samples of the trio in the multi-sample
+ *                  pileup, i.e. in the order of the BAM files given to
+ *                  samtools, starting at 0. Defaults to 0,1,2.
+ *   --checkpoint <seconds>
+ *                  Writes the output to <output>.partial and a checkpoint of
+ *                  the scan to <output>.checkpoint every <seconds> (see
+ *                  scan_checkpoint.h), e.g. on preemptible nodes. The output
+ *                  is renamed once the scan is complete. Works with single
+ *                  and shard scans of uncompressed or BGZF files and with
+ *                  shard scans of trio count files.
+ *   --resume       Continues the partial output from its checkpoint if there
+ *                  is one, with the same inputs and options as the stopped
+ *                  run. The output is the same as that of an uninterrupted
+ *                  run. Writes checkpoints every 300 seconds unless
+ *                  --checkpoint is given.
  *
  * See top of pileup_utility.h for additional information.
  */
 #include "pileup_utility.h"
 
 
+/**
+ * Parses comma separated values of the child, mother and father. Dies if a
+ * value is not a number.
+ *
+ * @param  arg Command line argument such as 0.005,0.01,0.005.
+ * @return     Values in order of child, mother and father.
+ */
+vector<double> ParseIndividualValues(const string &arg) {
+  vector<double> values;
+  stringstream str(arg);
+  string value;
+  while (getline(str, value, ',')) {
+    char *value_end = nullptr;
+    values.push_back(strtod(value.c_str(), &value_end));
+    if (value.empty() || *value_end != '\0') {
+      Die("Expected a number for each of child, mother and father.");
+    }
+  }
+  if (values.size() != kIndividualCount) {
+    Die("Expected one value for each of child, mother and father.");
+  }
+  return values;
+}
+
+/**
+ * Parses the comma separated Phred qualities that start the quality bins.
+ *
+ * @param  arg Command line argument such as 20,30.
+ * @return     Qualities that start each bin after the first.
+ */
+vector<int> ParseQualityBins(const string &arg) {
+  vector<int> thresholds;
+  stringstream str(arg);
+  string threshold;
+  while (getline(str, threshold, ',')) {
+    thresholds.push_back(stoi(threshold));
+  }
+  return thresholds;
+}
+
+/**
+ * Parses the comma separated sample indices of the child, mother and father.
+ *
+ * @param  arg Command line argument such as 2,0,1.
+ * @return     Sample indices in order of child, mother and father.
+ */
+vector<int> ParseSamples(const string &arg) {
+  vector<int> samples;
+  stringstream str(arg);
+  string sample;
+  while (getline(str, sample, ',')) {
+    samples.push_back(stoi(sample));
+  }
+  if (samples.size() != kIndividualCount) {
+    Die("Expected one sample for each of child, mother and father.");
+  }
+  return samples;
+}
+
 int main(int argc, const char *argv[]) {
-  if (argc < 5) {
+  const bool is_trio_counts = find(argv + 1, argv + argc,
+                                   string("--trio-counts")) != argv + argc;
+  const bool is_mpileup = find(argv + 1, argv + argc,
+                               string("--mpileup")) != argv + argc;
+  const int input_count = is_trio_counts || is_mpileup ? 1 : kIndividualCount;
+  if (argc < 2 + input_count) {
     Die("USAGE: pileup_driver <output>.txt <child>.pileup <mother>.pileup "
-        "<father>.pileup");
+        "<father>.pileup [--unordered] [--multinomial] "
+        "[--float | --long-double] [--rate-track <rates>.bed] "
+        "[--sequencing-error-rates <c>,<m>,<f>] "
+        "[--dirichlet-dispersions <c>,<m>,<f>] [--quality-bins <q>,...] "
+        "[--reference-priors] "
+        "[--frequencies <frequencies>.txt] [--parse-threads <n>] "
+        "[--score-threads <n>] [--shard-threads <n>] "
+        "[--regions <regions>.bed] [--inflate-threads <n>] "
+        "[--io-backend <mmap|pread|io_uring>] [--sam] "
+        "[--min-mapping-quality <q>] [--min-base-quality <q>] "
+        "[--output-format <sites|vcf|probabilities|binary|histogram>] "
+        "[--top-sites <k>] [--distinct-trios] [--checkpoint <seconds>] "
+        "[--resume]\n"
+        "       pileup_driver <output>.txt <counts>.trio --trio-counts "
+        "[options]\n"
+        "       pileup_driver <output>.txt <mpileup|-> --mpileup "
+        "[--samples <c>,<m>,<f>] [options]");
   }
 
   const string file_name = argv[1];
   const string child_pileup = argv[2];
-  const string mother_pileup = argv[3];
-  const string father_pileup = argv[4];
+  const string mother_pileup = input_count == 1 ? "" : argv[3];
+  const string father_pileup = input_count == 1 ? "" : argv[4];
+
+  PileupOptions options;
+  for (int i = 2 + input_count; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--unordered") {
+      options.unordered = true;
+    } else if (flag == "--multinomial") {
+      options.multinomial = true;
+    } else if (flag == "--float") {
+      options.precision = "float";
+    } else if (flag == "--long-double") {
+      options.precision = "long double";
+    } else if (flag == "--rate-track" && i + 1 < argc) {
+      options.rate_track = argv[++i];
+    } else if (flag == "--reference-priors") {
+      options.reference_priors = true;
+    } else if (flag == "--frequencies" && i + 1 < argc) {
+      options.frequency_file = argv[++i];
+    } else if (flag == "--sequencing-error-rates" && i + 1 < argc) {
+      options.sequencing_error_rates = ParseIndividualValues(argv[++i]);
+    } else if (flag == "--dirichlet-dispersions" && i + 1 < argc) {
+      options.dirichlet_dispersions = ParseIndividualValues(argv[++i]);
+    } else if (flag == "--quality-bins" && i + 1 < argc) {
+      options.quality_bins = ParseQualityBins(argv[++i]);
+    } else if (flag == "--parse-threads" && i + 1 < argc) {
+      options.parse_threads = stoi(argv[++i]);
+    } else if (flag == "--score-threads" && i + 1 < argc) {
+      options.score_threads = stoi(argv[++i]);
+    } else if (flag == "--shard-threads" && i + 1 < argc) {
+      options.shard_threads = stoi(argv[++i]);
+    } else if (flag == "--regions" && i + 1 < argc) {
+      options.regions = argv[++i];
+    } else if (flag == "--inflate-threads" && i + 1 < argc) {
+      options.read_options.inflate_threads = stoi(argv[++i]);
+    } else if (flag == "--io-backend" && i + 1 < argc) {
+      options.read_options.backend = ReadBackend(argv[++i]);
+    } else if (flag == "--sam") {
+      options.sam = true;
+    } else if (flag == "--min-mapping-quality" && i + 1 < argc) {
+      options.min_mapping_quality = stoi(argv[++i]);
+    } else if (flag == "--min-base-quality" && i + 1 < argc) {
+      options.min_base_quality = stoi(argv[++i]);
+    } else if (flag == "--output-format" && i + 1 < argc) {
+      options.output_format = argv[++i];
+    } else if (flag == "--top-sites" && i + 1 < argc) {
+      char *value_end = nullptr;
+      const long top_sites = strtol(argv[++i], &value_end, 10);
+      if (*value_end != '\0' || top_sites < 1) {
+        Die("The number of top sites must be at least 1.");
+      }
+      options.top_sites = top_sites;
+    } else if (flag == "--trio-counts") {
+      options.trio_counts = true;
+    } else if (flag == "--distinct-trios") {
+      options.distinct_trios = true;
+    } else if (flag == "--mpileup") {
+      options.mpileup = true;
+    } else if (flag == "--samples" && i + 1 < argc) {
+      options.samples = ParseSamples(argv[++i]);
+    } else if (flag == "--checkpoint" && i + 1 < argc) {
+      options.checkpoint_seconds = stoi(argv[++i]);
+    } else if (flag == "--resume") {
+      options.resume = true;
+    } else {
+      Die("Unknown option.");
+    }
+  }
+
+  if (options.output_format == "histogram" && !options.distinct_trios) {
+    Die("Histogram output is only written with --distinct-trios.");
+  }
+  if (options.mpileup && (options.trio_counts || options.sam)) {
+    Die("A multi-sample pileup is read without --trio-counts or --sam.");
+  }
+  for (double rate : options.sequencing_error_rates) {
+    if (!(rate > 0.0 && rate < 1.0)) {
+      Die("Sequencing error rates must be between 0 and 1.");
+    }
+  }
+  for (double dispersion : options.dirichlet_dispersions) {
+    if (!(dispersion > 0.0) || isinf(dispersion)) {
+      Die("Dirichlet dispersions must be positive.");
+    }
+  }
+  if (options.resume && options.checkpoint_seconds == 0) {
+    options.checkpoint_seconds = kDefaultCheckpointSeconds;
+  }
 
-  ProcessPileup(file_name, child_pileup, mother_pileup, father_pileup);
+  ProcessPileup(file_name, child_pileup, mother_pileup, father_pileup, options);
 
   return 0;
 }
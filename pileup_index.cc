@@ -0,0 +1,245 @@
+/**
+ * @file pileup_index.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the PileupIndex class and of the
+ * functions that build an index and read regions.
+ *
+ * See top of pileup_index.h for a complete description.
+ */
+#include <unistd.h>
+
+#include "line_reader.h"
+#include "pileup_index.h"
+#include "pileup_shard.h"
+
+
+/**
+ * Constructor that reads the index file.
+ *
+ * @param  file_name Index file name.
+ */
+PileupIndex::PileupIndex(const string &file_name) {
+  LineReader reader(file_name);
+  if (!reader.is_open()) {
+    Die("Pileup index cannot be read. Build it with pileup_index_driver.");
+  }
+
+  StringView line;
+  while (reader.NextLine(line)) {
+    if (line.size == 0 || line.data[0] == '#') {
+      continue;
+    }
+    const char *tab = static_cast<const char*>(memchr(line.data, '\t',
+                                                      line.size));
+    if (tab == nullptr) {
+      Die("Pileup index line is not in the format: contig position offset.");
+    }
+    string contig(line.data, tab - line.data);
+    char *field_end = nullptr;
+    Entry entry;
+    entry.position = strtol(tab + 1, &field_end, 10);
+    entry.offset = strtoll(field_end, nullptr, 10);
+
+    vector<Entry> &entries = entries_[contig];
+    if (entries.empty()) {
+      contigs_.push_back(contig);
+    }
+    entries.push_back(entry);
+  }
+
+  for (size_t i = 0; i < contigs_.size(); ++i) {
+    if (i + 1 < contigs_.size()) {
+      contig_ends_[contigs_[i]] = entries_[contigs_[i + 1]].front().offset;
+    } else {
+      contig_ends_[contigs_[i]] = numeric_limits<off_t>::max();
+    }
+  }
+}
+
+/**
+ * Returns the byte range of the lines of a region. The range begins at the
+ * last indexed line at or before first and ends at the first indexed line
+ * after last, or at the end of the file if there is none.
+ *
+ * @param  contig Contig of the region.
+ * @param  first  1-based first position of the region.
+ * @param  last   1-based last position of the region.
+ * @param  begin  Offset of the first line to read.
+ * @param  end    Offset after the last line to read.
+ * @return        False if the contig is not indexed.
+ */
+bool PileupIndex::Range(const string &contig, int first, int last,
+                        off_t &begin, off_t &end) const {
+  auto it = entries_.find(contig);
+  if (it == entries_.end()) {
+    begin = 0;
+    end = 0;
+    return false;
+  }
+
+  const vector<Entry> &entries = it->second;
+  auto is_before = [](int position, const Entry &entry) {
+    return position < entry.position;
+  };
+  auto after_first = upper_bound(entries.begin(), entries.end(), first,
+                                 is_before);
+  begin = after_first == entries.begin() ? entries.front().offset
+                                         : (after_first - 1)->offset;
+  auto after_last = upper_bound(after_first, entries.end(), last, is_before);
+  if (after_last != entries.end()) {
+    end = after_last->offset;
+  } else {
+    end = contig_ends_.at(contig);  // First line of the next contig.
+  }
+  return true;
+}
+
+const vector<string>& PileupIndex::contigs() const {
+  return contigs_;
+}
+
+/**
+ * Writes the index of a pileup file to <file_name>.pidx. The offsets of a
+ * BGZF compressed file are virtual offsets.
+ *
+ * @param  file_name Pileup file name.
+ */
+void BuildPileupIndex(const string &file_name) {
+  LineReader reader(file_name);
+  ofstream fout(file_name + kPileupIndexExtension);
+  if (!reader.is_open() || !fout.is_open()) {
+    Die("Pileup file cannot be indexed.");
+  }
+  fout << "#pileup_index\t" << kPileupIndexInterval << "\n";
+
+  StringView line;
+  string contig;
+  int window = -1;
+  while (reader.NextLine(line)) {
+    const char *tab = static_cast<const char*>(memchr(line.data, '\t',
+                                                      line.size));
+    if (tab == nullptr) {
+      Die("Pileup line does not have the pileup columns.");
+    }
+    int position = strtol(tab + 1, nullptr, 10);
+    if (contig.size() != static_cast<size_t>(tab - line.data) ||
+        memcmp(contig.data(), line.data, contig.size()) != 0) {
+      contig.assign(line.data, tab - line.data);
+      window = -1;
+    }
+    if (position / kPileupIndexInterval > window) {
+      window = position / kPileupIndexInterval;
+      off_t offset = reader.line_offset();
+      if (offset == -1) {
+        Die("Compressed pileup files must be compressed with bgzip to be "
+            "indexed.");
+      }
+      fout << contig << "\t" << position << "\t" << offset << "\n";
+    }
+  }
+  fout.close();
+}
+
+/**
+ * Reads the regions of a BED file. Regions are 0-based and end-exclusive in
+ * the file and 1-based and inclusive in PileupRegion. Overlapping and adjacent
+ * regions that follow each other are merged, so no site is scored twice. The
+ * regions must be in the order of the pileup files.
+ *
+ * @param  file_name BED file name.
+ * @return           Regions without byte ranges.
+ */
+vector<PileupRegion> ReadRegions(const string &file_name) {
+  LineReader reader(file_name);
+  if (!reader.is_open()) {
+    Die("Region file cannot be read.");
+  }
+
+  vector<PileupRegion> regions;
+  StringView line;
+  while (reader.NextLine(line)) {
+    if (line.size == 0 || line.data[0] == '#' ||
+        (line.size >= 5 && memcmp(line.data, "track", 5) == 0) ||
+        (line.size >= 7 && memcmp(line.data, "browser", 7) == 0)) {
+      continue;
+    }
+    const char *tab = static_cast<const char*>(memchr(line.data, '\t',
+                                                      line.size));
+    if (tab == nullptr) {
+      Die("Region line is not in the format: contig start end.");
+    }
+    PileupRegion region;
+    region.contig.assign(line.data, tab - line.data);
+    char *field_end = nullptr;
+    region.first = strtol(tab + 1, &field_end, 10) + 1;
+    region.last = strtol(field_end, nullptr, 10);
+    if (region.last < region.first) {
+      continue;  // Empty region.
+    }
+
+    if (!regions.empty() && regions.back().contig == region.contig &&
+        region.first <= regions.back().last + 1) {
+      regions.back().last = max(regions.back().last, region.last);
+    } else {
+      regions.push_back(region);
+    }
+  }
+  return regions;
+}
+
+/**
+ * Reads the regions of a BED file and looks up their byte ranges in the index
+ * <pileup>.pidx of each pileup file. Regions on a contig that a file does not
+ * have get an empty range in the file.
+ *
+ * @param  bed_file_name BED file name.
+ * @param  pileups       Child, mother and father pileup file names.
+ * @param  contigs       Contigs of all pileup files in file order.
+ * @return               Regions with byte ranges.
+ */
+vector<PileupRegion> LocateRegions(const string &bed_file_name,
+                                   const vector<string> &pileups,
+                                   vector<string> &contigs) {
+  vector<PileupRegion> regions = ReadRegions(bed_file_name);
+  vector<vector<string>> orders;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    PileupIndex index(pileups[i] + kPileupIndexExtension);
+    for (PileupRegion &region : regions) {
+      index.Range(region.contig, region.first, region.last, region.begins[i],
+                  region.ends[i]);
+    }
+    orders.push_back(index.contigs());
+  }
+  contigs = MergeContigOrders(orders);
+  return regions;
+}
+
+/**
+ * Finds the order of the contigs of the pileup files. The contigs of a file
+ * are read from its index <pileup>.pidx if it has one, or else are found by
+ * bisecting the file with PileupProbe (see pileup_shard.h).
+ *
+ * @param  pileups Child, mother and father pileup file names.
+ * @param  contigs Contigs of all pileup files in file order, empty if the
+ *                 order is not found.
+ * @return         False if the contigs of a file cannot be found without
+ *                 reading it in full, e.g. a pipe or a compressed file
+ *                 without an index.
+ */
+bool PileupContigOrder(const vector<string> &pileups, vector<string> &contigs) {
+  contigs.clear();
+  vector<vector<string>> orders;
+  for (const string &pileup : pileups) {
+    const string index_name = pileup + kPileupIndexExtension;
+    if (access(index_name.c_str(), R_OK) == 0) {
+      orders.push_back(PileupIndex(index_name).contigs());
+    } else if (IsProbeable(pileup)) {
+      orders.push_back(PileupProbe(pileup).Contigs());
+    } else {
+      return false;
+    }
+  }
+  contigs = MergeContigOrders(orders);
+  return true;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file pileup_index.h
+ * @author Melissa Ip
+ *
+ * The PileupIndex class is a coordinate index of a pileup file, similar to a
+ * .fai or tabix index, which is used to read only the lines of the regions in
+ * a BED file. The index is a tab separated text file next to the pileup file
+ * (<pileup>.pidx) that records the byte offset of the first line of each
+ * contig and of the first line in each window of kPileupIndexInterval
+ * positions:
+ *
+ *   #pileup_index  <interval>
+ *   <contig>  <position>  <offset>
+ *
+ * Offsets in BGZF compressed pileup files are virtual offsets (see
+ * gzip_reader.h), which LineReader seeks to in the same way.
+ *
+ * Range() returns the byte range of the lines of a region, which starts at the
+ * last indexed line at or before the region and ends at the first indexed line
+ * after it, so at most one window of lines on either side is read and then
+ * skipped by PileupMerger::SetRegions().
+ *
+ * Example usage:
+ *
+ *   BuildPileupIndex("child.pileup");  // Writes child.pileup.pidx.
+ *   PileupIndex index("child.pileup.pidx");
+ *   off_t begin, end;
+ *   index.Range("1", 10000, 20000, begin, end);
+ *   LineReader reader("child.pileup", begin, end);
+ *
+ * LocateRegions() reads a BED file and looks up the byte ranges of its regions
+ * in the index of each pileup file of a trio.
+ *
+ * PileupContigOrder() finds the contig order of the pileup files of a trio
+ * for PileupMerger::SetContigOrder(), from the index of each file if it has
+ * one, or else from the file itself if it is a regular uncompressed file.
+ */
+#ifndef PILEUP_INDEX_H
+#define PILEUP_INDEX_H
+
+#include <sys/types.h>
+#include <fstream>
+#include <unordered_map>
+
+#include "trio_model.h"
+
+// Extension of the index file of a pileup file.
+const string kPileupIndexExtension = ".pidx";
+
+// Number of positions between indexed lines.
+const int kPileupIndexInterval = 16384;
+
+
+/**
+ * Region of a BED file and its byte range in each pileup file.
+ */
+struct PileupRegion {
+  string contig;
+  int first;  // 1-based, inclusive.
+  int last;
+  off_t begins[kIndividualCount];
+  off_t ends[kIndividualCount];
+};
+
+/**
+ * PileupIndex class header. See top of file for a complete description.
+ */
+class PileupIndex {
+ public:
+  PileupIndex(const string &file_name);
+  bool Range(const string &contig, int first, int last, off_t &begin,
+             off_t &end) const;  // False if the contig is not indexed.
+  const vector<string>& contigs() const;  // Contigs in file order.
+
+ private:
+  struct Entry {
+    int position;
+    off_t offset;
+  };
+
+  // Instance member variables.
+  vector<string> contigs_;
+  unordered_map<string, vector<Entry>> entries_;  // Contig to indexed lines.
+  unordered_map<string, off_t> contig_ends_;  // Offset after the last line of a contig.
+};
+
+// Forward declarations.
+void BuildPileupIndex(const string &file_name);
+vector<PileupRegion> ReadRegions(const string &file_name);
+vector<PileupRegion> LocateRegions(const string &bed_file_name,
+                                   const vector<string> &pileups,
+                                   vector<string> &contigs);
+bool PileupContigOrder(const vector<string> &pileups,
+                       vector<string> &contigs);
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file pileup_index_driver.cc
+ * @author Melissa Ip
+ *
+ * This file builds the coordinate index <pileup>.pidx of each given pileup
+ * file, which pileup_driver uses to read only the regions of a BED file (see
+ * pileup_index.h).
+ *
+ * To compile on Herschel:
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o pileup_index_driver utility.cc gzip_reader.cc uring_reader.cc line_reader.cc pileup_shard.cc pileup_index.cc pileup_index_driver.cc -lz
+ *
+ * To run this file, provide the following command line inputs:
+ * ./pileup_index_driver <child>.pileup <mother>.pileup <father>.pileup
+ */
+#include "pileup_index.h"
+
+
+int main(int argc, const char *argv[]) {
+  if (argc < 2) {
+    Die("USAGE: pileup_index_driver <input>.pileup [<input>.pileup ...]");
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    BuildPileupIndex(argv[i]);
+  }
+
+  return 0;
+}
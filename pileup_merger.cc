@@ -0,0 +1,450 @@
+/**
+ * @file pileup_merger.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the PileupMerger class.
+ *
+ * See top of pileup_merger.h for a complete description.
+ */
+#include "pileup_merger.h"
+
+
+/**
+ * Constructor that skips the leading lines with a N reference of each file and
+ * reads the first valid line.
+ *
+ * @param  child       Child pileup reader.
+ * @param  mother      Mother pileup reader.
+ * @param  father      Father pileup reader.
+ * @param  trim_header False if the readers start in the middle of the files,
+ *                     where lines with a N reference are merged, and where a
+ *                     file may not have any lines.
+ */
+PileupMerger::PileupMerger(LineReader &child, LineReader &mother,
+                           LineReader &father, bool trim_header)
+    : readers_{&child, &mother, &father}, position_{0}, regions_{nullptr},
+      region_index_{0}, quality_bins_{nullptr} {
+  for (int i = 0; i < kIndividualCount; ++i) {
+    is_covered_[i] = false;
+    if (!trim_header) {
+      has_head_[i] = PileupMerger::ReadHead(i);
+      continue;
+    }
+    StringView line;
+    if (!TrimHeader(*readers_[i], line)) {
+      Die("Pileup file does not contain valid sequences (no N reference).");
+    }
+    ParsePileupLine(line.data, line.size, heads_[i]);
+    head_contigs_[i] = heads_[i].contig.ToString();
+    head_offsets_[i] = readers_[i]->line_offset();
+    has_head_[i] = true;
+  }
+}
+
+/**
+ * Restricts the merger to the positions of regions, which are read in order.
+ * The readers are moved to the byte range of each region in turn, so the
+ * merger must be created with trim_header false.
+ *
+ * @param  regions Regions with the byte ranges of each file. Must outlive the
+ *                 merger.
+ */
+void PileupMerger::SetRegions(const vector<PileupRegion> &regions) {
+  regions_ = &regions;
+  if (!PileupMerger::StartRegion(0)) {
+    for (int i = 0; i < kIndividualCount; ++i) {
+      has_head_[i] = false;
+    }
+  }
+}
+
+/**
+ * Sets the contig order of the files, so that a file whose next contig comes
+ * later waits while the other files merge the contigs before it.
+ *
+ * @param  contigs Contigs of all files in file order.
+ */
+void PileupMerger::SetContigOrder(const vector<string> &contigs) {
+  contig_order_.SetContigs(contigs);
+}
+
+/**
+ * Merges the next position that is covered in at least one file. Individuals
+ * without a line at the position get reads of zero.
+ *
+ * @param  site Merged reads of the position.
+ * @return      False once every file is exhausted.
+ */
+bool PileupMerger::NextSite(TrioSite &site) {
+  if (!PileupMerger::NextPosition()) {
+    return false;
+  }
+  const string &contig = contig_order_.contig();
+  site.contig = StringView(contig.data(), contig.size());
+  site.position = position_;
+  site.ref_nucleotide = 'N';
+  site.data_vec.resize(kIndividualCount);
+  bool has_reference = false;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (is_covered_[i]) {
+      site.data_vec[i] = CountBases(heads_[i].bases, heads_[i].ref_nucleotide);
+      if (!has_reference) {
+        site.ref_nucleotide = heads_[i].ref_nucleotide;
+        has_reference = true;
+      }
+    } else {
+      site.data_vec[i].key = 0;
+    }
+  }
+  if (quality_bins_ != nullptr) {
+    const int bin_count = quality_bins_->min_qualities.size();
+    site.binned_vec.resize(kIndividualCount * bin_count);
+    for (int i = 0; i < kIndividualCount; ++i) {
+      ReadData *binned = &site.binned_vec[i * bin_count];
+      if (is_covered_[i]) {
+        CountBinnedBases(heads_[i].bases, heads_[i].qualities,
+                         heads_[i].ref_nucleotide, *quality_bins_, binned);
+      } else {
+        for (int b = 0; b < bin_count; ++b) {
+          binned[b].key = 0;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Counts the reads of each base quality bin of each individual into
+ * TrioSite::binned_vec in NextSite(), besides the reads of data_vec.
+ *
+ * @param  bins Quality bins. Must outlive the merger.
+ */
+void PileupMerger::SetQualityBins(const QualityBins &bins) {
+  quality_bins_ = &bins;
+}
+
+/**
+ * Reads past the lines of the previous position and moves to the next position
+ * that is covered in at least one file. The columns of the covered files stay
+ * valid until the next call.
+ *
+ * @return  False once every file is exhausted.
+ */
+bool PileupMerger::NextPosition() {
+  while (true) {
+    if (!PileupMerger::MergePosition()) {
+      if (regions_ == nullptr ||
+          !PileupMerger::StartRegion(region_index_ + 1)) {
+        return false;
+      }
+      continue;
+    }
+    if (regions_ == nullptr) {
+      return true;
+    }
+    const PileupRegion &region = (*regions_)[region_index_];
+    if (contig_order_.contig() != region.contig || position_ > region.last) {
+      if (!PileupMerger::StartRegion(region_index_ + 1)) {
+        return false;
+      }
+    } else if (position_ >= region.first) {
+      return true;
+    }
+  }
+}
+
+/**
+ * Reads past the lines of the previous position and merges the next position
+ * of the readers.
+ *
+ * @return  False once every reader is exhausted.
+ */
+bool PileupMerger::MergePosition() {
+  const string &contig = contig_order_.contig();
+  bool has_contig = false;
+  bool has_any = false;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (is_covered_[i]) {
+      has_head_[i] = PileupMerger::Advance(i);
+      is_covered_[i] = false;
+    }
+    has_any = has_any || has_head_[i];
+    has_contig = has_contig || (has_head_[i] && head_contigs_[i] == contig);
+  }
+  if (!has_any) {
+    return false;
+  }
+  if (!has_contig) {
+    contig_order_.NextContig(head_contigs_, has_head_);
+  }
+
+  position_ = numeric_limits<int>::max();
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (has_head_[i] && head_contigs_[i] == contig &&
+        heads_[i].position < position_) {
+      position_ = heads_[i].position;
+    }
+  }
+  for (int i = 0; i < kIndividualCount; ++i) {
+    is_covered_[i] = has_head_[i] && heads_[i].position == position_ &&
+                     head_contigs_[i] == contig;
+  }
+  return true;
+}
+
+/**
+ * Moves the readers to the byte ranges of a region and reads their first
+ * lines. Each region is merged on its own.
+ *
+ * @param  region_index Index of the region.
+ * @return              False if there are no regions left.
+ */
+bool PileupMerger::StartRegion(int region_index) {
+  region_index_ = region_index;
+  if (region_index_ >= static_cast<int>(regions_->size())) {
+    return false;
+  }
+  const PileupRegion &region = (*regions_)[region_index_];
+  for (int i = 0; i < kIndividualCount; ++i) {
+    readers_[i]->SetRange(region.begins[i], region.ends[i]);
+    has_head_[i] = PileupMerger::ReadHead(i);
+    is_covered_[i] = false;
+  }
+  contig_order_.Clear();
+  return true;
+}
+
+/**
+ * Reads the first line of a reader without checking its order.
+ *
+ * @param  individual Index of the file (0 child, 1 mother, 2 father).
+ * @return            False if the reader has no lines.
+ */
+bool PileupMerger::ReadHead(int individual) {
+  StringView line;
+  if (!readers_[individual]->NextLine(line)) {
+    return false;
+  }
+  if (!ParsePileupLine(line.data, line.size, heads_[individual])) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  head_contigs_[individual] = heads_[individual].contig.ToString();
+  head_offsets_[individual] = readers_[individual]->line_offset();
+  return true;
+}
+
+/**
+ * Reads the next line of a file and checks that it is sorted.
+ *
+ * @param  individual Index of the file (0 child, 1 mother, 2 father).
+ * @return            False if the file is exhausted.
+ */
+bool PileupMerger::Advance(int individual) {
+  StringView line;
+  if (!readers_[individual]->NextLine(line)) {
+    return false;
+  }
+  PileupSite &head = heads_[individual];
+  int previous_position = head.position;
+  if (!ParsePileupLine(line.data, line.size, head)) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  head_offsets_[individual] = readers_[individual]->line_offset();
+
+  string &head_contig = head_contigs_[individual];
+  if (head_contig.size() == head.contig.size &&
+      memcmp(head_contig.data(), head.contig.data, head.contig.size) == 0) {
+    if (head.position <= previous_position) {
+      Die("Pileup file is not sorted by position.");
+    }
+  } else {
+    head_contig.assign(head.contig.data, head.contig.size);
+    if (contig_order_.is_finished(head_contig) && contig_order_.is_known()) {
+      Die("Pileup files do not have their contigs in the same order.");
+    } else if (contig_order_.is_finished(head_contig)) {
+      Die("Pileup files do not have the same contigs, and their order is not "
+          "known. Use uncompressed files or BGZF files with a pileup index.");
+    }
+  }
+  return true;
+}
+
+const string& PileupMerger::contig() const {
+  return contig_order_.contig();
+}
+
+int PileupMerger::position() const {
+  return position_;
+}
+
+bool PileupMerger::is_covered(int individual) const {
+  return is_covered_[individual];
+}
+
+const PileupSite& PileupMerger::head(int individual) const {
+  return heads_[individual];
+}
+
+/**
+ * Returns the offset of the current line of a file, i.e. the line of the
+ * current position if the file covers it, or otherwise the next line.
+ *
+ * @param  individual Index of the file (0 child, 1 mother, 2 father).
+ * @return            Offset of the line, a virtual offset in a BGZF file, or
+ *                    -1 once the file is exhausted.
+ */
+off_t PileupMerger::head_offset(int individual) const {
+  return has_head_[individual] ? head_offsets_[individual] : -1;
+}
+
+const set<string>& PileupMerger::finished_contigs() const {
+  return contig_order_.finished_contigs();
+}
+
+/**
+ * Continues a scan whose readers were moved to the head offsets of an earlier
+ * merger. The merger stays on the contig of the earlier merger, even if most
+ * files are already on the next contig, and checks the order of the contigs
+ * against the contigs that were merged before.
+ *
+ * @param  contig           Contig of the earlier merger.
+ * @param  finished_contigs Contigs that the earlier merger finished.
+ */
+void PileupMerger::Resume(const string &contig,
+                          const set<string> &finished_contigs) {
+  contig_order_.Resume(contig, finished_contigs);
+}
+
+/**
+ * Sets the order of the contigs of the files. The files must have their
+ * contigs in this order, but do not need to have all of them.
+ *
+ * @param  contigs Contigs of all files in file order.
+ */
+void ContigOrder::SetContigs(const vector<string> &contigs) {
+  contig_ranks_.clear();
+  for (size_t i = 0; i < contigs.size(); ++i) {
+    contig_ranks_[contigs[i]] = i;
+  }
+}
+
+bool ContigOrder::is_known() const {
+  return !contig_ranks_.empty();
+}
+
+/**
+ * Finishes the current contig and moves to the contig of the next files. If
+ * the order is known, picks the earliest contig of the files, so the files on
+ * later contigs wait. Otherwise, or if a file is on a contig that the order
+ * does not have, picks the contig that most files are on.
+ *
+ * @param  contigs    Contig of each file.
+ * @param  has_contig False for files that are exhausted.
+ */
+void ContigOrder::NextContig(const string contigs[], const bool has_contig[]) {
+  if (!contig_.empty()) {
+    finished_contigs_.insert(contig_);
+  }
+  int best = -1;
+  int best_rank = numeric_limits<int>::max();
+  for (int i = 0; i < kIndividualCount && is_known(); ++i) {
+    if (!has_contig[i]) {
+      continue;
+    }
+    auto it = contig_ranks_.find(contigs[i]);
+    if (it == contig_ranks_.end()) {
+      best = -1;
+      break;
+    } else if (it->second < best_rank) {
+      best = i;
+      best_rank = it->second;
+    }
+  }
+  if (best == -1) {
+    best = MajorityContig(contigs, has_contig);
+  }
+  contig_ = contigs[best];
+}
+
+const string& ContigOrder::contig() const {
+  return contig_;
+}
+
+bool ContigOrder::is_finished(const string &contig) const {
+  return finished_contigs_.count(contig) > 0;
+}
+
+const set<string>& ContigOrder::finished_contigs() const {
+  return finished_contigs_;
+}
+
+/**
+ * Continues on the contig of an earlier merger, with the contigs that it
+ * finished.
+ *
+ * @param  contig           Contig of the earlier merger.
+ * @param  finished_contigs Contigs that the earlier merger finished.
+ */
+void ContigOrder::Resume(const string &contig,
+                         const set<string> &finished_contigs) {
+  contig_ = contig;
+  finished_contigs_ = finished_contigs;
+}
+
+/**
+ * Forgets the current contig and the merged contigs, e.g. before each region,
+ * but keeps the order.
+ */
+void ContigOrder::Clear() {
+  contig_.clear();
+  finished_contigs_.clear();
+}
+
+/**
+ * Returns the individual whose contig most files are on, with ties going to
+ * the earlier individual.
+ *
+ * @param  contigs    Contig of each file.
+ * @param  has_contig False for files that are exhausted.
+ * @return            Index of the individual.
+ */
+int MajorityContig(const string contigs[], const bool has_contig[]) {
+  int best = -1;
+  int best_count = 0;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (!has_contig[i]) {
+      continue;
+    }
+    int count = 0;
+    for (int j = 0; j < kIndividualCount; ++j) {
+      if (has_contig[j] && contigs[j] == contigs[i]) {
+        count++;
+      }
+    }
+    if (count > best_count) {
+      best = i;
+      best_count = count;
+    }
+  }
+  return best;
+}
+
+/**
+ * Skips the initial lines of a pileup reader that contain a N reference
+ * without copying the lines, like TrimHeader(ifstream &) in pileup_utility.h.
+ *
+ * @param  reader Pileup file reader.
+ * @param  line   First line where N is not the reference.
+ * @return        False if there were only invalid N sequences.
+ */
+bool TrimHeader(LineReader &reader, StringView &line) {
+  PileupSite site;
+  while (reader.NextLine(line)) {
+    if (ParsePileupLine(line.data, line.size, site) &&
+        site.ref_nucleotide != 'N') {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file pileup_merger.h
+ * @author Melissa Ip
+ *
+ * The PileupMerger class joins the child, mother and father pileup files on
+ * (contig, position) in a single streaming pass. Pileups written per sample
+ * omit positions without coverage, so the files are usually not line-aligned.
+ * Each call to NextSite() returns the next position that is covered in at
+ * least one file, and individuals without a line at that position get reads
+ * of zero:
+ *
+ *   child   1  100  A ...     mother  1  100  A ...     father  1  101  C ...
+ *   child   1  101  C ...     mother  1  102  T ...
+ *
+ *   site 1:100  {child, mother, 0}
+ *   site 1:101  {child, 0, father}
+ *   site 1:102  {0, mother, 0}
+ *
+ * Only the current line of each file is kept, so memory does not grow with the
+ * size of the files. Positions must be sorted within a contig and the contigs
+ * must appear in the same relative order in every file, but a file does not
+ * need to have every contig. When the files move to different contigs, the
+ * next contig is picked by ContigOrder: if SetContigOrder() gave the contig
+ * order of the files, e.g. from PileupContigOrder() in pileup_index.h, the
+ * earliest contig is merged first while the files on later contigs wait, so a
+ * contig that some files do not have is merged with reads of zero for them.
+ * Without an order, the contig that most files are on is merged first, with
+ * ties going to the child, then the mother, which is only correct if the files
+ * have the same contigs. A file that later returns to a contig that was
+ * already merged is an error.
+ *
+ * As with line-aligned files, the leading lines with a N reference are skipped
+ * in each file, unless the readers start in the middle of the files.
+ *
+ * head_offset() returns the offset of the current line of each file, so a scan
+ * can record where it is and later resume there with Resume() and readers
+ * that start at those offsets.
+ *
+ * SetQualityBins() also counts the reads of each base quality bin of each
+ * individual into binned_vec, for quality-aware scoring (see trio_model.h).
+ *
+ * SetRegions() restricts the merger to the positions of the regions of a BED
+ * file, which it reads by moving the readers to the byte range of each region
+ * in the pileup index of each file (see pileup_index.h).
+ *
+ * Example usage:
+ *
+ *   PileupMerger merger(child, mother, father);  // LineReader objects.
+ *   TrioSite site;
+ *   while (merger.NextSite(site)) {
+ *     double probability = params.MutationProbability(site.data_vec);
+ *   }
+ *
+ * NextPosition() moves to the next position without counting the bases, so
+ * the columns of each file can be handed to other threads:
+ *
+ *   while (merger.NextPosition()) {
+ *     if (merger.is_covered(0)) {
+ *       StringView bases = merger.head(0).bases;  // Valid until NextPosition().
+ *     }
+ *   }
+ */
+#ifndef PILEUP_MERGER_H
+#define PILEUP_MERGER_H
+
+#include <set>
+#include <unordered_map>
+
+#include "line_reader.h"
+#include "pileup_index.h"
+#include "pileup_parser.h"
+#include "trio_model.h"
+
+
+/**
+ * Reads of a trio at one merged position. The contig is valid until the next
+ * call to NextSite().
+ */
+struct TrioSite {
+  StringView contig;
+  int position;  // 1-based.
+  char ref_nucleotide;  // Upper case, from the first file with the position.
+  ReadDataVector data_vec;  // Child, mother and father reads.
+  ReadDataVector binned_vec;  // Reads of each quality bin, empty without bins.
+};
+
+/**
+ * ContigOrder class header. Picks the contig that the files of a trio move to
+ * once no file is on the current contig, and remembers the contigs that were
+ * merged. Shared by PileupMerger and SamMerger (see sam_pileup.h).
+ */
+class ContigOrder {
+ public:
+  void SetContigs(const vector<string> &contigs);  // Contigs of all files in order.
+  bool is_known() const;  // True if the contig order was set.
+  void NextContig(const string contigs[], const bool has_contig[]);  // Finishes the current contig.
+  const string& contig() const;  // Contig that is being merged.
+  bool is_finished(const string &contig) const;
+  const set<string>& finished_contigs() const;
+  void Resume(const string &contig, const set<string> &finished_contigs);
+  void Clear();  // Forgets the merged contigs, but not the order.
+
+ private:
+  // Instance member variables.
+  string contig_;
+  set<string> finished_contigs_;  // Contigs that have been merged.
+  unordered_map<string, int> contig_ranks_;  // Contigs of the files, if known.
+};
+
+// Forward declarations.
+bool TrimHeader(LineReader &reader, StringView &line);
+int MajorityContig(const string contigs[], const bool has_contig[]);
+
+/**
+ * PileupMerger class header. See top of file for a complete description.
+ */
+class PileupMerger {
+ public:
+  PileupMerger(LineReader &child, LineReader &mother, LineReader &father,
+               bool trim_header=true);  // False for readers of a later shard.
+  bool NextSite(TrioSite &site);  // False once every file is exhausted.
+  void SetRegions(const vector<PileupRegion> &regions);  // Merges only the regions.
+  void SetContigOrder(const vector<string> &contigs);  // Contigs of all files in order.
+  bool NextPosition();  // Moves to the next position without counting bases.
+  const string& contig() const;  // Contig of the current position.
+  int position() const;
+  bool is_covered(int individual) const;  // True if the file has the position.
+  const PileupSite& head(int individual) const;  // Columns of a covered file.
+  off_t head_offset(int individual) const;  // -1 once the file is exhausted.
+  const set<string>& finished_contigs() const;
+  void Resume(const string &contig, const set<string> &finished_contigs);
+  void SetQualityBins(const QualityBins &bins);  // Also counts binned reads.
+
+ private:
+  bool MergePosition();
+  bool StartRegion(int region_index);
+  bool ReadHead(int individual);
+  bool Advance(int individual);
+
+  // Instance member variables.
+  LineReader *readers_[kIndividualCount];
+  PileupSite heads_[kIndividualCount];  // Current line of each file.
+  off_t head_offsets_[kIndividualCount];  // Offsets of the current lines.
+  string head_contigs_[kIndividualCount];  // Copies of the contigs of heads_.
+  bool has_head_[kIndividualCount];  // False once the file is exhausted.
+  bool is_covered_[kIndividualCount];  // Files that have the current position.
+  ContigOrder contig_order_;  // Contig that is being merged.
+  int position_;  // Current position.
+  const vector<PileupRegion> *regions_;  // Regions of a BED file or nullptr.
+  int region_index_;  // Current region.
+  const QualityBins *quality_bins_;  // Bins of binned_vec or nullptr.
+};
+
+#endif
@@ -0,0 +1,354 @@
+/**
+ * @file pileup_parser.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the pileup column parser.
+ *
+ * See top of pileup_parser.h for a complete description.
+ */
+#include "pileup_parser.h"
+
+
+// Classes of the characters in the bases column. The nucleotide classes are
+// the nucleotide indices, so they index ReadData directly.
+const uint8_t kClassA = 0;
+const uint8_t kClassC = 1;
+const uint8_t kClassG = 2;
+const uint8_t kClassT = 3;
+const uint8_t kClassMatch = 4;  // . and , match the reference.
+const uint8_t kClassReadStart = 5;  // ^ is followed by a mapping quality.
+const uint8_t kClassIndel = 6;  // + and - are followed by a length and bases.
+const uint8_t kClassOther = 7;  // $ * < > N and anything else.
+
+/**
+ * Returns the 256-entry classification table of the bases column.
+ *
+ * @return  Class of every character.
+ */
+vector<uint8_t> BaseClassTable() {
+  vector<uint8_t> table(256, kClassOther);
+  table['A'] = table['a'] = kClassA;
+  table['C'] = table['c'] = kClassC;
+  table['G'] = table['g'] = kClassG;
+  table['T'] = table['t'] = kClassT;
+  table['.'] = table[','] = kClassMatch;
+  table['^'] = kClassReadStart;
+  table['+'] = table['-'] = kClassIndel;
+  return table;
+}
+
+const vector<uint8_t> kBaseClass = BaseClassTable();
+
+/**
+ * Returns the end of the tab separated field that starts at begin.
+ *
+ * @param  begin Start of field.
+ * @param  end   End of line.
+ * @return       Pointer to the tab after the field or end.
+ */
+const char* FieldEnd(const char *begin, const char *end) {
+  const char *tab = static_cast<const char*>(memchr(begin, '\t', end - begin));
+  return tab == nullptr ? end : tab;
+}
+
+/**
+ * Parses a non-negative decimal integer field.
+ *
+ * @param  begin Start of field.
+ * @param  end   End of field.
+ * @param  value Parsed value.
+ * @return       False if the field is empty or not a number.
+ */
+bool ParseInt(const char *begin, const char *end, int &value) {
+  if (begin == end) {
+    return false;
+  }
+  value = 0;
+  for (const char *c = begin; c < end; ++c) {
+    if (*c < '0' || *c > '9') {
+      return false;
+    }
+    value = value * 10 + (*c - '0');
+  }
+  return true;
+}
+
+/**
+ * Tokenizes a pileup line in place. A trailing newline or carriage return is
+ * ignored.
+ *
+ * @param  line   Start of line.
+ * @param  length Length of line.
+ * @param  site   Columns of the line that point into line.
+ * @return        False if the line has fewer than five columns or the
+ *                position or depth is not a number.
+ */
+bool ParsePileupLine(const char *line, size_t length, PileupSite &site) {
+  const char *end = line + length;
+  while (end > line && (end[-1] == '\n' || end[-1] == '\r')) {
+    --end;
+  }
+
+  const char *begin = line;
+  const char *field_end = FieldEnd(begin, end);
+  site.contig = StringView(begin, field_end - begin);
+  if (field_end == end) {
+    return false;
+  }
+
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  if (field_end == end || !ParseInt(begin, field_end, site.position)) {
+    return false;
+  }
+
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  if (field_end == end || field_end == begin) {
+    return false;
+  }
+  site.ref_nucleotide = toupper(*begin);
+
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  if (!ParseInt(begin, field_end, site.depth)) {
+    return false;
+  }
+
+  if (field_end == end) {  // Sites without coverage may omit the bases.
+    site.bases = StringView(end, 0);
+    site.qualities = StringView(end, 0);
+    return true;
+  }
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  site.bases = StringView(begin, field_end - begin);
+
+  if (field_end == end) {
+    site.qualities = StringView(end, 0);
+  } else {
+    begin = field_end + 1;
+    site.qualities = StringView(begin, FieldEnd(begin, end) - begin);
+  }
+  return true;
+}
+
+/**
+ * Tokenizes a multi-sample pileup line in place. A trailing newline or
+ * carriage return is ignored. The samples of site are reused, so parsing the
+ * lines of a file does not allocate.
+ *
+ * @param  line   Start of line.
+ * @param  length Length of line.
+ * @param  site   Columns of the line that point into line.
+ * @return        False if the line has no sample columns or a position or
+ *                depth that is not a number.
+ */
+bool ParseMultiPileupLine(const char *line, size_t length,
+                          MultiPileupSite &site) {
+  const char *end = line + length;
+  while (end > line && (end[-1] == '\n' || end[-1] == '\r')) {
+    --end;
+  }
+
+  const char *begin = line;
+  const char *field_end = FieldEnd(begin, end);
+  site.contig = StringView(begin, field_end - begin);
+  if (field_end == end) {
+    return false;
+  }
+
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  if (field_end == end || !ParseInt(begin, field_end, site.position)) {
+    return false;
+  }
+
+  begin = field_end + 1;
+  field_end = FieldEnd(begin, end);
+  if (field_end == end || field_end == begin) {
+    return false;
+  }
+  site.ref_nucleotide = toupper(*begin);
+
+  site.samples.clear();
+  while (field_end != end) {
+    PileupSample sample;
+    begin = field_end + 1;
+    field_end = FieldEnd(begin, end);
+    if (!ParseInt(begin, field_end, sample.depth)) {
+      return false;
+    }
+    sample.bases = StringView(end, 0);
+    sample.qualities = StringView(end, 0);
+    if (field_end != end) {
+      begin = field_end + 1;
+      field_end = FieldEnd(begin, end);
+      sample.bases = StringView(begin, field_end - begin);
+    }
+    if (field_end != end) {
+      begin = field_end + 1;
+      field_end = FieldEnd(begin, end);
+      sample.qualities = StringView(begin, field_end - begin);
+    }
+    site.samples.push_back(sample);
+  }
+  return true;
+}
+
+/**
+ * Counts the nucleotides of the bases column in one pass. Periods and commas
+ * match the reference nucleotide. Mapping qualities after ^ and the bases of
+ * insertions and deletions are skipped.
+ *
+ * @param  bases          Bases column.
+ * @param  ref_nucleotide Upper case reference nucleotide. Matches are dropped
+ *                        if it is not A, C, G or T.
+ * @return                ReadData.
+ */
+ReadData CountBases(const StringView &bases, char ref_nucleotide) {
+  uint16_t counts[kClassOther + 1] = {0};
+  const char *c = bases.data;
+  const char *end = bases.data + bases.size;
+  while (c < end) {
+    uint8_t base_class = kBaseClass[static_cast<uint8_t>(*c)];
+    if (base_class == kClassReadStart) {
+      c += 2;  // Skips ^ and the mapping quality.
+    } else if (base_class == kClassIndel) {
+      int indel_length = 0;
+      for (++c; c < end && *c >= '0' && *c <= '9'; ++c) {
+        indel_length = indel_length * 10 + (*c - '0');
+      }
+      c += indel_length;
+    } else {
+      ++counts[base_class];
+      ++c;
+    }
+  }
+
+  ReadData data = {0};
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    data.reads[i] = counts[i];
+  }
+  int ref_idx = NucleotideIndex(ref_nucleotide);
+  if (ref_idx != -1) {
+    // Replaces letters that equal the reference.
+    data.reads[ref_idx] = counts[kClassMatch];
+  }
+  return data;
+}
+
+/**
+ * Counts the nucleotides of the bases column into the bins of their base
+ * qualities in one pass, like CountBases(). Bases without a quality, e.g. in
+ * pileups without the qualities column, are counted in the last bin.
+ *
+ * @param  bases          Bases column.
+ * @param  qualities      Qualities column.
+ * @param  ref_nucleotide Upper case reference nucleotide. Matches are dropped
+ *                        if it is not A, C, G or T.
+ * @param  bins           Quality bins.
+ * @param  binned         Reads of each bin, bins.min_qualities.size() entries.
+ */
+void CountBinnedBases(const StringView &bases, const StringView &qualities,
+                      char ref_nucleotide, const QualityBins &bins,
+                      ReadData *binned) {
+  const int bin_count = bins.min_qualities.size();
+  for (int b = 0; b < bin_count; ++b) {
+    binned[b].key = 0;
+  }
+  const int ref_idx = NucleotideIndex(ref_nucleotide);
+  const char *c = bases.data;
+  const char *end = bases.data + bases.size;
+  size_t quality_idx = 0;
+  while (c < end) {
+    uint8_t base_class = kBaseClass[static_cast<uint8_t>(*c)];
+    if (base_class == kClassReadStart) {
+      c += 2;  // Skips ^ and the mapping quality.
+      continue;
+    } else if (base_class == kClassIndel) {
+      int indel_length = 0;
+      for (++c; c < end && *c >= '0' && *c <= '9'; ++c) {
+        indel_length = indel_length * 10 + (*c - '0');
+      }
+      c += indel_length;
+      continue;
+    } else if (*c == '$') {
+      ++c;
+      continue;
+    }
+
+    int bin = bin_count - 1;
+    if (quality_idx < qualities.size) {
+      bin = bins.bins[static_cast<uint8_t>(qualities.data[quality_idx])];
+    }
+    ++quality_idx;
+    if (base_class == kClassMatch) {
+      if (ref_idx != -1) {
+        ++binned[bin].reads[ref_idx];
+      }
+    } else if (base_class < kNucleotideCount && base_class != ref_idx) {
+      // Letters that equal the reference are dropped.
+      ++binned[bin].reads[base_class];
+    }
+    ++c;
+  }
+}
+
+/**
+ * Constructor of the bins that start at 0 and at each threshold.
+ *
+ * @param  thresholds Increasing Phred qualities that start the bins after the
+ *                    first.
+ */
+QualityBins::QualityBins(const vector<int> &thresholds) : min_qualities{0} {
+  for (int threshold : thresholds) {
+    if (threshold <= min_qualities.back()) {
+      Die("Quality bin thresholds must be positive and increasing.");
+    }
+    min_qualities.push_back(threshold);
+  }
+  for (int c = 0; c < 256; ++c) {
+    bins[c] = 0;
+    for (size_t b = 0; b < min_qualities.size(); ++b) {
+      if (c - 33 >= min_qualities[b]) {
+        bins[c] = b;
+      }
+    }
+  }
+}
+
+/**
+ * Returns the error rate of the bases of each bin, the error rate of the
+ * Phred quality in the middle of a bin, or of the first quality of the last
+ * bin, which has no upper bound.
+ *
+ * @return  Error rate of each bin.
+ */
+vector<double> QualityBins::ErrorRates() const {
+  vector<double> error_rates;
+  for (size_t b = 0; b < min_qualities.size(); ++b) {
+    double quality = min_qualities[b];
+    if (b + 1 < min_qualities.size()) {
+      quality = (min_qualities[b] + min_qualities[b + 1]) / 2.0;
+    }
+    error_rates.push_back(pow(10.0, -quality / 10.0));
+  }
+  return error_rates;
+}
+
+/**
+ * Returns the index of a nucleotide.
+ *
+ * @param  nucleotide A, C, G or T in upper or lower case.
+ * @return            Index of nucleotide or -1 if it is not A, C, G or T.
+ */
+int NucleotideIndex(char nucleotide) {
+  switch (nucleotide) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return -1;
+  }
+}
@@ -0,0 +1,98 @@
+/**
+ * @file pileup_parser.h
+ * @author Melissa Ip
+ *
+ * This file contains a single-pass parser for the columns of a pileup line:
+ *
+ *   <contig>  <position>  <reference>  <depth>  <bases>  <qualities>
+ *
+ * The line is tokenized in place. Each column is a StringView (see utility.h)
+ * into the line, so no strings or streams are created per site. CountBases()
+ * counts the bases column in one pass with a 256-entry classification table
+ * and skips the markers that are not bases:
+ *
+ *   ^X     Start of a read, followed by its mapping quality X.
+ *   $      End of a read.
+ *   +N...  Insertion of N bases after this position.
+ *   -N...  Deletion of N bases after this position.
+ *   * < >  Deleted base and reference skips.
+ *
+ * CountBinnedBases() counts the bases of each base quality bin of
+ * QualityBins separately for quality-aware scoring (see trio_model.h). The
+ * qualities column has one character (Phred + 33) for every base, match and
+ * deleted base of the bases column, but none for the markers ^X, $ and indels.
+ *
+ * ParseMultiPileupLine() tokenizes a line of samtools mpileup with several
+ * samples, which has a depth, bases and qualities column for each sample after
+ * the first three columns:
+ *
+ *   <contig>  <position>  <reference>  <depth>  <bases>  <qualities>  ...
+ *
+ * Example usage:
+ *
+ *   PileupSite site;
+ *   if (ParsePileupLine(line.data(), line.size(), site)) {
+ *     ReadData data = CountBases(site.bases, site.ref_nucleotide);
+ *   }
+ */
+#ifndef PILEUP_PARSER_H
+#define PILEUP_PARSER_H
+
+#include "utility.h"
+
+
+/**
+ * Columns of one pileup line. The views point into the parsed line and are
+ * only valid as long as the line.
+ */
+struct PileupSite {
+  StringView contig;
+  int position;  // 1-based.
+  char ref_nucleotide;  // Upper case.
+  int depth;
+  StringView bases;
+  StringView qualities;  // Empty if the column is missing.
+};
+
+/**
+ * Columns of one sample of a multi-sample pileup line.
+ */
+struct PileupSample {
+  int depth;
+  StringView bases;
+  StringView qualities;  // Empty if the column is missing.
+};
+
+/**
+ * Columns of one multi-sample pileup line. The views point into the parsed
+ * line and are only valid as long as the line.
+ */
+struct MultiPileupSite {
+  StringView contig;
+  int position;  // 1-based.
+  char ref_nucleotide;  // Upper case.
+  vector<PileupSample> samples;  // In the order of the columns.
+};
+
+/**
+ * Base quality bins of quality-aware scoring. Bin b holds the bases with a
+ * Phred quality of at least min_qualities[b] and below min_qualities[b + 1].
+ */
+struct QualityBins {
+  QualityBins(const vector<int> &thresholds);  // Qualities that start bins 1, 2, ...
+  vector<double> ErrorRates() const;
+  vector<int> min_qualities;  // 0 and the thresholds.
+  uint8_t bins[256];  // Bin of each quality character.
+};
+
+// Forward declarations.
+bool ParsePileupLine(const char *line, size_t length, PileupSite &site);
+bool ParseMultiPileupLine(const char *line, size_t length,
+                          MultiPileupSite &site);
+ReadData CountBases(const StringView &bases, char ref_nucleotide);
+void CountBinnedBases(const StringView &bases, const StringView &qualities,
+                      char ref_nucleotide, const QualityBins &bins,
+                      ReadData *binned);
+int NucleotideIndex(char nucleotide);
+
+#endif
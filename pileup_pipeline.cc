@@ -0,0 +1,105 @@
+/**
+ * @file pileup_pipeline.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the stages of the pileup pipeline
+ * that do not depend on the model.
+ *
+ * See top of pileup_pipeline.h for a complete description.
+ */
+#include "pileup_pipeline.h"
+
+
+/**
+ * Looks up the values of the site-specific inputs at a site. The tracks are
+ * streamed, so sites must be resolved in the order of the pileup files.
+ *
+ * @param  inputs         Site-specific inputs.
+ * @param  contig         Contig of the site.
+ * @param  position       1-based position of the site.
+ * @param  ref_nucleotide Reference nucleotide of the site.
+ * @param  values         Values of the inputs at the site.
+ */
+void ResolveSite(const SiteInputs &inputs, const string &contig, int position,
+                 char ref_nucleotide, SiteValues &values) {
+  if (inputs.reference_priors) {
+    values.reference = NucleotideIndex(ref_nucleotide);
+  }
+  if (inputs.frequency_track != nullptr) {
+    values.has_frequencies = inputs.frequency_track->Frequencies(
+      contig, position, values.frequencies
+    );
+  }
+  if (inputs.rate_track != nullptr) {
+    values.rate = inputs.rate_track->Rate(contig, position);
+  }
+}
+
+/**
+ * Reader stage. Merges the next kPipelineBatchSize positions into a batch,
+ * which reads and tokenizes the lines, copies the coordinates of each site and
+ * the bases column of each covered file, and resolves the site-specific inputs
+ * in file order, because the tracks are streamed.
+ *
+ * @param  merger Merger of the pileup files.
+ * @param  inputs Site-specific inputs.
+ * @param  batch  Batch that is overwritten.
+ * @return        False if there are no positions left.
+ */
+bool FillBatch(PileupMerger &merger, const SiteInputs &inputs,
+               SiteBatch &batch) {
+  batch.size = 0;
+  batch.contigs.clear();
+  batch.contig_indices.clear();
+  batch.positions.clear();
+  batch.references.clear();
+  batch.bases.clear();
+  batch.offsets.assign(1, 0);
+  batch.ref_nucleotides.clear();
+  batch.values.resize(kPipelineBatchSize);
+  while (batch.size < kPipelineBatchSize && merger.NextPosition()) {
+    char ref_nucleotide = 'N';
+    bool has_reference = false;
+    for (int i = 0; i < kIndividualCount; ++i) {
+      if (merger.is_covered(i)) {
+        const PileupSite &head = merger.head(i);
+        batch.bases.append(head.bases.data, head.bases.size);
+        batch.ref_nucleotides.push_back(head.ref_nucleotide);
+        if (!has_reference) {
+          ref_nucleotide = head.ref_nucleotide;
+          has_reference = true;
+        }
+      } else {
+        batch.ref_nucleotides.push_back('N');
+      }
+      batch.offsets.push_back(batch.bases.size());
+    }
+    if (batch.contigs.empty() || batch.contigs.back() != merger.contig()) {
+      batch.contigs.push_back(merger.contig());
+    }
+    batch.contig_indices.push_back(batch.contigs.size() - 1);
+    batch.positions.push_back(merger.position());
+    batch.references += ref_nucleotide;
+    batch.values[batch.size] = SiteValues();
+    ResolveSite(inputs, merger.contig(), merger.position(), ref_nucleotide,
+                batch.values[batch.size]);
+    batch.size++;
+  }
+  return batch.size > 0;
+}
+
+/**
+ * Parse stage. Counts the bases columns of a batch, which the reader stage has
+ * already tokenized and copied.
+ *
+ * @param  batch Batch of sites.
+ */
+void CountBatch(SiteBatch &batch) {
+  const int column_count = batch.size * kIndividualCount;
+  batch.reads.resize(column_count);
+  for (int k = 0; k < column_count; ++k) {
+    StringView bases(batch.bases.data() + batch.offsets[k],
+                     batch.offsets[k + 1] - batch.offsets[k]);
+    batch.reads[k] = CountBases(bases, batch.ref_nucleotides[k]);
+  }
+}
@@ -0,0 +1,257 @@
+/**
+ * @file pileup_pipeline.h
+ * @author Melissa Ip
+ *
+ * This file contains the stages that score the merged sites of a trio's pileup
+ * files, and a multithreaded pipeline that runs them in parallel:
+ *
+ *   reader -> parse workers -> score workers -> writer
+ *
+ * The reader thread does all the work that depends on file order. It reads and
+ * tokenizes the lines, because PileupMerger needs the contig and position of
+ * each line to merge the files, copies the bases columns of each position
+ * into batches of kPipelineBatchSize sites, and looks up the site-specific
+ * inputs (rate track, frequency track and reference nucleotide), which are
+ * streamed in a single pass and so are resolved in file order. Parse workers
+ * only count the bases columns of a batch, which is the part of parsing that
+ * grows with the depth of the sites, and score workers calculate the
+ * probability of each site with their own copy of the model, because the
+ * models cache matrices. The calling thread is the writer, which puts the
+ * batches back into file order and writes the sites that pass the threshold
+ * with a SiteWriter, so the output is the same as that of a single-threaded
+ * scan. The reader is therefore the limit of the pipeline on shallow pileups,
+ * where counting the bases is cheap; use sharded scans (see pileup_shard.h)
+ * to split the reading as well.
+ *
+ * The stages are connected by BatchQueue objects (see batch_queue.h), and the
+ * batches are recycled through a free queue, so at most a fixed number of
+ * batches exist and memory does not depend on the size of the files.
+ *
+ * Example usage:
+ *
+ *   PileupMerger merger(child, mother, father);
+ *   SiteWriter writer("output.txt", "sites");
+ *   ScorePileupPipeline(params, merger, SiteInputs(), 4, 28, 0.01,
+ *                       writer);  // 4 parse and 28 score threads.
+ *
+ * The templates are defined in this header because Model can be either trio
+ * model.
+ */
+#ifndef PILEUP_PIPELINE_H
+#define PILEUP_PIPELINE_H
+
+#include <thread>
+
+#include "batch_queue.h"
+#include "frequency_track.h"
+#include "pileup_merger.h"
+#include "rate_track.h"
+#include "site_writer.h"
+
+
+// Number of sites in a batch of the pipeline.
+const int kPipelineBatchSize = 4096;
+
+// Number of batches in the pipeline for each worker thread.
+const int kPipelineBatchesPerThread = 4;
+
+/**
+ * Site-specific inputs that are streamed alongside the pileup files. Tracks
+ * that are not used are nullptr.
+ */
+struct SiteInputs {
+  SiteInputs() : rate_track{nullptr}, frequency_track{nullptr},
+                 reference_priors{false} {}
+  RateTrack *rate_track;  // Site-specific germline mutation rates.
+  FrequencyTrack *frequency_track;  // Population allele frequencies.
+  bool reference_priors;  // Conditions the priors on the reference.
+};
+
+/**
+ * Values of the site-specific inputs at one site.
+ */
+struct SiteValues {
+  SiteValues() : reference{-1}, has_frequencies{false},
+                 frequencies{RowVector4d::Zero()}, rate{0.0} {}
+  int reference;  // Index of the reference nucleotide.
+  bool has_frequencies;  // True if the site is in the frequency track.
+  RowVector4d frequencies;
+  double rate;  // Germline mutation rate from the rate track.
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+ * Sites that are passed between the stages of the pipeline. The bases columns
+ * of site i and individual j are bases[offsets[k], offsets[k + 1]) where
+ * k = i * kIndividualCount + j, which is empty if the file does not have the
+ * site.
+ */
+struct SiteBatch {
+  long sequence;  // Order of the batch in the pileup files.
+  int size;  // Number of sites.
+  vector<string> contigs;  // Contigs of the batch, usually one.
+  vector<int> contig_indices;  // Contig of each site in contigs.
+  vector<int> positions;
+  string references;  // Reference nucleotide of each site.
+  string bases;  // Bases columns of all sites.
+  vector<size_t> offsets;
+  vector<char> ref_nucleotides;  // Reference of each column.
+  vector<ReadData> reads;  // Counted by the parse workers.
+  vector<SiteValues, Eigen::aligned_allocator<SiteValues>> values;
+  vector<double> probabilities;  // Calculated by the score workers.
+};
+
+// Forward declarations.
+void ResolveSite(const SiteInputs &inputs, const string &contig, int position,
+                 char ref_nucleotide, SiteValues &values);
+bool FillBatch(PileupMerger &merger, const SiteInputs &inputs,
+               SiteBatch &batch);
+void CountBatch(SiteBatch &batch);
+
+/**
+ * Returns the probability of mutation of a single site with any of the models.
+ * If a rate track is given, the site is scored with its site-specific germline
+ * mutation rate. The population priors are those of the population allele
+ * frequencies of the site if it is in the frequency track, or otherwise those
+ * of the reference nucleotide of the site if reference_priors is true.
+ *
+ * @param  params   GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  data_vec Reads of the child, mother and father.
+ * @param  inputs   Site-specific inputs.
+ * @param  values   Values of the inputs at the site from ResolveSite().
+ * @return          Probability of mutation.
+ */
+template <typename Model>
+double ScoreSite(Model &params, const ReadDataVector &data_vec,
+                 const SiteInputs &inputs, const SiteValues &values) {
+  if (inputs.reference_priors) {
+    params.SetReference(values.reference);
+  }
+  if (inputs.frequency_track != nullptr) {
+    if (values.has_frequencies) {
+      params.SetSiteFrequencies(values.frequencies);
+    } else {
+      params.ClearSiteFrequencies();
+    }
+  }
+  if (inputs.rate_track == nullptr) {
+    return (double) params.MutationProbability(data_vec);
+  }
+  return (double) params.MutationProbability(data_vec, values.rate);
+}
+
+/**
+ * Calculates the probability of every site of a counted batch.
+ *
+ * @param  params GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  inputs Site-specific inputs.
+ * @param  batch  Batch of sites.
+ */
+template <typename Model>
+void ScoreBatch(Model &params, const SiteInputs &inputs, SiteBatch &batch) {
+  ReadDataVector data_vec(kIndividualCount);
+  batch.probabilities.resize(batch.size);
+  for (int i = 0; i < batch.size; ++i) {
+    for (int j = 0; j < kIndividualCount; ++j) {
+      data_vec[j] = batch.reads[i * kIndividualCount + j];
+    }
+    batch.probabilities[i] = ScoreSite(params, data_vec, inputs,
+                                       batch.values[i]);
+  }
+}
+
+/**
+ * Scores all merged sites with parse_threads parse workers and score_threads
+ * score workers, and writes every site whose probability passes threshold in
+ * the order of the sites.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object
+ *                       that is copied by each score worker.
+ * @param  merger        Merger of the pileup files.
+ * @param  inputs        Site-specific inputs.
+ * @param  parse_threads Number of parse workers. Must at least be 1.
+ * @param  score_threads Number of score workers. Must at least be 1.
+ * @param  threshold     Minimum probability that is written.
+ * @param  writer        Writer of the sites that pass threshold.
+ */
+template <typename Model>
+void ScorePileupPipeline(const Model &params, PileupMerger &merger,
+                         const SiteInputs &inputs, int parse_threads,
+                         int score_threads, double threshold,
+                         SiteWriter &writer) {
+  const int batch_count = (parse_threads + score_threads + 2) *
+                          kPipelineBatchesPerThread;
+  vector<SiteBatch> batches(batch_count);
+  BatchQueue<SiteBatch *> free_queue(batch_count, 1);
+  BatchQueue<SiteBatch *> parse_queue(batch_count, 1);
+  BatchQueue<SiteBatch *> score_queue(batch_count, parse_threads);
+  BatchQueue<SiteBatch *> write_queue(batch_count, score_threads);
+  for (SiteBatch &batch : batches) {
+    free_queue.Push(&batch);
+  }
+
+  vector<thread> threads;
+  threads.emplace_back([&]() {  // Reader.
+    SiteBatch *batch = nullptr;
+    for (long sequence = 0; ; ++sequence) {
+      free_queue.Pop(batch);
+      batch->sequence = sequence;
+      if (!FillBatch(merger, inputs, *batch)) {
+        break;
+      }
+      parse_queue.Push(batch);
+    }
+    parse_queue.Done();
+  });
+  for (int i = 0; i < parse_threads; ++i) {
+    threads.emplace_back([&]() {
+      SiteBatch *batch = nullptr;
+      while (parse_queue.Pop(batch)) {
+        CountBatch(*batch);
+        score_queue.Push(batch);
+      }
+      score_queue.Done();
+    });
+  }
+  for (int i = 0; i < score_threads; ++i) {
+    threads.emplace_back([&]() {
+      Model worker_params(params);
+      SiteBatch *batch = nullptr;
+      while (score_queue.Pop(batch)) {
+        ScoreBatch(worker_params, inputs, *batch);
+        write_queue.Push(batch);
+      }
+      write_queue.Done();
+    });
+  }
+
+  // Writer. Batch s waits in slot s % batch_count until the batches before it
+  // are written, which is a free slot because at most batch_count exist.
+  vector<SiteBatch *> pending(batch_count, nullptr);
+  long next_sequence = 0;
+  SiteBatch *batch = nullptr;
+  while (write_queue.Pop(batch)) {
+    pending[batch->sequence % batch_count] = batch;
+    while (pending[next_sequence % batch_count] != nullptr) {
+      SiteBatch *&next = pending[next_sequence % batch_count];
+      for (int i = 0; i < next->size; ++i) {
+        if (next->probabilities[i] >= writer.Threshold(threshold)) {
+          const string &contig = next->contigs[next->contig_indices[i]];
+          writer.Write(StringView(contig.data(), contig.size()),
+                       next->positions[i], next->references[i],
+                       &next->reads[i * kIndividualCount],
+                       next->probabilities[i]);
+        }
+      }
+      free_queue.Push(next);
+      next = nullptr;
+      next_sequence++;
+    }
+  }
+
+  for (thread &worker : threads) {
+    worker.join();
+  }
+}
+
+#endif
@@ -0,0 +1,331 @@
+/**
+ * @file pileup_shard.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the functions needed to split
+ * pileup files into shards and of the PileupProbe class.
+ *
+ * See top of pileup_shard.h for a complete description.
+ */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gzip_reader.h"
+#include "pileup_shard.h"
+
+// Number of bytes that PileupProbe reads at a time.
+const size_t kProbeChunkSize = 64 << 10;
+
+
+/**
+ * Constructor that opens the file. The file must be a regular file.
+ *
+ * @param  file_name Pileup file name.
+ */
+PileupProbe::PileupProbe(const string &file_name)
+    : fd_{-1}, size_{0}, chunk_(kProbeChunkSize + 1) {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd_ == -1 || fstat(fd_, &file_stat) != 0 ||
+      !S_ISREG(file_stat.st_mode)) {
+    Die("Only regular pileup files can be split into shards.");
+  }
+  size_ = file_stat.st_size;
+
+  char magic[2];
+  if (pread(fd_, magic, 2, 0) == 2 && IsGzipData(magic, 2)) {
+    Die("Compressed pileup files cannot be split into shards.");
+  }
+}
+
+/**
+ * Destructor that closes the file.
+ */
+PileupProbe::~PileupProbe() {
+  close(fd_);
+}
+
+/**
+ * Reads the coordinate of the first line that starts at or after an offset.
+ *
+ * @param  offset     Byte offset.
+ * @param  coordinate Coordinate of the line.
+ * @return            False if no line starts at or after offset.
+ */
+bool PileupProbe::LineAt(off_t offset, PileupCoordinate &coordinate) {
+  off_t start = 0;
+  if (offset > 0) {
+    off_t newline = PileupProbe::FindNewline(offset - 1);
+    if (newline == -1) {
+      return false;
+    }
+    start = newline + 1;
+  }
+  if (start >= size_) {
+    return false;
+  }
+
+  ssize_t bytes = 0;
+  do {
+    bytes = pread(fd_, chunk_.data(), kProbeChunkSize, start);
+  } while (bytes == -1 && errno == EINTR);
+  if (bytes <= 0) {
+    Die("Pileup file cannot be read.");
+  }
+  chunk_[bytes] = '\0';  // Terminates the position for strtol().
+  const char *tab = static_cast<const char*>(memchr(chunk_.data(), '\t', bytes));
+  if (tab == nullptr) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  coordinate.offset = start;
+  coordinate.contig.assign(chunk_.data(), tab - chunk_.data());
+  coordinate.position = strtol(tab + 1, nullptr, 10);
+  return true;
+}
+
+/**
+ * Reads the coordinate of the last line.
+ *
+ * @param  coordinate Coordinate of the line.
+ * @return            False if the file is empty.
+ */
+bool PileupProbe::LastLine(PileupCoordinate &coordinate) {
+  off_t end = size_ - 1;  // Skips the newline of the last line.
+  while (end > 0) {
+    off_t begin = max(end - (off_t) kProbeChunkSize, (off_t) 0);
+    ssize_t bytes = 0;
+    do {
+      bytes = pread(fd_, chunk_.data(), end - begin, begin);
+    } while (bytes == -1 && errno == EINTR);
+    if (bytes != end - begin) {
+      Die("Pileup file cannot be read.");
+    }
+    for (off_t i = bytes - 1; i >= 0; --i) {
+      if (chunk_[i] == '\n') {
+        return PileupProbe::LineAt(begin + i + 1, coordinate);
+      }
+    }
+    end = begin;
+  }
+  return PileupProbe::LineAt(0, coordinate);
+}
+
+/**
+ * Returns the contigs of the file in file order. Lines of a contig are
+ * contiguous, so only the ranges between lines of different contigs are
+ * bisected.
+ *
+ * @return  Contigs in file order.
+ */
+vector<string> PileupProbe::Contigs() {
+  vector<string> contigs;
+  PileupCoordinate first, last;
+  if (PileupProbe::LineAt(0, first) && PileupProbe::LastLine(last)) {
+    contigs.push_back(first.contig);
+    PileupProbe::ListContigs(first, last, contigs);
+  }
+  return contigs;
+}
+
+/**
+ * Returns the offset of the first line whose coordinate is not before the
+ * given coordinate by binary search.
+ *
+ * @param  coordinate   Coordinate to look for.
+ * @param  contig_ranks Order of the contigs.
+ * @return              Offset of the line or the file size if there is none.
+ */
+off_t PileupProbe::LowerBound(const PileupCoordinate &coordinate,
+                              const unordered_map<string, int> &contig_ranks) {
+  off_t low = 0;
+  off_t high = size_;
+  PileupCoordinate line;
+  while (low < high) {
+    off_t middle = low + (high - low) / 2;
+    if (!PileupProbe::LineAt(middle, line) ||
+        !IsBefore(line, coordinate, contig_ranks)) {
+      high = middle;
+    } else {
+      low = line.offset + 1;  // No line starts between middle and line.
+    }
+  }
+  return PileupProbe::LineAt(low, line) ? line.offset : size_;
+}
+
+off_t PileupProbe::size() const {
+  return size_;
+}
+
+/**
+ * Returns the offset of the first newline at or after an offset.
+ *
+ * @param  offset Byte offset.
+ * @return        Offset of the newline or -1 if there is none.
+ */
+off_t PileupProbe::FindNewline(off_t offset) {
+  while (offset < size_) {
+    ssize_t bytes = 0;
+    do {
+      bytes = pread(fd_, chunk_.data(), kProbeChunkSize, offset);
+    } while (bytes == -1 && errno == EINTR);
+    if (bytes <= 0) {
+      Die("Pileup file cannot be read.");
+    }
+    const char *newline = static_cast<const char*>(
+      memchr(chunk_.data(), '\n', bytes)
+    );
+    if (newline != nullptr) {
+      return offset + (newline - chunk_.data());
+    }
+    offset += bytes;
+  }
+  return -1;
+}
+
+/**
+ * Appends the contigs after the contig of first up to the contig of last.
+ *
+ * @param  first   Coordinate of a line.
+ * @param  last    Coordinate of a later line.
+ * @param  contigs Contigs in file order.
+ */
+void PileupProbe::ListContigs(const PileupCoordinate &first,
+                              const PileupCoordinate &last,
+                              vector<string> &contigs) {
+  if (first.contig == last.contig) {
+    return;
+  }
+  PileupCoordinate middle;
+  off_t offset = first.offset + max((last.offset - first.offset) / 2, (off_t) 1);
+  PileupProbe::LineAt(offset, middle);
+  if (middle.offset >= last.offset) {
+    PileupProbe::LineAt(first.offset + 1, middle);  // Line after first.
+    if (middle.offset >= last.offset) {
+      contigs.push_back(last.contig);  // The lines are adjacent.
+      return;
+    }
+  }
+  PileupProbe::ListContigs(first, middle, contigs);
+  PileupProbe::ListContigs(middle, last, contigs);
+}
+
+/**
+ * Splits the pileup files into at most shard_count shards of about the same
+ * number of bytes of the largest file.
+ *
+ * @param  file_names  Child, mother and father pileup file names.
+ * @param  shard_count Number of shards.
+ * @return             Shards in file order.
+ */
+vector<PileupShard> ShardPileups(const vector<string> &file_names,
+                                 int shard_count) {
+  vector<unique_ptr<PileupProbe>> probes;
+  vector<vector<string>> orders;
+  int guide = 0;  // Largest file.
+  for (int i = 0; i < kIndividualCount; ++i) {
+    probes.emplace_back(new PileupProbe(file_names[i]));
+    orders.push_back(probes[i]->Contigs());
+    if (probes[i]->size() > probes[guide]->size()) {
+      guide = i;
+    }
+  }
+  vector<string> contigs = MergeContigOrders(orders);
+  unordered_map<string, int> contig_ranks;
+  for (size_t i = 0; i < contigs.size(); ++i) {
+    contig_ranks[contigs[i]] = i;
+  }
+
+  vector<PileupCoordinate> cuts;
+  for (int k = 1; k < shard_count; ++k) {
+    PileupCoordinate cut;
+    if (!probes[guide]->LineAt(probes[guide]->size() * k / shard_count, cut)) {
+      break;
+    }
+    if (cuts.empty() || IsBefore(cuts.back(), cut, contig_ranks)) {
+      cuts.push_back(cut);
+    }
+  }
+
+  vector<PileupShard> shards(cuts.size() + 1);
+  for (int i = 0; i < kIndividualCount; ++i) {
+    shards.front().begins[i] = 0;
+    shards.back().ends[i] = probes[i]->size();
+    for (size_t k = 0; k < cuts.size(); ++k) {
+      off_t offset = probes[i]->LowerBound(cuts[k], contig_ranks);
+      shards[k].ends[i] = offset;
+      shards[k + 1].begins[i] = offset;
+    }
+  }
+  for (size_t k = 0; k < shards.size(); ++k) {
+    shards[k].is_first = k == 0;
+    if (k > 0) {
+      int rank = contig_ranks[cuts[k - 1].contig];
+      shards[k].skipped_contigs.assign(contigs.begin(), contigs.begin() + rank);
+    }
+  }
+  return shards;
+}
+
+/**
+ * Merges the contig orders of several files into one order. Contigs that are
+ * missing from the first file are placed after the contig that precedes them
+ * in their own file.
+ *
+ * @param  orders Contigs of each file in file order.
+ * @return        Contigs of all files.
+ */
+vector<string> MergeContigOrders(const vector<vector<string>> &orders) {
+  vector<string> contigs;
+  for (const vector<string> &order : orders) {
+    for (size_t i = 0; i < order.size(); ++i) {
+      if (find(contigs.begin(), contigs.end(), order[i]) != contigs.end()) {
+        continue;
+      }
+      auto it = contigs.begin();
+      if (i > 0) {
+        it = find(contigs.begin(), contigs.end(), order[i - 1]) + 1;
+      }
+      contigs.insert(it, order[i]);
+    }
+  }
+  return contigs;
+}
+
+/**
+ * Returns true if PileupProbe can read a file, i.e. it is a regular file that
+ * is not compressed.
+ *
+ * @param  file_name Pileup file name.
+ * @return           False for pipes, standard input and compressed files.
+ */
+bool IsProbeable(const string &file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd == -1) {
+    return false;
+  }
+  char magic[2];
+  bool is_probeable = fstat(fd, &file_stat) == 0 &&
+                      S_ISREG(file_stat.st_mode) &&
+                      !(pread(fd, magic, 2, 0) == 2 && IsGzipData(magic, 2));
+  close(fd);
+  return is_probeable;
+}
+
+/**
+ * Returns true if a coordinate comes before another coordinate.
+ *
+ * @param  coordinate1  Coordinate of a line.
+ * @param  coordinate2  Coordinate of a line.
+ * @param  contig_ranks Order of the contigs.
+ * @return              True if coordinate1 comes before coordinate2.
+ */
+bool IsBefore(const PileupCoordinate &coordinate1,
+              const PileupCoordinate &coordinate2,
+              const unordered_map<string, int> &contig_ranks) {
+  int rank1 = contig_ranks.at(coordinate1.contig);
+  int rank2 = contig_ranks.at(coordinate2.contig);
+  return rank1 < rank2 ||
+         (rank1 == rank2 && coordinate1.position < coordinate2.position);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file pileup_shard.h
+ * @author Melissa Ip
+ *
+ * This file splits the pileup files of a trio into shards that can be merged
+ * and scored by independent worker threads, each with its own LineReader
+ * objects limited to the byte range of the shard in each file.
+ *
+ * A shard is a range of coordinates (contig, position), so the three files
+ * are cut at the same site even though they do not have the same lines. The
+ * cut sites are the lines at equal byte intervals of the largest file, which
+ * balances the shards by bytes rather than by contigs, and the byte offset of
+ * a cut site in each file is found by binary search with PileupProbe, which
+ * reads single lines at an offset. Comparing coordinates needs the order of
+ * the contigs, which is found by bisecting each file between lines of
+ * different contigs, so no file is read in full.
+ *
+ * The shards cover every line exactly once and are returned in file order, so
+ * concatenating their outputs gives the output of a sequential scan.
+ *
+ * Example usage:
+ *
+ *   vector<PileupShard> shards = ShardPileups({child, mother, father}, 64);
+ *   LineReader reader(child, shards[i].begins[0], shards[i].ends[0]);
+ */
+#ifndef PILEUP_SHARD_H
+#define PILEUP_SHARD_H
+
+#include <sys/types.h>
+#include <memory>
+#include <unordered_map>
+
+#include "trio_model.h"
+
+
+// Number of shards for each worker thread, so that threads that finish their
+// shards early take more of the remaining shards.
+const int kShardsPerThread = 4;
+
+/**
+ * Byte ranges of a shard in the child, mother and father pileup files.
+ */
+struct PileupShard {
+  off_t begins[kIndividualCount];
+  off_t ends[kIndividualCount];
+  bool is_first;  // True if the shard starts at the beginning of the files.
+  vector<string> skipped_contigs;  // Contigs that come before the shard.
+};
+
+/**
+ * Coordinate of a pileup line and the byte offset of its start.
+ */
+struct PileupCoordinate {
+  off_t offset;
+  string contig;
+  int position;
+};
+
+/**
+ * PileupProbe class header. Reads the coordinates of single lines of a
+ * regular pileup file with pread().
+ */
+class PileupProbe {
+ public:
+  PileupProbe(const string &file_name);
+  ~PileupProbe();
+  bool LineAt(off_t offset, PileupCoordinate &coordinate);  // First line that starts at or after offset.
+  bool LastLine(PileupCoordinate &coordinate);
+  vector<string> Contigs();  // Contigs in file order.
+  off_t LowerBound(const PileupCoordinate &coordinate,
+                   const unordered_map<string, int> &contig_ranks);  // Offset of the first line not before coordinate.
+  off_t size() const;
+
+ private:
+  PileupProbe(const PileupProbe &other);  // Not copyable.
+  PileupProbe& operator=(const PileupProbe &other);
+  off_t FindNewline(off_t offset);
+  void ListContigs(const PileupCoordinate &first,
+                   const PileupCoordinate &last, vector<string> &contigs);
+
+  // Instance member variables.
+  int fd_;
+  off_t size_;
+  vector<char> chunk_;
+};
+
+// Forward declarations.
+vector<PileupShard> ShardPileups(const vector<string> &file_names,
+                                 int shard_count);
+vector<string> MergeContigOrders(const vector<vector<string>> &orders);
+bool IsProbeable(const string &file_name);
+bool IsBefore(const PileupCoordinate &coordinate1,
+              const PileupCoordinate &coordinate2,
+              const unordered_map<string, int> &contig_ranks);
+
+#endif
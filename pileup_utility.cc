@@ -7,6 +7,8 @@
  *
  * See top of pileup_utility.h for a complete description.
  */
+#include <unistd.h>
+
 #include "pileup_utility.h"
  
 
@@ -38,17 +40,13 @@ string TrimHeader(ifstream &f) {
  * @return      Line without newline and has valid nucleotide reference.
  */
 string GetSequence(string &line) {
-  int sequence = 0;
-  int position = 0;
-  char ref_nucleotide;
-  
-  line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-  stringstream str(line);
-  str >> sequence;
-  str >> position;
-  str >> ref_nucleotide;
-
-  if (ref_nucleotide != 'N') {
+  while (!line.empty() && line.back() == '\n') {
+    line.pop_back();
+  }
+
+  PileupSite site;
+  if (ParsePileupLine(line.data(), line.size(), site) &&
+      site.ref_nucleotide != 'N') {
     return line;
   } else {
     return "";
@@ -57,48 +55,31 @@ string GetSequence(string &line) {
 
 /**
  * Parses pileup data into ReadData. Periods and commas match the
- * reference nucleotide.
+ * reference nucleotide. See CountBases() for the markers that are skipped.
  *
  * @param  line Read from a pileup file representing a single site sequence.
  * @return      ReadData.
  */
 ReadData GetReadData(const string &line) {
-  int sequence = 0;
-  int position = 0;
-  char ref_nucleotide;
-  int num_aligned_reads = 0;
-  string bases;
-
-  stringstream str(line);
-  str >> sequence;
-  str >> position;
-  // str.seekg(10, ios::beg);
-  str >> ref_nucleotide;
-  str >> num_aligned_reads;
-  str >> bases;
-
-  uint16_t matches = (count(bases.begin(), bases.end(), '.') +
-                      count(bases.begin(), bases.end(), ','));
-  uint16_t A = (count(bases.begin(), bases.end(), 'A') + 
-                count(bases.begin(), bases.end(), 'a'));
-  uint16_t C = (count(bases.begin(), bases.end(), 'C') + 
-                count(bases.begin(), bases.end(), 'c'));
-  uint16_t G = (count(bases.begin(), bases.end(), 'G') + 
-                count(bases.begin(), bases.end(), 'g'));
-  uint16_t T = (count(bases.begin(), bases.end(), 'T') + 
-                count(bases.begin(), bases.end(), 't'));
-
-  ReadData data;
-  if (ref_nucleotide == 'A') {
-    data = {matches, C, G, T};  
-  } else if (ref_nucleotide == 'C') {
-    data = {A, matches, G, T}; 
-  } else if (ref_nucleotide == 'G') {
-    data = {A, C, matches, T}; 
-  } else if (ref_nucleotide == 'T') {
-    data = {A, C, G, matches};
-  }
-  return data;
+  PileupSite site;
+  if (!ParsePileupLine(line.data(), line.size(), site)) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  return CountBases(site.bases, site.ref_nucleotide);
+}
+
+/**
+ * Returns the index of the reference nucleotide of a pileup line.
+ *
+ * @param  line Read from a pileup file representing a single site sequence.
+ * @return      Index of reference nucleotide or -1 if it is not A, C, G or T.
+ */
+int GetReferenceIndex(const string &line) {
+  PileupSite site;
+  if (!ParsePileupLine(line.data(), line.size(), site)) {
+    return -1;
+  }
+  return NucleotideIndex(site.ref_nucleotide);
 }
 
 /**
@@ -111,75 +92,781 @@ ReadData GetReadData(const string &line) {
  */
 double GetProbability(TrioModel &params, const string &child_line,
                       const string &mother_line, const string &father_line) {
-  ReadDataVector data_vec = {GetReadData(child_line),
-                             GetReadData(mother_line),
-                             GetReadData(father_line)};
-  return params.MutationProbability(data_vec);
+  PileupSite child_site, mother_site, father_site;
+  if (!ParsePileupLine(child_line.data(), child_line.size(), child_site) ||
+      !ParsePileupLine(mother_line.data(), mother_line.size(), mother_site) ||
+      !ParsePileupLine(father_line.data(), father_line.size(), father_site)) {
+    Die("Pileup line does not have the pileup columns.");
+  }
+  ReadDataVector data_vec = {
+    CountBases(child_site.bases, child_site.ref_nucleotide),
+    CountBases(mother_site.bases, mother_site.ref_nucleotide),
+    CountBases(father_site.bases, father_site.ref_nucleotide)
+  };
+  return ScoreSite(params, data_vec, SiteInputs(), SiteValues());
+}
+
+/**
+ * Site-specific tracks of options that are opened for one scan of the pileup
+ * files. Each shard opens its own tracks, because the tracks are streamed.
+ */
+struct SiteTracks {
+  SiteTracks(const PileupOptions &options, double default_rate);
+  void SkipContig(const string &contig);
+  void SetContigOrder(const vector<string> &contigs);
+  unique_ptr<RateTrack> rate_track;
+  unique_ptr<FrequencyTrack> frequency_track;
+  SiteInputs inputs;
+};
+
+/**
+ * Constructor that opens the rate track and the frequency file of options.
+ *
+ * @param  options      Options set by command line flags.
+ * @param  default_rate Germline mutation rate of sites outside of the rate
+ *                      track.
+ */
+SiteTracks::SiteTracks(const PileupOptions &options, double default_rate) {
+  if (!options.rate_track.empty()) {
+    rate_track.reset(new RateTrack(options.rate_track, default_rate));
+    inputs.rate_track = rate_track.get();
+  }
+  if (!options.frequency_file.empty()) {
+    frequency_track.reset(new FrequencyTrack(options.frequency_file));
+    inputs.frequency_track = frequency_track.get();
+  }
+  inputs.reference_priors = options.reference_priors;
+}
+
+/**
+ * Skips a contig that comes before the first site in every opened track.
+ *
+ * @param  contig Contig that is not queried.
+ */
+void SiteTracks::SkipContig(const string &contig) {
+  if (rate_track) {
+    rate_track->SkipContig(contig);
+  }
+  if (frequency_track) {
+    frequency_track->SkipContig(contig);
+  }
+}
+
+/**
+ * Sets the order of the contigs of the pileup files in every opened track.
+ *
+ * @param  contigs Contigs in pileup order.
+ */
+void SiteTracks::SetContigOrder(const vector<string> &contigs) {
+  if (rate_track) {
+    rate_track->SetContigOrder(contigs);
+  }
+  if (frequency_track) {
+    frequency_track->SetContigOrder(contigs);
+  }
+}
+
+/**
+ * Returns the checkpoint that a scan starts from, i.e. the checkpoint file of
+ * options if the scan is resumed, or the checkpoint of a scan that has not
+ * started.
+ *
+ * @param  inputs      Input file names.
+ * @param  options     Options set by command line flags.
+ * @param  shard_count Number of shards, 0 for a single scan.
+ * @return             Checkpoint.
+ */
+ScanCheckpoint OpenCheckpoint(const vector<string> &inputs,
+                              const PileupOptions &options, int shard_count) {
+  ScanCheckpoint current = StartCheckpoint(inputs, options.output_format);
+  current.shard_count = shard_count;
+  if (!options.resume) {
+    return current;
+  }
+  ScanCheckpoint checkpoint;
+  if (!ReadCheckpoint(options.checkpoint_file, checkpoint)) {
+    Die("Checkpoint file cannot be read.");
+  }
+  CheckResume(checkpoint, current);
+  return checkpoint;
+}
+
+/**
+ * Scores all sites of a PileupMerger, SamMerger, MultiPileupReader or
+ * TrioCountReader one after the other with the given model and writes every
+ * site that passes kThreshold. Sites with reads of each quality bin are scored
+ * by those, but are written with the total reads.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  merger        PileupMerger, SamMerger, MultiPileupReader or
+ *                       TrioCountReader object.
+ * @param  inputs        Site-specific inputs.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model, typename Merger>
+void ScoreSites(Model &params, Merger &merger, const SiteInputs &inputs,
+                SiteWriter &writer) {
+  TrioSite site;
+  SiteValues values;
+  while (merger.NextSite(site)) {
+    ResolveSite(inputs, merger.contig(), site.position, site.ref_nucleotide,
+                values);
+    double probability = ScoreSite(params, site.binned_vec.empty() ?
+                                   site.data_vec : site.binned_vec,
+                                   inputs, values);
+    if (probability >= writer.Threshold(kThreshold)) {
+      writer.Write(site.contig, site.position, site.ref_nucleotide,
+                   site.data_vec.data(), probability);
+    }
+  }
+}
+
+/**
+ * Scores all sites of a merger with the given model and writes every site
+ * that passes kThreshold. If a number of parse or score threads is
+ * given, the sites are scored by the multithreaded pipeline of
+ * pileup_pipeline.h. Works with every model.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  merger        Merger of the pileup files.
+ * @param  inputs        Site-specific inputs.
+ * @param  parse_threads Number of parse workers of the pipeline.
+ * @param  score_threads Number of score workers of the pipeline.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScoreMerged(Model &params, PileupMerger &merger, const SiteInputs &inputs,
+                 int parse_threads, int score_threads,
+                 SiteWriter &writer) {
+  if (parse_threads > 0 || score_threads > 0) {
+    ScorePileupPipeline(params, merger, inputs, max(parse_threads, 1),
+                        max(score_threads, 1), kThreshold, writer);
+    return;
+  }
+
+  ScoreSites(params, merger, inputs, writer);
+}
+
+/**
+ * Scores shards with options.shard_threads worker threads, one of which is the
+ * calling thread. Each worker takes the next shard that is left and scores it
+ * with its own copy of the model into a memory writer. The calling thread
+ * writes the shards in order after each of its own shards, so only the shards
+ * that finish ahead of an earlier shard are held in memory.
+ *
+ * If options sets checkpoints, the calling thread also writes a checkpoint
+ * with the number of shards that were written once the interval has passed,
+ * and a resumed scan starts at the first shard that was not written.
+ *
+ * @param  params      GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  inputs      Input file names, which checkpoints record.
+ * @param  shard_count Number of shards.
+ * @param  options     Options set by command line flags.
+ * @param  writer      Writer of the sites that pass kThreshold.
+ * @param  score_shard Function of the model of the worker, the index of a
+ *                     shard and its writer that scores the shard.
+ */
+template <typename Model, typename ScoreShard>
+void ScoreShardsInOrder(const Model &params, const vector<string> &inputs,
+                        int shard_count, const PileupOptions &options,
+                        SiteWriter &writer, ScoreShard score_shard) {
+  ScanCheckpoint checkpoint;
+  if (options.checkpoint_seconds > 0) {
+    checkpoint = OpenCheckpoint(inputs, options, shard_count);
+  }
+  const uint64_t resumed_count = checkpoint.written_count;
+  auto last_checkpoint = chrono::steady_clock::now();
+
+  vector<unique_ptr<SiteWriter>> shard_writers;
+  unique_ptr<atomic<bool>[]> is_scored(new atomic<bool>[shard_count]);
+  for (int k = 0; k < shard_count; ++k) {
+    shard_writers.emplace_back(new SiteWriter(options.output_format));
+    if (writer.top_count() > 0) {
+      shard_writers[k]->KeepTop(writer.top_count());
+    }
+    is_scored[k].store(false);
+  }
+  atomic<int> next_shard{checkpoint.next_shard};
+  int next_write = checkpoint.next_shard;
+  auto score_shards = [&](bool is_writer) {
+    Model worker_params(params);
+    for (int k = next_shard++; k < shard_count; k = next_shard++) {
+      score_shard(worker_params, k, *shard_writers[k]);
+      is_scored[k].store(true, memory_order_release);
+      if (!is_writer) {
+        continue;
+      }
+
+      const int previous_write = next_write;
+      while (next_write < shard_count &&
+             is_scored[next_write].load(memory_order_acquire)) {
+        writer.Append(*shard_writers[next_write++]);
+      }
+      if (options.checkpoint_seconds > 0 && next_write > previous_write &&
+          chrono::steady_clock::now() - last_checkpoint >=
+          chrono::seconds(options.checkpoint_seconds)) {
+        checkpoint.output_size = writer.Sync();
+        checkpoint.written_count = resumed_count + writer.line_count();
+        checkpoint.next_shard = next_write;
+        WriteCheckpoint(options.checkpoint_file, checkpoint);
+        last_checkpoint = chrono::steady_clock::now();
+      }
+    }
+  };
+
+  vector<thread> threads;
+  for (int i = 1; i < options.shard_threads; ++i) {
+    threads.emplace_back(score_shards, false);
+  }
+  score_shards(true);
+  for (thread &worker : threads) {
+    worker.join();
+  }
+  while (next_write < shard_count) {
+    writer.Append(*shard_writers[next_write++]);
+  }
+}
+
+/**
+ * Splits the pileup files into shards of about the same size (see
+ * pileup_shard.h) and scores them in parallel with ScoreShardsInOrder(). Each
+ * shard is read with its own readers and tracks.
+ *
+ * @param  params       GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  pileups      Child, mother and father pileup file names.
+ * @param  default_rate Germline mutation rate of sites outside of the rate
+ *                      track.
+ * @param  options      Options set by command line flags.
+ * @param  writer       Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScorePileupShards(const Model &params, const vector<string> &pileups,
+                       double default_rate, const PileupOptions &options,
+                       SiteWriter &writer) {
+  vector<PileupShard> shards = ShardPileups(
+    pileups, options.shard_threads * kShardsPerThread
+  );
+  vector<string> contigs;
+  PileupContigOrder(pileups, contigs);
+  const QualityBins bins(options.quality_bins);
+  ScoreShardsInOrder(params, pileups, shards.size(), options, writer,
+                     [&](Model &worker_params, int k,
+                         SiteWriter &shard_writer) {
+    const PileupShard &shard = shards[k];
+    LineReader child(pileups[0], shard.begins[0], shard.ends[0],
+                     options.read_options);
+    LineReader mother(pileups[1], shard.begins[1], shard.ends[1],
+                      options.read_options);
+    LineReader father(pileups[2], shard.begins[2], shard.ends[2],
+                      options.read_options);
+    if (!child.is_open() || !mother.is_open() || !father.is_open()) {
+      Die("Input file cannot be read.");
+    }
+    SiteTracks tracks(options, default_rate);
+    for (const string &contig : shard.skipped_contigs) {
+      tracks.SkipContig(contig);
+    }
+    PileupMerger merger(child, mother, father, shard.is_first);
+    merger.SetContigOrder(contigs);
+    if (!options.quality_bins.empty()) {
+      merger.SetQualityBins(bins);
+    }
+    ScoreMerged(worker_params, merger, tracks.inputs, 0, 0, shard_writer);
+  });
+}
+
+/**
+ * Scores the sites of a trio count file that trio_convert wrote (see
+ * trio_counts.h), without parsing the pileups again. If options sets a number
+ * of shard threads, the records are split into shards of the same number of
+ * records that are scored in parallel with ScoreShardsInOrder(), and the
+ * tracks of each shard skip the contigs before its first record.
+ *
+ * @param  params       GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  file_name    Trio count file name.
+ * @param  default_rate Germline mutation rate of sites outside of the rate
+ *                      track.
+ * @param  options      Options set by command line flags.
+ * @param  writer       Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScoreTrioCounts(Model &params, const string &file_name,
+                     double default_rate, const PileupOptions &options,
+                     SiteWriter &writer) {
+  if (!options.regions.empty() || options.parse_threads > 0 ||
+      options.score_threads > 0) {
+    Die("Trio count files are scored without regions or the pipeline.");
+  }
+  if (options.shard_threads == 0) {
+    if (options.checkpoint_seconds > 0) {
+      Die("Checkpoints of trio count files are written with --shard-threads.");
+    }
+    TrioCountReader reader(file_name);
+    SiteTracks tracks(options, default_rate);
+    ScoreSites(params, reader, tracks.inputs, writer);
+    return;
+  }
+
+  const size_t record_count = TrioCountReader(file_name).record_count();
+  const int shard_count = min<size_t>(
+    options.shard_threads * kShardsPerThread, max<size_t>(record_count, 1)
+  );
+  ScoreShardsInOrder(params, {file_name}, shard_count, options, writer,
+                     [&](Model &worker_params, int k,
+                         SiteWriter &shard_writer) {
+    TrioCountReader reader(file_name);
+    const size_t first_record = record_count * k / shard_count;
+    reader.SetRange(first_record, record_count * (k + 1) / shard_count);
+    SiteTracks tracks(options, default_rate);
+    if (first_record < record_count) {
+      for (int i = 0; i < reader.contig_index(first_record); ++i) {
+        tracks.SkipContig(reader.contigs()[i]);
+      }
+    }
+    ScoreSites(worker_params, reader, tracks.inputs, shard_writer);
+  });
+}
+
+/**
+ * Counts the bases of the alignments of the child, mother and father SAM
+ * files at each position (see sam_pileup.h) and scores the merged sites with
+ * the given model.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  sams          Child, mother and father SAM file names.
+ * @param  default_rate  Germline mutation rate of sites outside of the rate
+ *                       track.
+ * @param  options       Options set by command line flags.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScoreSam(Model &params, const vector<string> &sams, double default_rate,
+              const PileupOptions &options, SiteWriter &writer) {
+  if (!options.regions.empty() || options.shard_threads > 0 ||
+      options.parse_threads > 0 || options.score_threads > 0) {
+    Die("SAM files are scored on one thread without regions.");
+  }
+  LineReader child_reader(sams[0], options.read_options);
+  LineReader mother_reader(sams[1], options.read_options);
+  LineReader father_reader(sams[2], options.read_options);
+  if (!child_reader.is_open() || !mother_reader.is_open() ||
+      !father_reader.is_open()) {
+    Die("Input file cannot be read.");
+  }
+  SamPileup child(child_reader, options.min_mapping_quality,
+                  options.min_base_quality);
+  SamPileup mother(mother_reader, options.min_mapping_quality,
+                   options.min_base_quality);
+  SamPileup father(father_reader, options.min_mapping_quality,
+                   options.min_base_quality);
+  SamMerger merger(child, mother, father);
+  SiteTracks tracks(options, default_rate);
+  ScoreSites(params, merger, tracks.inputs, writer);
+}
+
+/**
+ * Scores the child, mother and father samples of a multi-sample pileup, which
+ * may be standard input or a FIFO (see multi_pileup.h).
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  file_name     Multi-sample pileup file name, or "-" for standard
+ *                       input.
+ * @param  default_rate  Germline mutation rate of sites outside of the rate
+ *                       track.
+ * @param  options       Options set by command line flags.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScoreMultiPileup(Model &params, const string &file_name,
+                      double default_rate, const PileupOptions &options,
+                      SiteWriter &writer) {
+  if (!options.regions.empty() || options.shard_threads > 0 ||
+      options.parse_threads > 0 || options.score_threads > 0) {
+    Die("Multi-sample pileups are scored on one thread without regions.");
+  }
+  LineReader reader(file_name, options.read_options);
+  if (!reader.is_open()) {
+    Die("Input file cannot be read.");
+  }
+  MultiPileupReader pileup(reader, options.samples);
+  const QualityBins bins(options.quality_bins);
+  if (!options.quality_bins.empty()) {
+    pileup.SetQualityBins(bins);
+  }
+  SiteTracks tracks(options, default_rate);
+  ScoreSites(params, pileup, tracks.inputs, writer);
+}
+
+/**
+ * Scores all sites of the pileup files one after the other like ScorePileup()
+ * and writes a checkpoint once options.checkpoint_seconds have passed. The
+ * clock is checked every kCheckpointSiteInterval sites. A checkpoint records
+ * the offsets of the current lines of the merger after the last scored site,
+ * so a resumed scan opens the files at those offsets, merges that site again
+ * and skips it.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  pileups       Child, mother and father pileup file names.
+ * @param  default_rate  Germline mutation rate of sites outside of the rate
+ *                       track.
+ * @param  options       Options set by command line flags.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScorePileupCheckpointed(Model &params, const vector<string> &pileups,
+                             double default_rate,
+                             const PileupOptions &options,
+                             SiteWriter &writer) {
+  if (!options.regions.empty() || options.parse_threads > 0 ||
+      options.score_threads > 0) {
+    Die("Checkpoints are written for scans without regions or the pipeline.");
+  }
+  ScanCheckpoint checkpoint = OpenCheckpoint(pileups, options, 0);
+  const bool is_resumed = checkpoint.output_size >= 0;
+  const uint64_t resumed_count = checkpoint.written_count;
+
+  vector<unique_ptr<LineReader>> readers;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    readers.emplace_back(new LineReader(pileups[i], options.read_options));
+    if (!readers[i]->is_open()) {
+      Die("Input file cannot be read.");
+    } else if (readers[i]->is_compressed() && !readers[i]->is_bgzf()) {
+      Die("Checkpoints need uncompressed or BGZF compressed pileup files.");
+    }
+    if (is_resumed && checkpoint.offsets[i] == -1) {
+      readers[i]->SetRange(0, 0);  // The file was exhausted.
+    } else if (is_resumed) {
+      readers[i]->SetRange(checkpoint.offsets[i], numeric_limits<off_t>::max());
+    }
+  }
+  PileupMerger merger(*readers[0], *readers[1], *readers[2], !is_resumed);
+  vector<string> contigs;
+  PileupContigOrder(pileups, contigs);
+  merger.SetContigOrder(contigs);
+  const QualityBins bins(options.quality_bins);
+  if (!options.quality_bins.empty()) {
+    merger.SetQualityBins(bins);
+  }
+  SiteTracks tracks(options, default_rate);
+  if (is_resumed) {
+    merger.Resume(checkpoint.contig, checkpoint.finished_contigs);
+    for (const string &contig : checkpoint.finished_contigs) {
+      tracks.SkipContig(contig);
+    }
+  }
+
+  TrioSite site;
+  SiteValues values;
+  auto last_checkpoint = chrono::steady_clock::now();
+  uint64_t site_count = 0;
+  while (merger.NextSite(site)) {
+    if (is_resumed && site_count == 0 && site.position == checkpoint.position &&
+        merger.contig() == checkpoint.contig) {
+      site_count++;  // Scored before the checkpoint.
+      continue;
+    }
+    ResolveSite(tracks.inputs, merger.contig(), site.position,
+                site.ref_nucleotide, values);
+    double probability = ScoreSite(params, site.binned_vec.empty() ?
+                                   site.data_vec : site.binned_vec,
+                                   tracks.inputs, values);
+    if (probability >= writer.Threshold(kThreshold)) {
+      writer.Write(site.contig, site.position, site.ref_nucleotide,
+                   site.data_vec.data(), probability);
+    }
+    checkpoint.scanned_count++;
+
+    if (++site_count % kCheckpointSiteInterval == 0 &&
+        chrono::steady_clock::now() - last_checkpoint >=
+        chrono::seconds(options.checkpoint_seconds)) {
+      checkpoint.output_size = writer.Sync();
+      checkpoint.written_count = resumed_count + writer.line_count();
+      for (int i = 0; i < kIndividualCount; ++i) {
+        checkpoint.offsets[i] = merger.head_offset(i);
+      }
+      checkpoint.contig = merger.contig();
+      checkpoint.position = site.position;
+      checkpoint.finished_contigs = merger.finished_contigs();
+      WriteCheckpoint(options.checkpoint_file, checkpoint);
+      last_checkpoint = chrono::steady_clock::now();
+    }
+  }
+}
+
+/**
+ * Scores all sites of the pileup files with the given model. The files are
+ * merged on (contig, position) by PileupMerger, so they do not need to be
+ * line-aligned. If options sets a BED file, only its regions are read with
+ * the pileup index of each file. Otherwise the files are scanned in shards if
+ * options sets a number of shard threads. Other scans may use the pipeline.
+ * SAM files are counted and scored by ScoreSam() instead, and a trio count file
+ * is scored by ScoreTrioCounts(). Single scans with checkpoints are scored by
+ * ScorePileupCheckpointed(), and a multi-sample pileup by ScoreMultiPileup().
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  pileups       Child, mother and father pileup file names, or the trio
+ *                       count or multi-sample pileup file name.
+ * @param  default_rate  Germline mutation rate of sites outside of the rate
+ *                       track.
+ * @param  options       Options set by command line flags.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename Model>
+void ScorePileup(Model &params, const vector<string> &pileups,
+                 double default_rate, const PileupOptions &options,
+                 SiteWriter &writer) {
+  if (options.sam) {
+    ScoreSam(params, pileups, default_rate, options, writer);
+    return;
+  } else if (options.trio_counts) {
+    ScoreTrioCounts(params, pileups[0], default_rate, options, writer);
+    return;
+  } else if (options.mpileup) {
+    ScoreMultiPileup(params, pileups[0], default_rate, options, writer);
+    return;
+  } else if (options.shard_threads > 0 && options.regions.empty()) {
+    ScorePileupShards(params, pileups, default_rate, options, writer);
+    return;
+  } else if (options.checkpoint_seconds > 0) {
+    ScorePileupCheckpointed(params, pileups, default_rate, options, writer);
+    return;
+  }
+
+  LineReader child(pileups[0], options.read_options);
+  LineReader mother(pileups[1], options.read_options);
+  LineReader father(pileups[2], options.read_options);
+  if (!child.is_open() || !mother.is_open() || !father.is_open()) {
+    Die("Input file cannot be read.");
+  }
+  SiteTracks tracks(options, default_rate);
+  PileupMerger merger(child, mother, father, options.regions.empty());
+  const QualityBins bins(options.quality_bins);
+  if (!options.quality_bins.empty()) {
+    merger.SetQualityBins(bins);
+  }
+  vector<string> contigs;  // Empty if the contig order is not known.
+  vector<PileupRegion> regions;
+  if (!options.regions.empty()) {
+    regions = LocateRegions(options.regions, pileups, contigs);
+    tracks.SetContigOrder(contigs);  // Skips contigs outside of the regions.
+    merger.SetRegions(regions);
+  } else {
+    PileupContigOrder(pileups, contigs);
+  }
+  merger.SetContigOrder(contigs);
+  ScoreMerged(params, merger, tracks.inputs, options.parse_threads,
+              options.score_threads, writer);
+}
+
+/**
+ * Scores the sites of the pileup files in the two phases of distinct_trios.h.
+ * The sites are counted into a histogram of distinct trios with the readers of
+ * ScorePileup(), and each distinct trio is scored once with
+ * max(shard_threads, score_threads) threads. A histogram writer then gets
+ * every distinct trio, and any other writer gets the sites that pass
+ * kThreshold, whose probabilities are looked up in another pass. Rate tracks
+ * and population frequencies are not supported, because the probability of a
+ * trio then depends on its site.
+ *
+ * @param  params        GenericTrioModel or GenericUnorderedTrioModel object.
+ * @param  pileups       Child, mother and father pileup file names, or the trio
+ *                       count file name.
+ * @param  default_rate  Germline mutation rate of sites outside of the rate
+ *                       track.
+ * @param  options       Options set by command line flags.
+ * @param  writer        Writer of the histogram or of the sites that pass
+ *                       kThreshold.
+ */
+template <typename Model>
+void ScoreDistinctTrios(const Model &params, const vector<string> &pileups,
+                        double default_rate, const PileupOptions &options,
+                        SiteWriter &writer) {
+  if (!options.rate_track.empty() || !options.frequency_file.empty()) {
+    Die("Distinct trios are scored without a rate track or frequencies.");
+  } else if (options.mpileup && !writer.is_histogram()) {
+    Die("Distinct trios of a multi-sample pileup, which is read once, are "
+        "written with --output-format histogram.");
+  }
+  PileupOptions pass_options(options);
+  pass_options.output_format = "probabilities";  // Nothing is written.
+  TrioHistogram histogram;
+  {
+    TrioCounter counter(histogram);
+    SiteWriter counted(pass_options.output_format);
+    ScorePileup(counter, pileups, default_rate, pass_options, counted);
+  }  // Flushes the counter.
+  histogram.Finish();
+  ScoreHistogram(params, histogram, options.reference_priors,
+                 max(max(options.shard_threads, options.score_threads), 1));
+  histogram.BuildLookup();
+
+  if (writer.is_histogram()) {
+    ReadData reads[kIndividualCount];
+    for (const DistinctTrioEntry &entry : histogram.entries()) {
+      for (int i = 0; i < kIndividualCount; ++i) {
+        reads[i].key = entry.trio.keys[i];
+      }
+      const char ref_nucleotide = entry.trio.reference == -1 ?
+                                  'N' : "ACGT"[entry.trio.reference];
+      writer.WriteDistinct(reads, ref_nucleotide, entry.probability,
+                           entry.site_count);
+    }
+    return;
+  }
+  pass_options.output_format = options.output_format;
+  TrioLookup lookup(histogram);
+  ScorePileup(lookup, pileups, default_rate, pass_options, writer);
+}
+
+/**
+ * Creates the model selected by options with the given scalar type and
+ * Likelihood policy and scores all sites of the pileup files. Sets the
+ * sequencing error rates and dirichlet dispersions of each individual, and the
+ * error rates of the base quality bins if options sets any. The
+ * default rate of the rate track is the global germline mutation rate of the
+ * model.
+ *
+ * @param  options       Options set by command line flags.
+ * @param  pileups       Child, mother and father pileup file names.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <typename T, template <typename> class Likelihood>
+void ScorePileupWith(const PileupOptions &options,
+                     const vector<string> &pileups,
+                     SiteWriter &writer) {
+  GenericTrioModel<T, Likelihood> params;
+  for (size_t i = 0; i < options.sequencing_error_rates.size(); ++i) {
+    params.set_sequencing_error_rate(i, options.sequencing_error_rates[i]);
+  }
+  for (size_t i = 0; i < options.dirichlet_dispersions.size(); ++i) {
+    params.set_dirichlet_dispersion(i, options.dirichlet_dispersions[i]);
+  }
+  if (!options.quality_bins.empty()) {
+    if (options.sam || options.trio_counts || options.distinct_trios ||
+        options.parse_threads > 0 || options.score_threads > 0) {
+      Die("Quality bins are scored without SAM files, trio counts, distinct "
+          "trios or the pipeline.");
+    }
+    const vector<double> rates = QualityBins(options.quality_bins).ErrorRates();
+    params.set_quality_error_rates(vector<T>(rates.begin(), rates.end()));
+  }
+
+  double default_rate = params.germline_mutation_rate();
+  if (options.unordered) {
+    GenericUnorderedTrioModel<T, Likelihood> unordered_params(params);
+    if (options.distinct_trios) {
+      ScoreDistinctTrios(unordered_params, pileups, default_rate, options,
+                         writer);
+    } else {
+      ScorePileup(unordered_params, pileups, default_rate, options,
+                  writer);
+    }
+  } else if (options.distinct_trios) {
+    ScoreDistinctTrios(params, pileups, default_rate, options, writer);
+  } else {
+    ScorePileup(params, pileups, default_rate, options, writer);
+  }
+}
+
+/**
+ * Selects the scalar type of the model from options.precision and scores all
+ * sites of the pileup files with the given Likelihood policy.
+ *
+ * @param  options       Options set by command line flags.
+ * @param  pileups       Child, mother and father pileup file names.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+template <template <typename> class Likelihood>
+void ScorePileupWithPrecision(const PileupOptions &options,
+                              const vector<string> &pileups,
+                              SiteWriter &writer) {
+  if (options.precision == "float") {
+    ScorePileupWith<float, Likelihood>(options, pileups, writer);
+  } else if (options.precision == "long double") {
+    ScorePileupWith<long double, Likelihood>(options, pileups, writer);
+  } else {
+    ScorePileupWith<double, Likelihood>(options, pileups, writer);
+  }
+}
+
+/**
+ * Selects the Likelihood policy from options.multinomial and scores all sites
+ * of the pileup files.
+ *
+ * @param  options       Options set by command line flags.
+ * @param  pileups       Child, mother and father pileup file names.
+ * @param  writer        Writer of the sites that pass kThreshold.
+ */
+void ScorePileupWithLikelihood(const PileupOptions &options,
+                               const vector<string> &pileups,
+                               SiteWriter &writer) {
+  if (options.multinomial) {
+    ScorePileupWithPrecision<MultinomialLikelihood>(options, pileups,
+                                                    writer);
+  } else {
+    ScorePileupWithPrecision<DirichletMultinomialLikelihood>(
+      options, pileups, writer
+    );
+  }
 }
 
 /**
  * Opens and parses all pileup files. All valid sequences are converted to
  * ReadData and used to calculate the probability at their sequence position.
- * The output file is tab separated and each sequence is on a new line.
- * The first column represents the sequence position and the second column
- * represents the probability at that sequence.
+ * Each site that passes kThreshold is written on a new line in the format of
+ * options.output_format (see site_writer.h) as soon as it is scored, unless
+ * options sets a number of top sites, which are kept in a bounded heap and
+ * written at the end.
+ *
+ * If options sets checkpoints, the output is written to <output>.partial with
+ * checkpoints in <output>.checkpoint, and is renamed to the output once the
+ * scan is complete. options.resume continues the partial output of the
+ * checkpoint if there is one.
  *
  * @param  file_name     Output file name.
- * @param  child_pileup  Chile pileup file name.
+ * @param  child_pileup  Chile pileup file name, or the trio count file name if
+ *                       options.trio_counts is set, or the multi-sample pileup
+ *                       file name if options.mpileup is set.
  * @param  mother_pileup Mother pileup file name.
  * @param  father_pileup Father pileup file name.
+ * @param  options       Options set by command line flags.
  */
 void ProcessPileup(const string &file_name, const string &child_pileup,
-                   const string &mother_pileup, const string &father_pileup) {
-  ifstream child(child_pileup);
-  ifstream mother(mother_pileup);
-  ifstream father(father_pileup);
-  if (!child.is_open() || 0 != child.fail() || !mother.is_open() ||
-      0 != mother.fail() || !father.is_open() || 0 != father.fail()) {
-    Die("Input file cannot be read.");
+                   const string &mother_pileup, const string &father_pileup,
+                   const PileupOptions &options) {
+  const vector<string> pileups = {child_pileup, mother_pileup, father_pileup};
+  if (options.checkpoint_seconds == 0) {
+    SiteWriter writer(file_name, options.output_format);
+    if (options.top_sites > 0) {
+      if (writer.is_histogram()) {
+        Die("Top sites are not kept with histogram output.");
+      }
+      writer.KeepTop(options.top_sites);
+    }
+    ScorePileupWithLikelihood(options, pileups, writer);
+    return;
+  }
+  if (options.sam || options.mpileup || options.distinct_trios ||
+      options.output_format == "binary" || options.top_sites > 0) {
+    Die("Checkpoints are not written for SAM files, multi-sample pileups, "
+        "distinct trios, binary output or top sites.");
+  }
+
+  PileupOptions scan_options(options);
+  scan_options.checkpoint_file = file_name + kCheckpointExtension;
+  const string partial_name = file_name + kPartialExtension;
+  ScanCheckpoint checkpoint;
+  scan_options.resume = options.resume &&
+                        ReadCheckpoint(scan_options.checkpoint_file,
+                                       checkpoint);
+  {
+    SiteWriter writer(partial_name, options.output_format,
+                      scan_options.resume ? checkpoint.output_size : -1);
+    ScorePileupWithLikelihood(scan_options, pileups, writer);
+    writer.Sync();
+  }
+  if (rename(partial_name.c_str(), file_name.c_str()) == -1) {
+    Die("Partial output file cannot be renamed.");
   }
-  
-  TrioModel params;
-  vector<double> probabilities;
-
-  // Removes N sequences and writes probability of first valid line.
-  string child_line = TrimHeader(child);
-  string mother_line = TrimHeader(mother);
-  string father_line = TrimHeader(father);
-  if (child_line.empty() || mother_line.empty() || father_line.empty()) {
-    Die("Pileup file does not contain valid sequences (no N reference).");
-  }
-
-  int sequence = 0;
-  int position = 0;
-  stringstream str(child_line);
-  str >> sequence;
-  str >> position;
-  double probability = GetProbability(params, child_line, mother_line,
-                                      father_line);
-  if (probability >= kThreshold) {
-    probabilities.push_back(probability);
-  }
-
-  // Writes probabilities of the rest of the sequences.
-  while (getline(child, child_line)) {
-    getline(mother, mother_line);
-    getline(father, father_line);
-    stringstream str(child_line);
-    str >> sequence;
-    str >> position;
-    probability = GetProbability(params, child_line, mother_line, father_line);
-    if (probability >= kThreshold) {
-      probabilities.push_back(probability);
-    }
-  }
-
-  child.close();
-  mother.close();
-  father.close();
-
-  ofstream fout(file_name);
-  ostream_iterator<double> output_iter(fout, "\n");
-  copy(probabilities.begin(), probabilities.end(), output_iter);
-  fout.close();
+  unlink(scan_options.checkpoint_file.c_str());
 }
@@ -8,28 +8,83 @@
  * http://samtools.sourceforge.net/pileup.shtml
  *
  * This can create a TrioModel object using the parsed sequencing reads,
- * and write the probability of mutation to a text file.
+ * and write the probability of mutation to a text file with SiteWriter.
+ *
+ * Long scans can write checkpoints (see scan_checkpoint.h) every
+ * PileupOptions::checkpoint_seconds seconds and resume from the last one.
  */
 #ifndef PILEUP_UTILITY_H
 #define PILEUP_UTILITY_H
 
+#include <chrono>
 #include <fstream>
 #include <iterator>
+#include <memory>
 #include <sstream>
 
-#include "trio_model.h"
+#include "distinct_trios.h"
+#include "multi_pileup.h"
+#include "pileup_pipeline.h"
+#include "pileup_shard.h"
+#include "sam_pileup.h"
+#include "scan_checkpoint.h"
+#include "trio_counts.h"
+#include "unordered_trio_model.h"
 
 
 // Any greater probability than this number is printed.
 const double kThreshold = 0.01;
 
+/**
+ * Options for ProcessPileup() that are set by command line flags in
+ * pileup_driver.cc.
+ */
+struct PileupOptions {
+  PileupOptions() : unordered{false}, multinomial{false}, precision{"double"},
+                    reference_priors{false}, parse_threads{0},
+                    score_threads{0}, shard_threads{0},
+                    sam{false}, min_mapping_quality{0},
+                    min_base_quality{0}, output_format{"probabilities"},
+                    trio_counts{false}, distinct_trios{false},
+                    checkpoint_seconds{0}, resume{false}, mpileup{false},
+                    samples{0, 1, 2}, top_sites{0} {}
+  bool unordered;  // Scores with UnorderedTrioModel instead of TrioModel.
+  bool multinomial;  // Uses MultinomialLikelihood instead of the Dirichlet multinomial.
+  string precision;  // Scalar type of the model: float, double or long double.
+  string rate_track;  // File of site-specific germline mutation rates if not empty.
+  bool reference_priors;  // Conditions the population priors on the reference nucleotide.
+  string frequency_file;  // File of population allele frequencies if not empty.
+  vector<double> sequencing_error_rates;  // Child, mother and father if not empty.
+  vector<double> dirichlet_dispersions;  // Child, mother and father if not empty.
+  int parse_threads;  // Scores with the pipeline if either thread count is not 0.
+  int score_threads;
+  int shard_threads;  // Scans shards of the files in parallel if not 0.
+  string regions;  // BED file of the regions that are scored if not empty.
+  vector<int> quality_bins;  // Phred qualities that start each quality bin after the first, if not empty.
+  ReadOptions read_options;  // Read backend and threads that inflate each BGZF compressed file.
+  bool sam;  // Counts the bases of SAM files instead of pileup files.
+  int min_mapping_quality;  // Minimum mapping quality of SAM alignments.
+  int min_base_quality;  // Minimum base quality of SAM bases.
+  string output_format;  // sites, vcf, probabilities, binary or histogram.
+  bool trio_counts;  // Scores a trio count file instead of pileup files.
+  bool distinct_trios;  // Scores each distinct trio once (see distinct_trios.h).
+  int checkpoint_seconds;  // Seconds between checkpoints if not 0.
+  bool resume;  // Resumes from the checkpoint of the output if there is one.
+  string checkpoint_file;  // Set by ProcessPileup() if checkpoints are written.
+  bool mpileup;  // Reads the trio from one multi-sample pileup.
+  vector<int> samples;  // Sample index of child, mother and father in it.
+  size_t top_sites;  // Writes only this number of sites with the highest probabilities if not 0.
+};
+
 // Forward declarations.
 string GetSequence(string &line);
 string TrimHeader(ifstream &f);
 ReadData GetReadData(const string &line);
+int GetReferenceIndex(const string &line);
 double GetProbability(TrioModel &params, const string &child_line,
                       const string &mother_line, const string &father_line);
 void ProcessPileup(const string &file_name, const string &child_pileup,
-                   const string &mother_pileup, const string &father_pileup);
+                   const string &mother_pileup, const string &father_pileup,
+                   const PileupOptions &options=PileupOptions());
 
 #endif
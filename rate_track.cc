@@ -0,0 +1,87 @@
+/**
+ * @file rate_track.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the RateTrack class.
+ *
+ * See top of rate_track.h for a complete description.
+ */
+#include "rate_track.h"
+
+
+/**
+ * Constructor that opens the track file.
+ *
+ * @param  file_name    Track file name.
+ * @param  default_rate Rate of sites outside of all intervals.
+ */
+RateTrack::RateTrack(const string &file_name, double default_rate)
+    : track_{file_name}, default_rate_{default_rate}, has_interval_{false},
+      start_{0}, end_{0}, rate_{default_rate} {
+  if (!track_.is_open()) {
+    Die("Rate track cannot be read.");
+  }
+}
+
+/**
+ * Returns the germline mutation rate of a site. Moves the track to the contig
+ * of the site when the queries move to another contig and skips the intervals
+ * that end before the site.
+ *
+ * @param  contig   Contig of the site.
+ * @param  position 1-based position of the site as in the pileup files.
+ * @return          Rate of the interval that contains the site or the default
+ *                  rate.
+ */
+double RateTrack::Rate(const string &contig, int position) {
+  if (contig != query_contig_) {
+    query_contig_ = contig;
+    has_interval_ = track_.StartContig(contig) && RateTrack::ParseInterval();
+  }
+
+  int start = position - 1;  // Converts to 0-based coordinates.
+  while (has_interval_ && end_ <= start) {
+    has_interval_ = track_.NextLine() && RateTrack::ParseInterval();
+  }
+
+  if (has_interval_ && start_ <= start) {
+    return rate_;
+  } else {
+    return default_rate_;
+  }
+}
+
+/**
+ * Skips the intervals of a contig that comes before the first queried site,
+ * e.g. when a shard of the pileup files starts after the contig.
+ *
+ * @param  contig Contig that is not queried.
+ */
+void RateTrack::SkipContig(const string &contig) {
+  track_.SkipContig(contig);
+}
+
+/**
+ * Sets the order of the contigs in the pileup files, e.g. when only the
+ * regions of a BED file are scanned, so the track does not need to look ahead
+ * for contigs that it does not have.
+ *
+ * @param  contigs Contigs in pileup order.
+ */
+void RateTrack::SetContigOrder(const vector<string> &contigs) {
+  track_.SetContigOrder(contigs);
+}
+
+/**
+ * Parses the interval of the current line of the track.
+ *
+ * @return  True.
+ */
+bool RateTrack::ParseInterval() {
+  stringstream str(track_.line());
+  string contig;
+  if (!(str >> contig >> start_ >> end_ >> rate_) || rate_ < 0.0) {
+    Die("Rate track line is not in the format: contig start end rate.");
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file rate_track.h
+ * @author Melissa Ip
+ *
+ * The RateTrack class streams site-specific germline mutation rates from a
+ * tab separated track file alongside the pileup files. Each line is a BED-like
+ * interval with a 0-based start, an exclusive end and the rate of every site
+ * in the interval:
+ *
+ *   <contig>  <start>  <end>  <rate>
+ *
+ * Context classes such as CpG sites are given as intervals of their own, e.g.
+ * a CpG track with rate 2e-7. Sites outside of all intervals use the default
+ * rate. The intervals must be sorted by start within a contig. The track is
+ * streamed contig by contig with a TrackReader (see track_reader.h), so it may
+ * have contigs that the pileup files do not have and vice versa, but the
+ * contigs that both have must appear in the same order.
+ *
+ * Example usage:
+ *
+ *   RateTrack track("rates.bed", 2e-8);
+ *   double rate = track.Rate("1", 10468);  // 1-based pileup position.
+ *   double probability = params.MutationProbability(data, rate);
+ */
+#ifndef RATE_TRACK_H
+#define RATE_TRACK_H
+
+#include <sstream>
+
+#include "track_reader.h"
+
+
+/**
+ * RateTrack class header. See top of file for a complete description.
+ */
+class RateTrack {
+ public:
+  RateTrack(const string &file_name, double default_rate);
+  double Rate(const string &contig, int position);  // Positions must be queried in pileup order.
+  void SkipContig(const string &contig);  // Contig before the first query.
+  void SetContigOrder(const vector<string> &contigs);  // Contigs in pileup order.
+
+ private:
+  bool ParseInterval();
+
+  // Instance member variables.
+  TrackReader track_;
+  double default_rate_;
+  bool has_interval_;  // False at the end of the contig of the last query.
+  int start_;  // Current interval.
+  int end_;
+  double rate_;
+  string query_contig_;  // Contig of the last query.
+};
+
+#endif
@@ -2,7 +2,9 @@
  * @file read_dependent_data.cc
  * @author Melissa Ip
  *
- * This file contains the implementation of the ReadDependentData class.
+ * This file contains the implementation of the GenericReadDependentData class
+ * template. The template is explicitly instantiated for every scalar type at
+ * the bottom of this file.
  *
  * See top of read_dependent_data.h for a complete description.
  */
@@ -12,22 +14,24 @@
 /**
  * Default constructor.
  */
-ReadDependentData::ReadDependentData() {
-  sequencing_probability_mat = Matrix3_16d::Zero();
-  child_somatic_probability = RowVector16d::Zero();
-  mother_somatic_probability = RowVector16d::Zero();
-  father_somatic_probability = RowVector16d::Zero();
+template <typename T>
+GenericReadDependentData<T>::GenericReadDependentData() {
+  sequencing_probability_mat = Matrix3_16T<T>::Zero();
+  child_somatic_probability = RowVector16T<T>::Zero();
+  mother_somatic_probability = RowVector16T<T>::Zero();
+  father_somatic_probability = RowVector16T<T>::Zero();
 }
 
 /**
  * Constructor takes in ReadDataVector.
  */
-ReadDependentData::ReadDependentData(const ReadDataVector &data_vec)
+template <typename T>
+GenericReadDependentData<T>::GenericReadDependentData(const ReadDataVector &data_vec)
     : read_data_vec{data_vec} {
-  sequencing_probability_mat = Matrix3_16d::Zero();
-  child_somatic_probability = RowVector16d::Zero();
-  mother_somatic_probability = RowVector16d::Zero();
-  father_somatic_probability = RowVector16d::Zero();
+  sequencing_probability_mat = Matrix3_16T<T>::Zero();
+  child_somatic_probability = RowVector16T<T>::Zero();
+  mother_somatic_probability = RowVector16T<T>::Zero();
+  father_somatic_probability = RowVector16T<T>::Zero();
 };
 
 /**
@@ -36,7 +40,8 @@ ReadDependentData::ReadDependentData(const ReadDataVector &data_vec)
  * @param  other ReadDependentData object to be compared.
  * @return       True if the two ReadDependentData objects are equal to each other.
  */
-bool ReadDependentData::Equals(const ReadDependentData &other) {
+template <typename T>
+bool GenericReadDependentData<T>::Equals(const GenericReadDependentData &other) {
   bool attr_table[20] = {
     EqualsReadDataVector(read_data_vec, other.read_data_vec),
     max_elements == other.max_elements,
@@ -65,4 +70,9 @@ bool ReadDependentData::Equals(const ReadDependentData &other) {
   } else {
     return false;
   }
-}
\ No newline at end of file
+}
+
+// Explicit instantiations for every scalar type.
+template class GenericReadDependentData<float>;
+template class GenericReadDependentData<double>;
+template class GenericReadDependentData<long double>;
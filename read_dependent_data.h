@@ -4,7 +4,8 @@
  *
  * The ReadDependentData class contains the members that are dependent on
  * ReadData/ReadDataVector including matrices and vectors that are calculated
- * from sequencing error and by the tree-peeling algorithm.
+ * from sequencing error and by the tree-peeling algorithm. It is templated on
+ * the scalar type of the trio model that owns it.
  */
 #ifndef READ_DEPENDENT_DATA_H
 #define READ_DEPENDENT_DATA_H
@@ -13,31 +14,35 @@
 
 
 /**
- * ReadDependentData class header. See top of file for a complete description.
+ * GenericReadDependentData class template header. See top of file for a
+ * complete description.
  */
-class ReadDependentData {
+template <typename T>
+class GenericReadDependentData {
  public:
-  ReadDependentData();  // Default constructor leaves read_data_vec empty.
-  ReadDependentData(const ReadDataVector &data_vec);  // Constructor that initializes read_data_vec.
-  bool Equals(const ReadDependentData &other);
+  GenericReadDependentData();  // Default constructor leaves read_data_vec empty.
+  GenericReadDependentData(const ReadDataVector &data_vec);  // Constructor that initializes read_data_vec.
+  bool Equals(const GenericReadDependentData &other);
 
   // Instance member variables.
   ReadDataVector read_data_vec;
-  vector<double> max_elements;  // Stores max element of sequencing_probability_mat when rescaling to normal space.
-  Matrix3_16d sequencing_probability_mat;  // P(R|somatic genotype)
-  RowVector16d child_somatic_probability;
-  RowVector16d mother_somatic_probability;
-  RowVector16d father_somatic_probability;
+  vector<T> max_elements;  // Stores max element of each row of sequencing_probability_mat when rescaling to normal space.
+  Matrix3_16T<T> sequencing_probability_mat;  // P(R|somatic genotype)
+  RowVector16T<T> child_somatic_probability;
+  RowVector16T<T> mother_somatic_probability;
+  RowVector16T<T> father_somatic_probability;
   class TreePeel {
    public:
-    RowVector16d child_zygotic_probability; // P(R|zygotic genotype)
-    RowVector16d mother_zygotic_probability;
-    RowVector16d father_zygotic_probability;
-    RowVector256d child_germline_probability;
-    RowVector256d parent_probability; // P(R|mom and dad genotype)
-    RowVector256d root_mat; // P(R|mom and dad genotype) * P(mom and dad genotype)
-    double sum; // P(R)
+    RowVector16T<T> child_zygotic_probability; // P(R|zygotic genotype)
+    RowVector16T<T> mother_zygotic_probability;
+    RowVector16T<T> father_zygotic_probability;
+    RowVector256T<T> child_germline_probability;
+    RowVector256T<T> parent_probability; // P(R|mom and dad genotype)
+    RowVector256T<T> root_mat; // P(R|mom and dad genotype) * P(mom and dad genotype)
+    T sum; // P(R)
   } denominator, numerator;
 };
 
+typedef GenericReadDependentData<double> ReadDependentData;
+
 #endif
@@ -0,0 +1,99 @@
+/**
+ * @file result_query.cc
+ * @author Melissa Ip
+ *
+ * This file queries a binary result store that pileup_driver or
+ * simulation_driver wrote with --output-format binary or --binary, and writes
+ * the matching sites as text (see result_store.h and site_writer.h). Only the
+ * blocks whose zone maps can match the query are read, so filtering does not
+ * rescan every site. Without options, the whole store is converted back to
+ * text.
+ *
+ * To compile on Herschel:
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o result_query utility.cc gzip_reader.cc uring_reader.cc line_reader.cc pileup_shard.cc pileup_index.cc result_store.cc site_writer.cc result_query.cc -lz
+ *
+ * To run this file, provide the following command line inputs:
+ * ./result_query <output>.txt <results>.bin [options]
+ *
+ * Options:
+ *   --contig <contig>
+ *   --first <position>
+ *   --last <position>
+ *                  Writes only the sites of a contig between the 1-based
+ *                  positions, inclusive.
+ *   --regions <regions>.bed
+ *                  Writes only the sites in the regions of a BED file, in the
+ *                  order of the regions.
+ *   --min-probability <x>
+ *                  Writes only the sites with a probability greater than x.
+ *   --output-format <sites|vcf|probabilities|labels>
+ *                  Format of the text output (default sites). labels writes
+ *                  the probability and label of simulated sites.
+ */
+#include "pileup_index.h"
+#include "site_writer.h"
+
+
+int main(int argc, const char *argv[]) {
+  if (argc < 3) {
+    Die("USAGE: result_query <output>.txt <results>.bin [--contig <contig>] "
+        "[--first <position>] [--last <position>] [--regions <regions>.bed] "
+        "[--min-probability <x>] "
+        "[--output-format <sites|vcf|probabilities|labels>]");
+  }
+
+  const string file_name = argv[1];
+  const string store_name = argv[2];
+
+  ResultQuery query;
+  string regions_file;
+  string output_format = "sites";
+  for (int i = 3; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--contig" && i + 1 < argc) {
+      query.contig = argv[++i];
+    } else if (flag == "--first" && i + 1 < argc) {
+      query.first = stoi(argv[++i]);
+    } else if (flag == "--last" && i + 1 < argc) {
+      query.last = stoi(argv[++i]);
+    } else if (flag == "--regions" && i + 1 < argc) {
+      regions_file = argv[++i];
+    } else if (flag == "--min-probability" && i + 1 < argc) {
+      query.min_probability = stod(argv[++i]);
+    } else if (flag == "--output-format" && i + 1 < argc) {
+      output_format = argv[++i];
+    } else {
+      Die("Unknown option.");
+    }
+  }
+  if (output_format == "binary") {
+    Die("Output format must be sites, vcf, probabilities or labels.");
+  }
+
+  vector<ResultQuery> queries;
+  if (regions_file.empty()) {
+    queries.push_back(query);
+  } else {
+    for (const PileupRegion &region : ReadRegions(regions_file)) {
+      ResultQuery region_query(query);
+      region_query.contig = region.contig;
+      region_query.first = region.first;
+      region_query.last = region.last;
+      queries.push_back(region_query);
+    }
+  }
+
+  ResultStore store(store_name);
+  SiteWriter writer(file_name, output_format);
+  ResultRow row;
+  for (const ResultQuery &region_query : queries) {
+    store.SetQuery(region_query);
+    while (store.NextRow(row)) {
+      writer.Write(StringView(row.contig->data(), row.contig->size()),
+                   row.position, row.ref_nucleotide, row.reads,
+                   row.probability, row.label);
+    }
+  }
+
+  return 0;
+}
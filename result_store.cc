@@ -0,0 +1,442 @@
+/**
+ * @file result_store.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the ResultStoreWriter and
+ * ResultStore classes.
+ *
+ * See top of result_store.h for a complete description.
+ */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "result_store.h"
+
+// Number of counts of a site, A, C, G and T of each individual.
+const int kResultCountsSize = 4 * kIndividualCount;
+
+
+/**
+ * Returns the size of a block in the file.
+ *
+ * @param  row_count Number of sites in the block.
+ * @return           Size in bytes.
+ */
+size_t ResultBlockBytes(int row_count) {
+  return row_count * (sizeof(int32_t) + sizeof(double) + sizeof(char) +
+                      sizeof(int8_t) + kResultCountsSize * sizeof(uint16_t));
+}
+
+/**
+ * Appends the raw bytes of a value to a buffer.
+ *
+ * @param  buffer Buffer.
+ * @param  value  Pointer to the value.
+ * @param  size   Size of the value in bytes.
+ */
+void AppendBytes(string &buffer, const void *value, size_t size) {
+  buffer.append(static_cast<const char*>(value), size);
+}
+
+/**
+ * Constructor that opens the output file and writes kResultStoreMagic.
+ *
+ * @param  file_name Output file name.
+ */
+ResultStoreWriter::ResultStoreWriter(const string &file_name)
+    : fd_{-1}, offset_{0} {
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ == -1) {
+    Die("Output file cannot be written.");
+  }
+  AppendBytes(buffer_, kResultStoreMagic, kResultStoreMagicSize);
+  block_.row_count = 0;
+}
+
+/**
+ * Constructor of a writer that builds its blocks in memory.
+ */
+ResultStoreWriter::ResultStoreWriter() : fd_{-1}, offset_{0} {
+  block_.row_count = 0;
+}
+
+/**
+ * Destructor that writes the footer if the file is not closed yet.
+ */
+ResultStoreWriter::~ResultStoreWriter() {
+  if (fd_ != -1) {
+    ResultStoreWriter::Close();
+  }
+}
+
+/**
+ * Adds a site to the current block. The block is finished when it is full or
+ * the contig changes.
+ *
+ * @param  contig         Contig of the site.
+ * @param  position       1-based position of the site.
+ * @param  ref_nucleotide Reference nucleotide of the site.
+ * @param  reads          Reads of the child, mother and father.
+ * @param  probability    Probability of mutation.
+ * @param  label          1 if the simulated site has a mutation, 0 if not, -1
+ *                        if the site is not simulated.
+ */
+void ResultStoreWriter::Write(const StringView &contig, int position,
+                              char ref_nucleotide, const ReadData *reads,
+                              double probability, int label) {
+  if (block_.row_count > 0 &&
+      (block_.row_count == kResultBlockSize ||
+       !contig.Equals(StringView(contigs_[block_.contig_index].data(),
+                                 contigs_[block_.contig_index].size())))) {
+    ResultStoreWriter::FinishBlock();
+  }
+  if (block_.row_count == 0) {
+    block_.contig_index = ResultStoreWriter::ContigIndex(contig);
+    block_.min_position = position;
+    block_.max_position = position;
+    block_.min_probability = probability;
+    block_.max_probability = probability;
+  }
+
+  positions_.push_back(position);
+  probabilities_.push_back(probability);
+  references_ += ref_nucleotide;
+  labels_.push_back(label);
+  for (int i = 0; i < kIndividualCount; ++i) {
+    counts_.insert(counts_.end(), reads[i].reads, reads[i].reads + 4);
+  }
+  block_.min_position = min<int32_t>(block_.min_position, position);
+  block_.max_position = max<int32_t>(block_.max_position, position);
+  block_.min_probability = min(block_.min_probability, probability);
+  block_.max_probability = max(block_.max_probability, probability);
+  block_.row_count++;
+}
+
+/**
+ * Appends the blocks of a memory writer and clears them. The contig indices
+ * and offsets of its zone maps are translated to this writer.
+ *
+ * @param  other Memory writer, e.g. of a shard.
+ */
+void ResultStoreWriter::Append(ResultStoreWriter &other) {
+  ResultStoreWriter::FinishBlock();
+  other.FinishBlock();
+  const int64_t base = offset_ + buffer_.size();
+  for (ResultBlock block : other.blocks_) {
+    const string &contig = other.contigs_[block.contig_index];
+    block.contig_index = ResultStoreWriter::ContigIndex(
+      StringView(contig.data(), contig.size())
+    );
+    block.offset += base;
+    blocks_.push_back(block);
+  }
+  buffer_ += other.buffer_;
+  string().swap(other.buffer_);
+  other.blocks_.clear();
+  if (fd_ != -1) {
+    ResultStoreWriter::WriteBuffer();
+  }
+}
+
+/**
+ * Finishes the current block and writes the footer, i.e. the contig names,
+ * the zone maps of the blocks, the offset of the footer and kResultStoreMagic,
+ * and closes the file.
+ */
+void ResultStoreWriter::Close() {
+  ResultStoreWriter::FinishBlock();
+  const int64_t footer_offset = offset_ + buffer_.size();
+  const uint32_t contig_count = contigs_.size();
+  AppendBytes(buffer_, &contig_count, sizeof(contig_count));
+  for (const string &contig : contigs_) {
+    const uint32_t size = contig.size();
+    AppendBytes(buffer_, &size, sizeof(size));
+    buffer_ += contig;
+  }
+  const uint64_t block_count = blocks_.size();
+  AppendBytes(buffer_, &block_count, sizeof(block_count));
+  AppendBytes(buffer_, blocks_.data(), blocks_.size() * sizeof(ResultBlock));
+  AppendBytes(buffer_, &footer_offset, sizeof(footer_offset));
+  AppendBytes(buffer_, kResultStoreMagic, kResultStoreMagicSize);
+  ResultStoreWriter::WriteBuffer();
+  if (close(fd_) == -1) {
+    Die("Output file cannot be written.");
+  }
+  fd_ = -1;
+}
+
+/**
+ * Moves the columns of the current block to the buffer and records its zone
+ * map. A file writer writes the buffer.
+ */
+void ResultStoreWriter::FinishBlock() {
+  if (block_.row_count == 0) {
+    return;
+  }
+  block_.offset = offset_ + buffer_.size();
+  buffer_.reserve(buffer_.size() + ResultBlockBytes(block_.row_count));
+  AppendBytes(buffer_, positions_.data(), positions_.size() * sizeof(int32_t));
+  AppendBytes(buffer_, probabilities_.data(),
+              probabilities_.size() * sizeof(double));
+  buffer_ += references_;
+  AppendBytes(buffer_, labels_.data(), labels_.size() * sizeof(int8_t));
+  AppendBytes(buffer_, counts_.data(), counts_.size() * sizeof(uint16_t));
+  blocks_.push_back(block_);
+
+  positions_.clear();
+  probabilities_.clear();
+  references_.clear();
+  labels_.clear();
+  counts_.clear();
+  block_.row_count = 0;
+  if (fd_ != -1) {
+    ResultStoreWriter::WriteBuffer();
+  }
+}
+
+/**
+ * Returns the index of a contig in the footer and adds it if it is new.
+ * Contigs change rarely, so the last contig is checked first.
+ *
+ * @param  contig Contig name.
+ * @return        Index of the contig.
+ */
+int ResultStoreWriter::ContigIndex(const StringView &contig) {
+  for (int i = contigs_.size() - 1; i >= 0; --i) {
+    if (contig.Equals(StringView(contigs_[i].data(), contigs_[i].size()))) {
+      return i;
+    }
+  }
+  contigs_.push_back(contig.ToString());
+  return contigs_.size() - 1;
+}
+
+/**
+ * Writes the buffer to the output file.
+ */
+void ResultStoreWriter::WriteBuffer() {
+  ssize_t written = 0;
+  for (size_t offset = 0; offset < buffer_.size(); offset += written) {
+    written = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+    if (written == -1 && errno == EINTR) {
+      written = 0;
+    } else if (written == -1) {
+      Die("Output file cannot be written.");
+    }
+  }
+  offset_ += buffer_.size();
+  buffer_.clear();
+}
+
+/**
+ * Constructor that opens a result store and reads its footer. The query
+ * returns every site until SetQuery() is called.
+ *
+ * @param  file_name Result store file name.
+ */
+ResultStore::ResultStore(const string &file_name)
+    : fd_{-1}, query_contig_index_{-1}, next_block_{0}, skipped_blocks_{0},
+      row_count_{0}, next_row_{0} {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd_ == -1 || fstat(fd_, &file_stat) == -1) {
+    Die("Result store cannot be read.");
+  }
+  const off_t trailer_size = sizeof(int64_t) + kResultStoreMagicSize;
+  if (file_stat.st_size <
+      static_cast<off_t>(kResultStoreMagicSize) + trailer_size) {
+    Die("Input file is not a result store.");
+  }
+  char magic[kResultStoreMagicSize];
+  ResultStore::ReadColumn(magic, kResultStoreMagicSize, 0);
+  int64_t footer_offset = 0;
+  char trailer_magic[kResultStoreMagicSize];
+  ResultStore::ReadColumn(&footer_offset, sizeof(footer_offset),
+                          file_stat.st_size - trailer_size);
+  ResultStore::ReadColumn(trailer_magic, kResultStoreMagicSize,
+                          file_stat.st_size - kResultStoreMagicSize);
+  if (memcmp(magic, kResultStoreMagic, kResultStoreMagicSize) != 0 ||
+      memcmp(trailer_magic, kResultStoreMagic, kResultStoreMagicSize) != 0 ||
+      footer_offset < static_cast<int64_t>(kResultStoreMagicSize) ||
+      footer_offset > file_stat.st_size - trailer_size) {
+    Die("Input file is not a result store.");
+  }
+
+  string footer(file_stat.st_size - trailer_size - footer_offset, '\0');
+  ResultStore::ReadColumn(&footer[0], footer.size(), footer_offset);
+  size_t offset = 0;
+  auto read_footer = [&](void *value, size_t size) {
+    if (offset + size > footer.size()) {
+      Die("Result store footer is truncated.");
+    }
+    memcpy(value, footer.data() + offset, size);
+    offset += size;
+  };
+  uint32_t contig_count = 0;
+  read_footer(&contig_count, sizeof(contig_count));
+  for (uint32_t i = 0; i < contig_count; ++i) {
+    uint32_t size = 0;
+    read_footer(&size, sizeof(size));
+    string contig(size, '\0');
+    read_footer(&contig[0], size);
+    contigs_.push_back(contig);
+  }
+  uint64_t block_count = 0;
+  read_footer(&block_count, sizeof(block_count));
+  blocks_.resize(block_count);
+  read_footer(blocks_.data(), block_count * sizeof(ResultBlock));
+}
+
+/**
+ * Destructor that closes the file.
+ */
+ResultStore::~ResultStore() {
+  close(fd_);
+}
+
+/**
+ * Sets the sites that NextRow() returns and restarts at the first block.
+ *
+ * @param  query Contig, positions and probability threshold.
+ */
+void ResultStore::SetQuery(const ResultQuery &query) {
+  query_ = query;
+  query_contig_index_ = -1;
+  if (!query.contig.empty()) {
+    query_contig_index_ = find(contigs_.begin(), contigs_.end(), query.contig)
+                          - contigs_.begin();  // contigs_.size() if absent.
+  }
+  next_block_ = 0;
+  skipped_blocks_ = 0;
+  row_count_ = 0;
+  next_row_ = 0;
+}
+
+/**
+ * Returns the next site of the query in file order. Blocks whose zone map
+ * cannot match the query are skipped without being read.
+ *
+ * @param  row Site that is read.
+ * @return     False once no site is left.
+ */
+bool ResultStore::NextRow(ResultRow &row) {
+  while (true) {
+    while (next_row_ < row_count_) {
+      const int i = next_row_++;
+      if (!ResultStore::IsMatch(positions_[i], probabilities_[i])) {
+        continue;
+      }
+      row.contig = &contigs_[blocks_[next_block_ - 1].contig_index];
+      row.position = positions_[i];
+      row.ref_nucleotide = references_[i];
+      row.label = labels_[i];
+      row.probability = probabilities_[i];
+      for (int j = 0; j < kIndividualCount; ++j) {
+        memcpy(row.reads[j].reads, &counts_[(i * kIndividualCount + j) * 4],
+               sizeof(row.reads[j].reads));
+      }
+      return true;
+    }
+
+    if (next_block_ == static_cast<int>(blocks_.size())) {
+      return false;
+    }
+    const ResultBlock &block = blocks_[next_block_++];
+    row_count_ = 0;
+    next_row_ = 0;
+    if ((query_contig_index_ != -1 &&
+         block.contig_index != query_contig_index_) ||
+        block.max_position < query_.first || block.min_position > query_.last ||
+        block.max_probability <= query_.min_probability) {
+      skipped_blocks_++;
+      continue;
+    }
+    ResultStore::ReadBlock(block);
+  }
+}
+
+const vector<string>& ResultStore::contigs() const {
+  return contigs_;
+}
+
+const vector<ResultBlock>& ResultStore::blocks() const {
+  return blocks_;
+}
+
+int ResultStore::skipped_blocks() const {
+  return skipped_blocks_;
+}
+
+/**
+ * Reads the positions and probabilities columns of a block, and the rest of
+ * its columns if a site matches the query.
+ *
+ * @param  block Zone map of the block.
+ * @return       True if a site of the block matches the query.
+ */
+bool ResultStore::ReadBlock(const ResultBlock &block) {
+  const int n = block.row_count;
+  positions_.resize(n);
+  probabilities_.resize(n);
+  off_t offset = block.offset;
+  ResultStore::ReadColumn(positions_.data(), n * sizeof(int32_t), offset);
+  offset += n * sizeof(int32_t);
+  ResultStore::ReadColumn(probabilities_.data(), n * sizeof(double), offset);
+  offset += n * sizeof(double);
+
+  bool has_match = false;
+  for (int i = 0; i < n && !has_match; ++i) {
+    has_match = ResultStore::IsMatch(positions_[i], probabilities_[i]);
+  }
+  if (!has_match) {
+    return false;
+  }
+
+  references_.resize(n);
+  labels_.resize(n);
+  counts_.resize(n * kResultCountsSize);
+  ResultStore::ReadColumn(&references_[0], n, offset);
+  offset += n;
+  ResultStore::ReadColumn(labels_.data(), n * sizeof(int8_t), offset);
+  offset += n * sizeof(int8_t);
+  ResultStore::ReadColumn(counts_.data(),
+                          counts_.size() * sizeof(uint16_t), offset);
+  row_count_ = n;
+  return true;
+}
+
+/**
+ * Reads size bytes at an offset of the file.
+ *
+ * @param  column Destination.
+ * @param  size   Number of bytes.
+ * @param  offset Offset in the file.
+ */
+void ResultStore::ReadColumn(void *column, size_t size, off_t offset) {
+  char *data = static_cast<char*>(column);
+  while (size > 0) {
+    ssize_t bytes = pread(fd_, data, size, offset);
+    if (bytes == -1 && errno == EINTR) {
+      continue;
+    } else if (bytes <= 0) {
+      Die("Result store is truncated.");
+    }
+    data += bytes;
+    size -= bytes;
+    offset += bytes;
+  }
+}
+
+/**
+ * Returns true if a site is in the positions of the query and its probability
+ * passes the threshold of the query.
+ *
+ * @param  position    1-based position.
+ * @param  probability Probability of mutation.
+ * @return             True if the site matches.
+ */
+bool ResultStore::IsMatch(int position, double probability) const {
+  return position >= query_.first && position <= query_.last &&
+         probability > query_.min_probability;
+}
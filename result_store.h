@@ -0,0 +1,178 @@
+/**
+ * @file result_store.h
+ * @author Melissa Ip
+ *
+ * The ResultStoreWriter class writes scored sites of pileup_driver or
+ * simulation_driver to a columnar binary file, and the ResultStore class
+ * answers queries such as "all sites with probability > x in a region" by
+ * reading only the blocks that can match, so filtering a genome of results
+ * does not rescan the whole text output.
+ *
+ * Sites are stored in blocks of at most kResultBlockSize sites of one contig.
+ * Each block holds its columns one after another:
+ *
+ *   positions      int32_t[n]   1-based, in file order.
+ *   probabilities  double[n]
+ *   references     char[n]      Reference nucleotide, N if unknown.
+ *   labels         int8_t[n]    1 if the simulated site has a mutation, 0 if
+ *                               not, -1 for sites that are not simulated.
+ *   counts         uint16_t[n * 12]  A, C, G and T counts of the child, mother
+ *                               and father of each site.
+ *
+ * The file starts with kResultStoreMagic and ends with a footer of the contig
+ * names and a zone map of each block (ResultBlock), i.e. its contig, offset,
+ * number of sites and minimum and maximum position and probability, followed
+ * by the offset of the footer and kResultStoreMagic again. Numbers are in the
+ * byte order of the machine that writes the file.
+ *
+ * A query skips the blocks of other contigs, the blocks that do not overlap
+ * its positions and the blocks whose maximum probability does not pass its
+ * threshold. Of the other blocks, the positions and probabilities columns are
+ * read first, and the rest of the columns only if a site matches.
+ *
+ * A ResultStoreWriter that is created without a file name builds its blocks
+ * in memory, e.g. for one shard of the pileup files, and is appended to a file
+ * writer in order with Append().
+ *
+ * Example usage:
+ *
+ *   ResultStoreWriter writer("results.bin");
+ *   writer.Write(site.contig, site.position, site.ref_nucleotide,
+ *                site.data_vec.data(), probability);
+ *   writer.Close();
+ *
+ *   ResultStore store("results.bin");
+ *   ResultQuery query;
+ *   query.contig = "1";
+ *   query.min_probability = 0.1;
+ *   store.SetQuery(query);
+ *   ResultRow row;
+ *   while (store.NextRow(row)) {
+ *     cout << row.position << "\t" << row.probability << endl;
+ *   }
+ */
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+#include <sys/types.h>
+#include <climits>
+
+#include "trio_model.h"
+
+
+// Identifies result store files, at the start and at the end of the file.
+const char kResultStoreMagic[] = "NMRSTOR1";
+const size_t kResultStoreMagicSize = 8;
+
+// Maximum number of sites in a block.
+const int kResultBlockSize = 8192;
+
+/**
+ * Zone map of a block that is stored in the footer of the file.
+ */
+struct ResultBlock {
+  int64_t offset;  // Offset of the block in the file.
+  int32_t row_count;
+  int32_t contig_index;  // Index of the contig in the footer.
+  int32_t min_position;
+  int32_t max_position;
+  double min_probability;
+  double max_probability;
+};
+
+/**
+ * Sites that a query returns. Sites of every contig are returned if contig is
+ * empty.
+ */
+struct ResultQuery {
+  ResultQuery() : first{0}, last{INT_MAX}, min_probability{-1.0} {}
+  string contig;
+  int first;  // 1-based, inclusive.
+  int last;
+  double min_probability;  // Sites with a greater probability are returned.
+};
+
+/**
+ * Site that is read from a result store.
+ */
+struct ResultRow {
+  const string *contig;  // Owned by the ResultStore.
+  int position;
+  char ref_nucleotide;
+  int label;
+  double probability;
+  ReadData reads[kIndividualCount];  // Child, mother and father.
+};
+
+/**
+ * ResultStoreWriter class header. See top of file for a complete description.
+ */
+class ResultStoreWriter {
+ public:
+  ResultStoreWriter(const string &file_name);  // Writes to a file.
+  ResultStoreWriter();  // Builds the blocks in memory.
+  ~ResultStoreWriter();  // Closes the file.
+  void Write(const StringView &contig, int position, char ref_nucleotide,
+             const ReadData *reads, double probability, int label=-1);
+  void Append(ResultStoreWriter &other);  // Moves the blocks of a memory writer.
+  void Close();  // Writes the footer.
+
+ private:
+  ResultStoreWriter(const ResultStoreWriter &other);  // Not copyable.
+  ResultStoreWriter& operator=(const ResultStoreWriter &other);
+  void FinishBlock();
+  int ContigIndex(const StringView &contig);
+  void WriteBuffer();
+
+  // Instance member variables.
+  int fd_;  // -1 for a memory writer.
+  int64_t offset_;  // Offset of the start of buffer_ in the file.
+  string buffer_;  // Finished blocks that are not written yet.
+  vector<string> contigs_;
+  vector<ResultBlock> blocks_;
+  ResultBlock block_;  // Zone map of the current block.
+  vector<int32_t> positions_;  // Columns of the current block.
+  vector<double> probabilities_;
+  string references_;
+  vector<int8_t> labels_;
+  vector<uint16_t> counts_;
+};
+
+/**
+ * ResultStore class header. See top of file for a complete description.
+ */
+class ResultStore {
+ public:
+  ResultStore(const string &file_name);
+  ~ResultStore();
+  void SetQuery(const ResultQuery &query);  // Restarts at the first block.
+  bool NextRow(ResultRow &row);  // False once no site is left.
+  const vector<string>& contigs() const;
+  const vector<ResultBlock>& blocks() const;
+  int skipped_blocks() const;  // Blocks of the query that were not read.
+
+ private:
+  ResultStore(const ResultStore &other);  // Not copyable.
+  ResultStore& operator=(const ResultStore &other);
+  bool ReadBlock(const ResultBlock &block);
+  void ReadColumn(void *column, size_t size, off_t offset);
+  bool IsMatch(int position, double probability) const;
+
+  // Instance member variables.
+  int fd_;
+  vector<string> contigs_;
+  vector<ResultBlock> blocks_;
+  ResultQuery query_;
+  int query_contig_index_;  // -1 for every contig.
+  int next_block_;
+  int skipped_blocks_;
+  vector<int32_t> positions_;  // Columns of the current block.
+  vector<double> probabilities_;
+  string references_;
+  vector<int8_t> labels_;
+  vector<uint16_t> counts_;
+  int row_count_;
+  int next_row_;
+};
+
+#endif
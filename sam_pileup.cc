@@ -0,0 +1,409 @@
+/**
+ * @file sam_pileup.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the SamPileup and SamMerger
+ * classes and of the SAM line parser.
+ *
+ * See top of sam_pileup.h for a complete description.
+ */
+#include "pileup_shard.h"
+#include "sam_pileup.h"
+
+// Number of mandatory columns of a SAM line.
+const int kSamColumnCount = 11;
+
+
+/**
+ * Reads a number of a CIGAR string or MD tag, which are not terminated.
+ *
+ * @param  data Position in the string, moved past the number.
+ * @param  end  End of the string.
+ * @return      Number, 0 if there is no number.
+ */
+int ParseCount(const char *&data, const char *end) {
+  int count = 0;
+  while (data < end && isdigit(*data)) {
+    count = count * 10 + (*data++ - '0');
+  }
+  return count;
+}
+
+/**
+ * Constructor that reads the first alignment.
+ *
+ * @param  reader              SAM file reader.
+ * @param  min_mapping_quality Alignments with a lower mapping quality are
+ *                             skipped.
+ * @param  min_base_quality    Bases with a lower base quality are not counted.
+ */
+SamPileup::SamPileup(LineReader &reader, int min_mapping_quality,
+                     int min_base_quality)
+    : reader_{&reader}, min_mapping_quality_{min_mapping_quality},
+      min_base_quality_{min_base_quality}, has_alignment_{false},
+      window_begin_{0}, window_end_{0}, reads_(kSamWindowSize),
+      ref_nucleotides_(kSamWindowSize, 'N'), mask_{kSamWindowSize - 1} {
+  has_alignment_ = SamPileup::NextAlignment();
+}
+
+/**
+ * Returns the next position that has at least one counted base. Counts the
+ * alignments that start before the position after it first.
+ *
+ * @param  site Counts of the position.
+ * @return      False once the file is exhausted.
+ */
+bool SamPileup::NextSite(SamSite &site) {
+  while (true) {
+    const int limit = SamPileup::Limit();
+    while (window_begin_ < window_end_ && window_begin_ < limit) {
+      const int slot = window_begin_ & mask_;
+      site.position = window_begin_++;
+      site.ref_nucleotide = ref_nucleotides_[slot];
+      site.reads = reads_[slot];
+      reads_[slot].key = 0;
+      ref_nucleotides_[slot] = 'N';
+      if (site.reads.key != 0) {
+        return true;
+      }
+    }
+    if (!has_alignment_) {
+      return false;
+    }
+
+    if (!alignment_.contig.Equals(StringView(contig_.data(), contig_.size()))) {
+      contig_ = alignment_.contig.ToString();  // The window is empty.
+      window_begin_ = alignment_.position;
+      window_end_ = alignment_.position;
+    } else if (alignment_.position < window_begin_) {
+      Die("SAM file is not sorted by coordinate.");
+    } else if (window_begin_ == window_end_) {
+      window_begin_ = alignment_.position;
+      window_end_ = alignment_.position;
+    }
+    SamPileup::AddAlignment();
+    has_alignment_ = SamPileup::NextAlignment();
+  }
+}
+
+const string& SamPileup::contig() const {
+  return contig_;
+}
+
+const vector<string>& SamPileup::header_contigs() const {
+  return header_contigs_;
+}
+
+/**
+ * Reads the next alignment that is counted. Keeps the contigs of the @SQ
+ * header lines, and skips the other header lines and the alignments that are
+ * unmapped, secondary, QC failures, duplicates or below the minimum mapping
+ * quality.
+ *
+ * @return  False if there are no alignments left.
+ */
+bool SamPileup::NextAlignment() {
+  StringView line;
+  while (reader_->NextLine(line)) {
+    if (line.size > 4 && memcmp(line.data, "@SQ\t", 4) == 0) {
+      string header(line.data, line.size);
+      size_t begin = header.find("\tSN:");
+      if (begin != string::npos) {
+        begin += 4;
+        header_contigs_.push_back(
+          header.substr(begin, header.find('\t', begin) - begin)
+        );
+      }
+    }
+    if (line.size == 0 || line.data[0] == '@') {
+      continue;
+    }
+    if (!ParseSamLine(line.data, line.size, alignment_)) {
+      Die("SAM line does not have the SAM columns.");
+    }
+    if ((alignment_.flag & kSamSkipFlags) != 0 ||
+        alignment_.mapping_quality < min_mapping_quality_ ||
+        (alignment_.cigar.size == 1 && alignment_.cigar.data[0] == '*') ||
+        (alignment_.sequence.size == 1 && alignment_.sequence.data[0] == '*')) {
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Walks the CIGAR string of the next alignment and adds its aligned bases to
+ * the counts of the positions they cover. Sets the reference nucleotide of
+ * the positions from the MD tag.
+ */
+void SamPileup::AddAlignment() {
+  const SamAlignment &alignment = alignment_;
+  const char *cigar_end = alignment.cigar.data + alignment.cigar.size;
+  int span = 0;  // Number of reference positions.
+  size_t length = 0;  // Number of bases of the sequence.
+  for (const char *cigar = alignment.cigar.data; cigar < cigar_end;) {
+    int count = ParseCount(cigar, cigar_end);
+    if (cigar == cigar_end || strchr("MIDNSHP=X", *cigar) == nullptr) {
+      Die("SAM line does not have a valid CIGAR string.");
+    }
+    if (strchr("MDN=X", *cigar) != nullptr) {
+      span += count;
+    }
+    if (strchr("MIS=X", *cigar) != nullptr) {
+      length += count;
+    }
+    cigar++;
+  }
+  if (length != alignment.sequence.size) {
+    Die("SAM line has a CIGAR string that does not match its sequence.");
+  }
+  if (alignment.position + span - window_begin_ > mask_ + 1) {
+    SamPileup::Grow(alignment.position + span - window_begin_);
+  }
+  window_end_ = max(window_end_, alignment.position + span);
+
+  const bool has_qualities = min_base_quality_ > 0 &&
+                             alignment.qualities.size == length;
+  const char *md = alignment.md.data;
+  const char *md_end = alignment.md.data + alignment.md.size;
+  bool has_md = alignment.md.size > 0;
+  int md_matches = ParseCount(md, md_end);
+  int position = alignment.position;
+  int query = 0;
+  for (const char *cigar = alignment.cigar.data; cigar < cigar_end;) {
+    int count = ParseCount(cigar, cigar_end);
+    switch (*cigar++) {
+      case 'M': case '=': case 'X':
+        for (int k = 0; k < count; ++k, ++position, ++query) {
+          const int slot = position & mask_;
+          char base = alignment.sequence.data[query];
+          if (has_md) {
+            char ref_nucleotide = base;
+            if (md_matches > 0) {
+              md_matches--;
+            } else if (md < md_end && isalpha(*md)) {
+              ref_nucleotide = *md++;
+              md_matches = ParseCount(md, md_end);
+            } else {
+              has_md = false;  // The MD tag does not match the CIGAR string.
+            }
+            if (has_md && NucleotideIndex(ref_nucleotide) != -1) {
+              ref_nucleotides_[slot] = toupper(ref_nucleotide);
+            }
+          }
+          int index = NucleotideIndex(base);
+          if (index != -1 && (!has_qualities ||
+              alignment.qualities.data[query] - 33 >= min_base_quality_)) {
+            reads_[slot].reads[index]++;
+          }
+        }
+        break;
+      case 'D':
+        if (has_md && md < md_end && *md == '^') {
+          md++;
+          for (int k = 0; k < count && md < md_end && isalpha(*md); ++k) {
+            if (NucleotideIndex(*md) != -1) {
+              ref_nucleotides_[(position + k) & mask_] = toupper(*md);
+            }
+            md++;
+          }
+          md_matches = ParseCount(md, md_end);
+        }
+        position += count;
+        break;
+      case 'N':
+        position += count;
+        break;
+      case 'I': case 'S':
+        query += count;
+        break;
+    }
+  }
+}
+
+/**
+ * Grows the ring buffer to hold at least the given number of positions.
+ *
+ * @param  size Number of positions from window_begin_.
+ */
+void SamPileup::Grow(int size) {
+  int capacity = mask_ + 1;
+  while (capacity < size) {
+    capacity *= 2;
+  }
+  vector<ReadData> reads(capacity);
+  vector<char> ref_nucleotides(capacity, 'N');
+  for (int position = window_begin_; position < window_end_; ++position) {
+    reads[position & (capacity - 1)] = reads_[position & mask_];
+    ref_nucleotides[position & (capacity - 1)] =
+      ref_nucleotides_[position & mask_];
+  }
+  reads_.swap(reads);
+  ref_nucleotides_.swap(ref_nucleotides);
+  mask_ = capacity - 1;
+}
+
+/**
+ * Returns the first position of the ring buffer that later alignments may
+ * still add bases to.
+ *
+ * @return  Start of the next alignment on the same contig, or the largest int
+ *          if the next alignment is on another contig or there is none.
+ */
+int SamPileup::Limit() const {
+  if (has_alignment_ &&
+      alignment_.contig.Equals(StringView(contig_.data(), contig_.size()))) {
+    return alignment_.position;
+  }
+  return numeric_limits<int>::max();
+}
+
+/**
+ * Constructor that reads the first site of each file. If every file has @SQ
+ * header lines, their contigs give the contig order of the files.
+ *
+ * @param  child  Child SAM pileup.
+ * @param  mother Mother SAM pileup.
+ * @param  father Father SAM pileup.
+ */
+SamMerger::SamMerger(SamPileup &child, SamPileup &mother, SamPileup &father)
+    : pileups_{&child, &mother, &father} {
+  for (int i = 0; i < kIndividualCount; ++i) {
+    is_covered_[i] = false;
+    has_head_[i] = pileups_[i]->NextSite(heads_[i]);
+    if (has_head_[i]) {
+      head_contigs_[i] = pileups_[i]->contig();
+    }
+  }
+
+  vector<vector<string>> orders;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (pileups_[i]->header_contigs().empty()) {
+      return;  // The order of the file is not known.
+    }
+    orders.push_back(pileups_[i]->header_contigs());
+  }
+  contig_order_.SetContigs(MergeContigOrders(orders));
+}
+
+/**
+ * Merges the next position that is covered in at least one file. Individuals
+ * without counts at the position get reads of zero.
+ *
+ * @param  site Merged reads of the position.
+ * @return      False once every file is exhausted.
+ */
+bool SamMerger::NextSite(TrioSite &site) {
+  const string &contig = contig_order_.contig();
+  bool has_contig = false;
+  bool has_any = false;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (is_covered_[i]) {
+      has_head_[i] = SamMerger::Advance(i);
+      is_covered_[i] = false;
+    }
+    has_any = has_any || has_head_[i];
+    has_contig = has_contig || (has_head_[i] && head_contigs_[i] == contig);
+  }
+  if (!has_any) {
+    return false;
+  }
+  if (!has_contig) {
+    contig_order_.NextContig(head_contigs_, has_head_);
+  }
+
+  site.position = numeric_limits<int>::max();
+  for (int i = 0; i < kIndividualCount; ++i) {
+    if (has_head_[i] && head_contigs_[i] == contig &&
+        heads_[i].position < site.position) {
+      site.position = heads_[i].position;
+    }
+  }
+  site.contig = StringView(contig.data(), contig.size());
+  site.ref_nucleotide = 'N';
+  site.data_vec.resize(kIndividualCount);
+  for (int i = 0; i < kIndividualCount; ++i) {
+    is_covered_[i] = has_head_[i] && heads_[i].position == site.position &&
+                     head_contigs_[i] == contig;
+    if (is_covered_[i]) {
+      site.data_vec[i] = heads_[i].reads;
+      if (site.ref_nucleotide == 'N') {
+        site.ref_nucleotide = heads_[i].ref_nucleotide;
+      }
+    } else {
+      site.data_vec[i].key = 0;
+    }
+  }
+  return true;
+}
+
+const string& SamMerger::contig() const {
+  return contig_order_.contig();
+}
+
+/**
+ * Reads the next site of a file and checks the order of its contigs.
+ *
+ * @param  individual Index of the file (0 child, 1 mother, 2 father).
+ * @return            False if the file is exhausted.
+ */
+bool SamMerger::Advance(int individual) {
+  if (!pileups_[individual]->NextSite(heads_[individual])) {
+    return false;
+  }
+  const string &contig = pileups_[individual]->contig();
+  if (contig != head_contigs_[individual]) {
+    head_contigs_[individual] = contig;
+    if (contig_order_.is_finished(contig) && contig_order_.is_known()) {
+      Die("SAM files do not have their contigs in the same order.");
+    } else if (contig_order_.is_finished(contig)) {
+      Die("SAM files do not have the same contigs, and their order is not "
+          "known without @SQ header lines.");
+    }
+  }
+  return true;
+}
+
+/**
+ * Tokenizes the mandatory columns and the MD tag of a SAM line in place.
+ *
+ * @param  line      Start of the line.
+ * @param  length    Length of the line without its newline.
+ * @param  alignment Columns of the line.
+ * @return           False if the line has fewer than 11 columns.
+ */
+bool ParseSamLine(const char *line, size_t length, SamAlignment &alignment) {
+  const char *end = line + length;
+  const char *field = line;
+  StringView fields[kSamColumnCount];
+  for (int i = 0; i < kSamColumnCount; ++i) {
+    if (field > end) {
+      return false;
+    }
+    const char *tab = static_cast<const char*>(memchr(field, '\t',
+                                                      end - field));
+    const char *field_end = tab != nullptr ? tab : end;
+    fields[i] = StringView(field, field_end - field);
+    field = field_end + 1;
+  }
+
+  alignment.flag = strtol(fields[1].data, nullptr, 10);
+  alignment.contig = fields[2];
+  alignment.position = strtol(fields[3].data, nullptr, 10);
+  alignment.mapping_quality = strtol(fields[4].data, nullptr, 10);
+  alignment.cigar = fields[5];
+  alignment.sequence = fields[9];
+  alignment.qualities = fields[10];
+  alignment.md = StringView();
+  while (field < end) {
+    const char *tab = static_cast<const char*>(memchr(field, '\t',
+                                                      end - field));
+    const char *field_end = tab != nullptr ? tab : end;
+    if (field_end - field >= 5 && memcmp(field, "MD:Z:", 5) == 0) {
+      alignment.md = StringView(field + 5, field_end - field - 5);
+    }
+    field = field_end + 1;
+  }
+  return true;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file sam_pileup.h
+ * @author Melissa Ip
+ *
+ * The SamPileup class counts the bases of the reads of a coordinate-sorted SAM
+ * file at each position, which replaces running samtools mpileup and parsing
+ * its bases columns. Each alignment is read once from a LineReader, so SAM
+ * files may also be gzip or BGZF compressed. The CIGAR string of an alignment
+ * is walked to add its aligned bases (M, = and X) to the counts of the
+ * positions they cover. Insertions, deletions, skips and clips add no bases.
+ *
+ * The counts are kept in a ring buffer of positions that starts at the first
+ * position that has not been returned. Alignments are sorted by start, so the
+ * positions before the start of the next alignment are final and are returned
+ * by NextSite() in order. The ring grows when an alignment spans more
+ * positions than it holds, e.g. a spliced read, so memory depends on the
+ * longest alignment rather than on the size of the file.
+ *
+ * Like samtools mpileup, alignments that are unmapped, secondary, QC failures
+ * or duplicates are skipped, and alignments below a minimum mapping quality
+ * and bases below a minimum base quality are not counted. SAM has no reference
+ * sequence, so the reference nucleotide of a position is taken from the MD tag
+ * of the alignments if they have one, and is N otherwise.
+ *
+ * testdata/sam_trio has a small SAM trio that covers the filters, the CIGAR
+ * operations and the MD tags, with the expected output of pileup_driver.
+ *
+ * The SamMerger class joins the sites of the child, mother and father SAM
+ * files on (contig, position) in the same way as PileupMerger joins pileup
+ * files (see pileup_merger.h), and returns TrioSite objects. The contig order
+ * of the files is taken from their @SQ header lines, so a contig that some
+ * files do not have is merged with reads of zero for them.
+ *
+ * Example usage:
+ *
+ *   LineReader child_reader("child.sam");  // And the mother and father.
+ *   SamPileup child(child_reader, 20, 13);  // Mapping and base quality.
+ *   SamMerger merger(child, mother, father);
+ *   TrioSite site;
+ *   while (merger.NextSite(site)) {
+ *     double probability = params.MutationProbability(site.data_vec);
+ *   }
+ */
+#ifndef SAM_PILEUP_H
+#define SAM_PILEUP_H
+
+#include "line_reader.h"
+#include "pileup_merger.h"
+
+
+// Alignments with any of these flags are skipped: unmapped (0x4), secondary
+// (0x100), QC failure (0x200) and duplicate (0x400).
+const int kSamSkipFlags = 0x4 | 0x100 | 0x200 | 0x400;
+
+// Initial number of positions of the ring buffer.
+const int kSamWindowSize = 4096;
+
+/**
+ * Counts of the bases of all alignments at one position.
+ */
+struct SamSite {
+  int position;  // 1-based.
+  char ref_nucleotide;  // Upper case, N if no alignment has a MD tag.
+  ReadData reads;
+};
+
+/**
+ * Columns of one alignment line that are used for counting. The views point
+ * into the line and are only valid as long as the line.
+ */
+struct SamAlignment {
+  int flag;
+  StringView contig;
+  int position;  // 1-based position of the first aligned base.
+  int mapping_quality;
+  StringView cigar;
+  StringView sequence;
+  StringView qualities;  // '*' if the file has no base qualities.
+  StringView md;  // Value of the MD tag, empty if there is none.
+};
+
+/**
+ * SamPileup class header. See top of file for a complete description.
+ */
+class SamPileup {
+ public:
+  SamPileup(LineReader &reader, int min_mapping_quality=0,
+            int min_base_quality=0);
+  bool NextSite(SamSite &site);  // False once the file is exhausted.
+  const string& contig() const;  // Contig of the last site.
+  const vector<string>& header_contigs() const;  // Contigs of the @SQ lines.
+
+ private:
+  bool NextAlignment();
+  void AddAlignment();
+  void Grow(int size);
+  int Limit() const;
+
+  // Instance member variables.
+  LineReader *reader_;
+  int min_mapping_quality_;
+  int min_base_quality_;
+  SamAlignment alignment_;  // Next alignment that is not counted yet.
+  bool has_alignment_;
+  string contig_;  // Contig of the ring buffer.
+  int window_begin_;  // First position that has not been returned.
+  int window_end_;  // Position after the last counted position.
+  vector<ReadData> reads_;  // Ring buffer of counts by position.
+  vector<char> ref_nucleotides_;
+  int mask_;  // Size of the ring buffer - 1.
+  vector<string> header_contigs_;  // Contigs of the @SQ header lines.
+};
+
+/**
+ * SamMerger class header. See top of file for a complete description.
+ */
+class SamMerger {
+ public:
+  SamMerger(SamPileup &child, SamPileup &mother, SamPileup &father);
+  bool NextSite(TrioSite &site);  // False once every file is exhausted.
+  const string& contig() const;  // Contig of the last site.
+
+ private:
+  bool Advance(int individual);
+
+  // Instance member variables.
+  SamPileup *pileups_[kIndividualCount];
+  SamSite heads_[kIndividualCount];  // Current site of each file.
+  string head_contigs_[kIndividualCount];
+  bool has_head_[kIndividualCount];  // False once the file is exhausted.
+  bool is_covered_[kIndividualCount];  // Files that have the current site.
+  ContigOrder contig_order_;  // Contig that is being merged.
+};
+
+// Forward declarations.
+bool ParseSamLine(const char *line, size_t length, SamAlignment &alignment);
+
+#endif
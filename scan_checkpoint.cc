@@ -0,0 +1,179 @@
+/**
+ * @file scan_checkpoint.cc
+ * @author Melissa Ip
+ *
+ * This file contains the functions that write and read checkpoints of scans.
+ *
+ * See top of scan_checkpoint.h for a complete description.
+ */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+#include "scan_checkpoint.h"
+
+
+/**
+ * Returns the checkpoint of a scan that has not started, with the names and
+ * sizes of its input files, so a resumed scan can check that they did not
+ * change.
+ *
+ * @param  inputs        Input file names. Empty names are skipped.
+ * @param  output_format Output format of the scan.
+ * @return               Checkpoint.
+ */
+ScanCheckpoint StartCheckpoint(const vector<string> &inputs,
+                               const string &output_format) {
+  ScanCheckpoint checkpoint;
+  for (const string &input : inputs) {
+    if (input.empty()) {
+      continue;
+    }
+    struct stat file_stat;
+    if (stat(input.c_str(), &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+      Die("Checkpoints need input files that are regular files.");
+    }
+    checkpoint.inputs.push_back(input);
+    checkpoint.input_sizes.push_back(file_stat.st_size);
+  }
+  checkpoint.output_format = output_format;
+  return checkpoint;
+}
+
+/**
+ * Checks that a checkpoint was written by a scan of the same inputs with the
+ * same output format and shards as the current scan.
+ *
+ * @param  checkpoint Checkpoint that is resumed.
+ * @param  current    Checkpoint of the current scan from StartCheckpoint().
+ */
+void CheckResume(const ScanCheckpoint &checkpoint,
+                 const ScanCheckpoint &current) {
+  if (checkpoint.inputs != current.inputs ||
+      checkpoint.input_sizes != current.input_sizes) {
+    Die("Checkpoint was written for other input files.");
+  } else if (checkpoint.output_format != current.output_format) {
+    Die("Checkpoint was written with another output format.");
+  } else if (checkpoint.shard_count != current.shard_count) {
+    Die("Checkpoint was written with another number of shards.");
+  }
+}
+
+/**
+ * Replaces a checkpoint file atomically. The checkpoint is written to a
+ * temporary file, which is synced and renamed over the checkpoint file.
+ *
+ * @param  file_name  Checkpoint file name.
+ * @param  checkpoint Progress of the scan.
+ */
+void WriteCheckpoint(const string &file_name,
+                     const ScanCheckpoint &checkpoint) {
+  stringstream str;
+  str << "#scan_checkpoint\n";
+  for (size_t i = 0; i < checkpoint.inputs.size(); ++i) {
+    str << "input\t" << checkpoint.input_sizes[i] << "\t"
+        << checkpoint.inputs[i] << "\n";
+  }
+  str << "format\t" << checkpoint.output_format << "\n"
+      << "output_size\t" << checkpoint.output_size << "\n"
+      << "written\t" << checkpoint.written_count << "\n"
+      << "scanned\t" << checkpoint.scanned_count << "\n";
+  if (checkpoint.shard_count > 0) {
+    str << "shards\t" << checkpoint.next_shard << "\t"
+        << checkpoint.shard_count << "\n";
+  } else {
+    str << "offsets";
+    for (int i = 0; i < kIndividualCount; ++i) {
+      str << "\t" << checkpoint.offsets[i];
+    }
+    str << "\n" << "site\t" << checkpoint.contig << "\t"
+        << checkpoint.position << "\n";
+    for (const string &contig : checkpoint.finished_contigs) {
+      str << "finished\t" << contig << "\n";
+    }
+  }
+
+  const string temp_name = file_name + ".tmp";
+  const string data = str.str();
+  int fd = open(temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    Die("Checkpoint file cannot be written.");
+  }
+  ssize_t written = 0;
+  for (size_t offset = 0; offset < data.size(); offset += written) {
+    written = write(fd, data.data() + offset, data.size() - offset);
+    if (written == -1 && errno == EINTR) {
+      written = 0;
+    } else if (written == -1) {
+      Die("Checkpoint file cannot be written.");
+    }
+  }
+  if (fsync(fd) == -1 || close(fd) == -1 ||
+      rename(temp_name.c_str(), file_name.c_str()) == -1) {
+    Die("Checkpoint file cannot be written.");
+  }
+}
+
+/**
+ * Reads a checkpoint file.
+ *
+ * @param  file_name  Checkpoint file name.
+ * @param  checkpoint Progress of the scan that is read.
+ * @return            False if there is no checkpoint file.
+ */
+bool ReadCheckpoint(const string &file_name, ScanCheckpoint &checkpoint) {
+  ifstream f(file_name);
+  if (!f.is_open()) {
+    return false;
+  }
+  string line;
+  if (!getline(f, line) || line != "#scan_checkpoint") {
+    Die("Checkpoint file is not in the format: #scan_checkpoint.");
+  }
+
+  checkpoint = ScanCheckpoint();
+  while (getline(f, line)) {
+    stringstream str(line);
+    string key;
+    getline(str, key, '\t');
+    if (key == "input") {
+      off_t size = 0;
+      string name;
+      str >> size;
+      str.ignore(1);
+      getline(str, name);
+      checkpoint.input_sizes.push_back(size);
+      checkpoint.inputs.push_back(name);
+    } else if (key == "format") {
+      str >> checkpoint.output_format;
+    } else if (key == "output_size") {
+      str >> checkpoint.output_size;
+    } else if (key == "written") {
+      str >> checkpoint.written_count;
+    } else if (key == "scanned") {
+      str >> checkpoint.scanned_count;
+    } else if (key == "offsets") {
+      for (int i = 0; i < kIndividualCount; ++i) {
+        str >> checkpoint.offsets[i];
+      }
+    } else if (key == "site") {
+      getline(str, checkpoint.contig, '\t');
+      str >> checkpoint.position;
+    } else if (key == "finished") {
+      string contig;
+      getline(str, contig);
+      checkpoint.finished_contigs.insert(contig);
+    } else if (key == "shards") {
+      str >> checkpoint.next_shard >> checkpoint.shard_count;
+    }
+    if (str.fail()) {
+      Die("Checkpoint file has an invalid line.");
+    }
+  }
+  if (checkpoint.output_size < 0) {
+    Die("Checkpoint file does not have the size of the output.");
+  }
+  return true;
+}
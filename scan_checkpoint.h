@@ -0,0 +1,89 @@
+/**
+ * @file scan_checkpoint.h
+ * @author Melissa Ip
+ *
+ * The ScanCheckpoint struct records the progress of a pileup_driver scan, so a
+ * run that is stopped, e.g. on a preemptible node, can resume where it was
+ * instead of starting over. A checkpoint is a text file next to the output
+ * (<output>.checkpoint):
+ *
+ *   #scan_checkpoint
+ *   input  <size>  <file name>        One line for each input file.
+ *   format  <output format>
+ *   output_size  <bytes>              Bytes of the output that are complete.
+ *   written  <sites>                  Sites in those bytes.
+ *   scanned  <sites>                  Sites that were scored (single scans).
+ *   offsets  <child>  <mother>  <father>
+ *   site  <contig>  <position>        Last site that was scored.
+ *   finished  <contig>                One line for each merged contig.
+ *   shards  <next shard>  <shards>    Shards that were written (shard scans).
+ *
+ * A single scan records the offset of the current line of each pileup file
+ * (see PileupMerger::head_offset()) after the last scored site, and a shard
+ * scan records the shards that were written in order. The output is written
+ * to <output>.partial, which is synced before each checkpoint and renamed to
+ * the output once the scan is complete, so a complete output file is never
+ * mixed with a partial scan. A resumed scan truncates the partial output to
+ * the size in the checkpoint and writes the same bytes as an uninterrupted
+ * scan after it.
+ *
+ * Checkpoints are replaced atomically, i.e. written to a temporary file that
+ * is synced and renamed over the previous checkpoint.
+ *
+ * Example usage:
+ *
+ *   ScanCheckpoint checkpoint;
+ *   checkpoint.output_size = writer.Sync();
+ *   WriteCheckpoint("output.txt.checkpoint", checkpoint);
+ *   ReadCheckpoint("output.txt.checkpoint", checkpoint);  // After a restart.
+ */
+#ifndef SCAN_CHECKPOINT_H
+#define SCAN_CHECKPOINT_H
+
+#include <sys/types.h>
+#include <set>
+
+#include "trio_model.h"
+
+
+// Extensions of the checkpoint and of the output while it is incomplete.
+const string kCheckpointExtension = ".checkpoint";
+const string kPartialExtension = ".partial";
+
+// Seconds between checkpoints if --resume is given without --checkpoint.
+const int kDefaultCheckpointSeconds = 300;
+
+// Number of sites between checks of the clock in single scans.
+const int kCheckpointSiteInterval = 1 << 12;
+
+/**
+ * Progress of a scan. See top of file for a complete description.
+ */
+struct ScanCheckpoint {
+  ScanCheckpoint() : output_size{-1}, written_count{0}, scanned_count{0},
+                     offsets{-1, -1, -1}, position{0}, next_shard{0},
+                     shard_count{0} {}
+  vector<string> inputs;
+  vector<off_t> input_sizes;
+  string output_format;
+  off_t output_size;  // -1 if the scan has not started.
+  uint64_t written_count;
+  uint64_t scanned_count;
+  off_t offsets[kIndividualCount];  // -1 for exhausted files.
+  string contig;
+  int position;
+  set<string> finished_contigs;
+  int next_shard;
+  int shard_count;  // 0 for single scans.
+};
+
+// Forward declarations.
+ScanCheckpoint StartCheckpoint(const vector<string> &inputs,
+                               const string &output_format);
+void CheckResume(const ScanCheckpoint &checkpoint,
+                 const ScanCheckpoint &current);
+void WriteCheckpoint(const string &file_name,
+                     const ScanCheckpoint &checkpoint);
+bool ReadCheckpoint(const string &file_name, ScanCheckpoint &checkpoint);
+
+#endif
@@ -11,11 +11,15 @@
  * 1.6732e-10      0
  * 0.00709331      1
  *
+ * With --binary, the samples are written to a columnar binary result store
+ * instead, which result_query filters and converts back to text (see
+ * result_store.h).
+ *
  * To compile on Herschel without using cmake and include GSL:
- * c++ -std=c++11 -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o simulation_driver utility.cc read_dependent_data.cc trio_model.cc simulation_model.cc simulation_driver.cc
+ * c++ -std=c++11 -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o simulation_driver utility.cc likelihood.cc read_dependent_data.cc trio_model.cc result_store.cc simulation_model.cc simulation_driver.cc
  *
  * To run this file, provide the following command line inputs:
- * ./simulation_driver <output>.txt <#samples> <coverage> <population mutation rate> <germline mutation rate> <somatic mutation rate>
+ * ./simulation_driver <output>.txt <#samples> <coverage> <population mutation rate> <germline mutation rate> <somatic mutation rate> [--binary]
  */
 #include "simulation_model.h"
 
@@ -24,7 +28,7 @@ int main(int argc, const char *argv[]) {
   if (argc < 7) {
     Die("USAGE: simulation_driver <output>.txt <#samples> <coverage> "
         "<population mutation rate> <germline mutation rate> "
-        "<somatic mutation rate>");
+        "<somatic mutation rate> [--binary]");
   }
 
   const string file_name = argv[1];
@@ -33,6 +37,7 @@ int main(int argc, const char *argv[]) {
   const double population_mutation_rate = strtod(argv[4], NULL);
   const double germline_mutation_rate = strtod(argv[5], NULL);
   const double somatic_mutation_rate = strtod(argv[6], NULL);
+  const bool is_binary = argc > 7 && string(argv[7]) == "--binary";
   
   // Sets up simulation parameters and output results.
   SimulationModel sim(coverage,
@@ -40,7 +45,11 @@ int main(int argc, const char *argv[]) {
                       germline_mutation_rate,
                       somatic_mutation_rate);
   sim.Seed();
-  sim.WriteProbability(file_name, experiment_count);
+  if (is_binary) {
+    sim.WriteResultStore(file_name, experiment_count);
+  } else {
+    sim.WriteProbability(file_name, experiment_count);
+  }
   // sim.WriteMutationCounts(file_name, experiment_count);
   // sim.PrintMutationCounts(experiment_count);
   sim.Free();
@@ -16,7 +16,8 @@
  * other parameters are set to default.
  *
  * has_mutation_ keeps track of whether each site contains a mutation and is
- * reused for all sites.
+ * reused for all sites. The discrete tables of the sampling distributions are
+ * built from the parameters.
  *
  * @param  coverage               Coverage.
  * @param  germline_mutation_rate Germline mutation rate.
@@ -30,6 +31,7 @@ SimulationModel::SimulationModel(unsigned int coverage,
   params_.set_population_mutation_rate(population_mutation_rate);
   params_.set_germline_mutation_rate(germline_mutation_rate);
   params_.set_somatic_mutation_rate(somatic_mutation_rate);
+  SimulationModel::SetDiscreteTables();
 }
 
 /**
@@ -70,6 +72,28 @@ void SimulationModel::WriteProbability(const string &file_name, int size) {
   fout.close();
 }
 
+/**
+ * Generates size random samples like WriteProbability() and writes them to a
+ * binary result store (see result_store.h) that result_query reads. Each
+ * sample is a site of the contig "simulation" at its 1-based index, with an
+ * unknown reference nucleotide, its reads and whether it contains a mutation
+ * as its label.
+ *
+ * @param  file_name File name.
+ * @param  size      Number of experiments or trios.
+ */
+void SimulationModel::WriteResultStore(const string &file_name, int size) {
+  ResultStoreWriter writer(file_name);
+  const string contig = "simulation";
+  TrioVector random_trios = SimulationModel::GetRandomTrios(size);
+  for (int i = 0; i < size; ++i) {
+    double probability = params_.MutationProbability(random_trios[i]);
+    writer.Write(StringView(contig.data(), contig.size()), i + 1, 'N',
+                 random_trios[i].data(), probability, has_mutation_vec_[i]);
+  }
+  writer.Close();
+}
+
 /**
  * Writes to a text file the index of the key trio, how many random trios had a
  * mutation, how many random trios had no mutation, tab separated, each trio
@@ -120,52 +144,54 @@ void SimulationModel::PrintMutationCounts(int size) {
 }
 
 /**
- * Generates a random sample from the range [0, K) using K size probabilities
- * as weights.
+ * Preprocesses probabilities into a GSL discrete table, which is Walker's
+ * alias table, so each draw takes constant time.
  *
- * @param  K              Number of cateogories in probabilities.
- * @param  probabilitites RowVector of probabilities associated with each entry
- *                        in the samples generated by K.
- * @return                Random element based on probabilities from samples
- *                        generated by K.
+ * @param  probabilities RowVector of probabilities associated with each
+ *                       category.
+ * @return               Discrete table of the probabilities.
  */
-int SimulationModel::RandomDiscreteChoice(size_t K,
-                                          const RowVectorXd &probabilities) {
+DiscreteTable SimulationModel::GetDiscreteTable(const RowVectorXd &probabilities) {
   // Converts probabilities to double array p.
   int length = probabilities.size();
   double p[length];
   for (int i = 0; i < length; ++i) {
     p[i] = probabilities(i);
   }
+  return DiscreteTable(gsl_ran_discrete_preproc(length, p));
+}
 
-  // Creates discrete random number generator.
-  gsl_ran_discrete_t *g = gsl_ran_discrete_preproc(K, p);
-  size_t random = gsl_ran_discrete(generator_, g);
-  gsl_ran_discrete_free(g);
-  
-  return (int) random;
+/**
+ * Builds the discrete tables of the population priors, of each row of the
+ * somatic transition matrix and of each column of the germline transition
+ * matrix. Called whenever the parameters change.
+ */
+void SimulationModel::SetDiscreteTables() {
+  population_priors_table_ = SimulationModel::GetDiscreteTable(
+    params_.population_priors()
+  );
+  const Matrix16_16d somatic_probability_mat = params_.somatic_probability_mat();
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    somatic_tables_[i] = SimulationModel::GetDiscreteTable(
+      somatic_probability_mat.row(i)
+    );
+  }
+  const Matrix16_256d germline_probability_mat = params_.germline_probability_mat();
+  for (int i = 0; i < kGenotypePairCount; ++i) {
+    germline_tables_[i] = SimulationModel::GetDiscreteTable(
+      germline_probability_mat.col(i).transpose()
+    );
+  }
 }
 
 /**
- * Generates RowVector of random samples from the range [0, K) using K size
- * probabilities as weights.
+ * Generates a random sample from the categories of a discrete table.
  *
- * @param  K              Number of cateogories in probabilities.
- * @param  probabilitites RowVector of probabilities associated with each entry
- *                        in the samples generated by K.
- * @param  size           Number of samples.
- * @return                Random samples based on probabilities from samples
- *                        generated by K.
+ * @param  table Discrete table of the probabilities of each category.
+ * @return       Random category.
  */
-RowVectorXi SimulationModel::RandomDiscreteChoice(size_t K,
-                                                  const RowVectorXd &probabilities,
-                                                  int size) {
-  // Creates size RowVector to hold random samples.
-  RowVectorXi random_samples(size);
-  for (int i = 0; i < size; ++i) {
-    random_samples(i) = SimulationModel::RandomDiscreteChoice(K, probabilities);
-  }
-  return random_samples;
+int SimulationModel::RandomDiscreteChoice(const DiscreteTable &table) {
+  return (int) gsl_ran_discrete(generator_, table.get());
 }
 
 /**
@@ -184,18 +210,11 @@ RowVectorXi SimulationModel::RandomDiscreteChoice(size_t K,
  */
 int SimulationModel::Mutate(int genotype_idx, bool is_germline,
                             int parent_genotype_idx) {
-  // Sets probability matrices to use either germline or somatic probabilities.
-  RowVector16d mat = RowVector16d::Zero();
-  if (!is_germline) {
-    mat = params_.somatic_probability_mat().row(genotype_idx);
-  } else {
-    mat = params_.germline_probability_mat().col(parent_genotype_idx);
-  }
-
-  // Randomly mutates the genotype using the probabilities as weights.
+  // Randomly mutates the genotype using the germline or somatic probabilities
+  // as weights.
   int mutated_genotype_idx = SimulationModel::RandomDiscreteChoice(
-    kGenotypeCount,
-    mat
+    is_germline ? germline_tables_[parent_genotype_idx] :
+                  somatic_tables_[genotype_idx]
   );
   if (mutated_genotype_idx != genotype_idx) {
     has_mutation_ = true;
@@ -249,18 +268,15 @@ int SimulationModel::GetChildGenotype(int mother_genotype, int father_genotype)
  * @return      3 x size Eigen matrix of genotypes.
  */
 MatrixXi SimulationModel::GetGenotypesMatrix(int size) {
-  // Generates random samples using population priors as weights.
-  RowVectorXi parent_genotypes = SimulationModel::RandomDiscreteChoice(
-    kGenotypePairCount,
-    params_.population_priors(),
-    size
-  );
-
-  // Extracts parent genotypes from samples and gets child genotypes.
+  // Generates random samples using population priors as weights, extracts
+  // parent genotypes from samples and gets child genotypes.
   MatrixXi genotypes_mat(3, size);
   for (int i = 0; i < size; ++i) {
-    int mother_genotype = parent_genotypes(i) / kGenotypeCount;
-    int father_genotype = parent_genotypes(i) % kGenotypeCount;
+    int parent_genotypes = SimulationModel::RandomDiscreteChoice(
+      population_priors_table_
+    );
+    int mother_genotype = parent_genotypes / kGenotypeCount;
+    int father_genotype = parent_genotypes % kGenotypeCount;
     genotypes_mat(1, i) = mother_genotype;
     genotypes_mat(2, i) = father_genotype;
     genotypes_mat(0, i) = SimulationModel::GetChildGenotype(
@@ -364,6 +380,7 @@ double SimulationModel::population_mutation_rate() const {
 
 void SimulationModel::set_population_mutation_rate(double rate) {
    params_.set_population_mutation_rate(rate);
+  SimulationModel::SetDiscreteTables();
 }
 
 double SimulationModel::germline_mutation_rate() const {
@@ -372,6 +389,7 @@ double SimulationModel::germline_mutation_rate() const {
 
 void SimulationModel::set_germline_mutation_rate(double rate) {
   params_.set_germline_mutation_rate(rate);
+  SimulationModel::SetDiscreteTables();
 }
 
 double SimulationModel::somatic_mutation_rate() const {
@@ -380,6 +398,7 @@ double SimulationModel::somatic_mutation_rate() const {
 
 void SimulationModel::set_somatic_mutation_rate(double rate) {
   params_.set_somatic_mutation_rate(rate);
+  SimulationModel::SetDiscreteTables();
 }
 
 bool SimulationModel::has_mutation() const {
@@ -7,6 +7,11 @@
  * random family pedigree based on population priors and calculates the
  * probability of mutation using the generated sample (sequencing reads are
  * drawn from the Dirichlet multinomial).
+ *
+ * The population priors, the 16 rows of the somatic transition matrix and the
+ * 256 columns of the germline transition matrix are preprocessed into GSL
+ * discrete (alias) tables once whenever the parameters change, so every
+ * genotype and mutation draw takes constant time.
  */
 #ifndef SIMULATION_MODEL_H
 #define SIMULATION_MODEL_H
@@ -14,14 +19,26 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdio.h>
 #include <time.h>
 
 #include <gsl/gsl_randist.h>  // Already included in utility.h.
 #include <gsl/gsl_rng.h>
 
-#include "trio_model.h"
+#include "result_store.h"
+
+
+/**
+ * Frees a GSL discrete table.
+ */
+struct DiscreteTableDeleter {
+  void operator()(gsl_ran_discrete_t *table) const {
+    gsl_ran_discrete_free(table);
+  }
+};
 
+typedef unique_ptr<gsl_ran_discrete_t, DiscreteTableDeleter> DiscreteTable;
 
 /**
  * SimulationModel class header. See top of file for a complete description.
@@ -36,6 +53,7 @@ class SimulationModel {
   void Seed();  // Seeds random number generator.
   void Free();
   void WriteProbability(const string &file_name, int size);  // Generates random samples and probabilities in text file.
+  void WriteResultStore(const string &file_name, int size);  // Same in a binary result store.
   void WriteMutationCounts(const string &file_name, int size);
   void PrintMutationCounts(int size); // Simulates trios to stdout.
   unsigned int coverage() const;  // Get and set functions.
@@ -58,9 +76,9 @@ class SimulationModel {
   ReadData DirichletMultinomialSample(int genotype_idx);
   MatrixXi GetGenotypesMatrix(int size);
   TrioVector GetRandomTrios(int size);
-  int RandomDiscreteChoice(size_t K, const RowVectorXd &probabilities);
-  RowVectorXi RandomDiscreteChoice(size_t K, const RowVectorXd &probabilities,
-                                   int size);
+  DiscreteTable GetDiscreteTable(const RowVectorXd &probabilities);
+  void SetDiscreteTables();
+  int RandomDiscreteChoice(const DiscreteTable &table);
 
   // Instance member variables.
   TrioModel params_;  // Default initialization.
@@ -69,6 +87,9 @@ class SimulationModel {
   vector<bool> has_mutation_vec_;
   vector<bool> mutation_table_[kTrioCount];
   gsl_rng *generator_;
+  DiscreteTable population_priors_table_;  // Parent genotype pairs.
+  DiscreteTable somatic_tables_[kGenotypeCount];  // Rows of the somatic transition matrix.
+  DiscreteTable germline_tables_[kGenotypePairCount];  // Columns of the germline transition matrix.
 };
 
 #endif
@@ -7,7 +7,7 @@
  * somatic mutation rates are both set to 1e-6.
  *
  * To compile on Herschel and include GSL:
- * c++ -std=c++11 -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o simulation_trio utility.cc read_dependent_data.cc trio_model.cc simulation_trio.cc
+ * c++ -std=c++11 -L/usr/local/lib -lgsl -lgslcblas -lm -I/usr/local/include -o simulation_trio utility.cc likelihood.cc read_dependent_data.cc trio_model.cc simulation_trio.cc
  *
  * To run this file, provide the following command line inputs:
  * ./simulation_trio <output>.txt
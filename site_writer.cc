@@ -0,0 +1,556 @@
+/**
+ * @file site_writer.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the SiteWriter class.
+ *
+ * See top of site_writer.h for a complete description.
+ */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "site_writer.h"
+
+// Output formats.
+const int kSitesFormat = 0;
+const int kVcfFormat = 1;
+const int kProbabilitiesFormat = 2;
+const int kLabelsFormat = 3;
+const int kBinaryFormat = 4;
+const int kHistogramFormat = 5;
+
+// Nucleotides in the order of ReadData.
+const char kNucleotides[] = "ACGT";
+
+
+/**
+ * Returns true if a top site ranks above another, i.e. has a higher
+ * probability or the same probability and was scored earlier.
+ *
+ * @param  a Top site.
+ * @param  b Top site.
+ * @return   True if a ranks above b.
+ */
+bool IsHigherTopSite(const TopSite &a, const TopSite &b) {
+  return a.probability > b.probability ||
+         (a.probability == b.probability && a.order < b.order);
+}
+
+/**
+ * Returns true if a top site was scored before another.
+ *
+ * @param  a Top site.
+ * @param  b Top site.
+ * @return   True if a was scored before b.
+ */
+bool IsEarlierTopSite(const TopSite &a, const TopSite &b) {
+  return a.order < b.order;
+}
+
+/**
+ * Constructor that opens the output file and writes the header of the format,
+ * or opens a partial output to resume it after its synced size.
+ *
+ * @param  file_name   Output file name.
+ * @param  format      sites, vcf, probabilities, labels, binary or histogram.
+ * @param  resume_size Size of the partial output to keep, or -1 to truncate
+ *                     the file.
+ */
+SiteWriter::SiteWriter(const string &file_name, const string &format,
+                       off_t resume_size)
+    : fd_{-1}, format_{kSitesFormat}, line_count_{0}, top_count_{0},
+      last_contig_index_{-1}, top_order_{0} {
+  SiteWriter::SetFormat(format);
+  if (format_ == kBinaryFormat) {
+    if (resume_size >= 0) {
+      Die("Binary output cannot be resumed.");
+    }
+    store_.reset(new ResultStoreWriter(file_name));
+    return;
+  }
+  if (resume_size >= 0) {
+    fd_ = open(file_name.c_str(), O_WRONLY);
+    if (fd_ == -1 || ftruncate(fd_, resume_size) == -1 ||
+        lseek(fd_, resume_size, SEEK_SET) == -1) {
+      Die("Partial output file cannot be resumed.");
+    }
+    buffer_.reserve(kWriteBufferSize + 4096);
+    return;
+  }
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ == -1) {
+    Die("Output file cannot be written.");
+  }
+  buffer_.reserve(kWriteBufferSize + 4096);
+  SiteWriter::WriteHeader();
+}
+
+/**
+ * Constructor of a writer that formats lines into memory without a header.
+ *
+ * @param  format sites, vcf, probabilities, labels, binary or histogram.
+ */
+SiteWriter::SiteWriter(const string &format)
+    : fd_{-1}, format_{kSitesFormat}, line_count_{0}, top_count_{0},
+      last_contig_index_{-1}, top_order_{0} {
+  SiteWriter::SetFormat(format);
+  if (format_ == kBinaryFormat) {
+    store_.reset(new ResultStoreWriter());
+  }
+}
+
+/**
+ * Destructor that writes the top sites that were kept, the rest of the buffer
+ * and closes the file. A binary file is closed by its ResultStoreWriter.
+ */
+SiteWriter::~SiteWriter() {
+  if (!top_sites_.empty()) {
+    SiteWriter::WriteTopSites();
+  }
+  if (fd_ != -1) {
+    SiteWriter::Flush();
+    close(fd_);
+  }
+}
+
+/**
+ * Formats the line of a scored site.
+ *
+ * @param  contig         Contig of the site.
+ * @param  position       1-based position of the site.
+ * @param  ref_nucleotide Reference nucleotide of the site.
+ * @param  reads          Reads of the child, mother and father.
+ * @param  probability    Probability of mutation.
+ * @param  label          1 if the simulated site has a mutation, 0 if not, -1
+ *                        if the site is not simulated.
+ */
+void SiteWriter::Write(const StringView &contig, int position,
+                       char ref_nucleotide, const ReadData *reads,
+                       double probability, int label) {
+  if (top_count_ > 0) {
+    TopSite site;
+    site.probability = probability;
+    site.order = top_order_++;
+    site.position = position;
+    site.ref_nucleotide = ref_nucleotide;
+    site.label = label;
+    for (int i = 0; i < kIndividualCount; ++i) {
+      site.reads[i] = reads[i];
+    }
+    SiteWriter::PushTopSite(site, contig);
+    return;
+  }
+
+  line_count_++;
+  if (format_ == kBinaryFormat) {
+    store_->Write(contig, position, ref_nucleotide, reads, probability, label);
+    return;
+  } else if (format_ == kHistogramFormat) {
+    Die("Histogram output is only written with distinct trios.");
+  }
+
+  if (format_ == kProbabilitiesFormat) {
+    SiteWriter::AppendLegacyDouble(probability);
+    buffer_ += '\n';
+  } else if (format_ == kLabelsFormat) {
+    SiteWriter::AppendLegacyDouble(probability);
+    buffer_ += '\t';
+    buffer_ += label == 1 ? '1' : '0';
+    buffer_ += '\n';
+  } else if (format_ == kSitesFormat) {
+    buffer_.append(contig.data, contig.size);
+    buffer_ += '\t';
+    SiteWriter::AppendInt(position);
+    buffer_ += '\t';
+    buffer_ += ref_nucleotide;
+    for (int i = 0; i < kIndividualCount; ++i) {
+      buffer_ += '\t';
+      SiteWriter::AppendCounts(reads[i]);
+    }
+    buffer_ += '\t';
+    SiteWriter::AppendDouble(probability);
+    buffer_ += '\n';
+  } else {
+    buffer_.append(contig.data, contig.size);
+    buffer_ += '\t';
+    SiteWriter::AppendInt(position);
+    buffer_ += "\t.\t";
+    buffer_ += ref_nucleotide;
+    buffer_ += '\t';
+    bool has_alt = false;
+    for (int k = 0; k < 4; ++k) {
+      if (kNucleotides[k] == ref_nucleotide) {
+        continue;
+      }
+      for (int i = 0; i < kIndividualCount; ++i) {
+        if (reads[i].reads[k] > 0) {
+          if (has_alt) {
+            buffer_ += ',';
+          }
+          buffer_ += kNucleotides[k];
+          has_alt = true;
+          break;
+        }
+      }
+    }
+    if (!has_alt) {
+      buffer_ += '.';
+    }
+    buffer_ += "\t.\tPASS\tPM=";
+    SiteWriter::AppendDouble(probability);
+    buffer_ += "\tBC";
+    for (int i = 0; i < kIndividualCount; ++i) {
+      buffer_ += '\t';
+      SiteWriter::AppendCounts(reads[i]);
+    }
+    buffer_ += '\n';
+  }
+
+  if (fd_ != -1 && buffer_.size() >= kWriteBufferSize) {
+    SiteWriter::Flush();
+  }
+}
+
+/**
+ * Formats the line of a distinct trio in the histogram format.
+ *
+ * @param  reads          Reads of the child, mother and father.
+ * @param  ref_nucleotide Reference nucleotide of the priors, or N.
+ * @param  probability    Probability of mutation.
+ * @param  site_count     Number of sites of the trio.
+ */
+void SiteWriter::WriteDistinct(const ReadData *reads, char ref_nucleotide,
+                               double probability, uint64_t site_count) {
+  line_count_++;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    SiteWriter::AppendCounts(reads[i]);
+    buffer_ += '\t';
+  }
+  buffer_ += ref_nucleotide;
+  buffer_ += '\t';
+  SiteWriter::AppendDouble(probability);
+  buffer_ += '\t';
+  buffer_ += to_string(site_count);
+  buffer_ += '\n';
+
+  if (fd_ != -1 && buffer_.size() >= kWriteBufferSize) {
+    SiteWriter::Flush();
+  }
+}
+
+/**
+ * Appends the lines of a memory writer and clears them. If top sites are
+ * kept, the top sites of the memory writer are added to the heap instead, in
+ * the order they were scored.
+ *
+ * @param  other Memory writer, e.g. of a shard.
+ */
+void SiteWriter::Append(SiteWriter &other) {
+  if (top_count_ > 0) {
+    sort(other.top_sites_.begin(), other.top_sites_.end(), IsEarlierTopSite);
+    for (TopSite site : other.top_sites_) {
+      const string &contig = other.top_contigs_[site.contig_index];
+      site.order = top_order_++;
+      SiteWriter::PushTopSite(site, StringView(contig.data(), contig.size()));
+    }
+    vector<TopSite>().swap(other.top_sites_);
+    vector<string>().swap(other.top_contigs_);
+    vector<int>().swap(other.top_contig_counts_);
+    vector<int>().swap(other.free_contig_indices_);
+    other.last_contig_index_ = -1;
+    return;
+  }
+  line_count_ += other.line_count_;
+  other.line_count_ = 0;
+  if (format_ == kBinaryFormat) {
+    store_->Append(*other.store_);
+    return;
+  }
+  if (fd_ != -1 && buffer_.size() + other.buffer_.size() >= kWriteBufferSize) {
+    SiteWriter::Flush();
+    ssize_t written = 0;
+    for (size_t offset = 0; offset < other.buffer_.size(); offset += written) {
+      written = write(fd_, other.buffer_.data() + offset,
+                      other.buffer_.size() - offset);
+      if (written == -1 && errno == EINTR) {
+        written = 0;
+      } else if (written == -1) {
+        Die("Output file cannot be written.");
+      }
+    }
+  } else {
+    buffer_ += other.buffer_;
+  }
+  string().swap(other.buffer_);
+}
+
+/**
+ * Keeps only the sites with the highest probabilities, which are written when
+ * the writer is destroyed. Memory writers of shards keep the same number of
+ * sites.
+ *
+ * @param  top_count Number of sites that are kept.
+ */
+void SiteWriter::KeepTop(size_t top_count) {
+  top_count_ = top_count;
+  top_sites_.reserve(top_count);
+}
+
+/**
+ * Returns the minimum probability of a site that is written, which is raised
+ * to the lowest top site once the heap of top sites is full.
+ *
+ * @param  threshold Minimum probability of the scan.
+ * @return           Minimum probability of the next site.
+ */
+double SiteWriter::Threshold(double threshold) const {
+  if (top_count_ > 0 && top_sites_.size() == top_count_) {
+    return max(threshold, top_sites_.front().probability);
+  }
+  return threshold;
+}
+
+size_t SiteWriter::top_count() const {
+  return top_count_;
+}
+
+bool SiteWriter::is_histogram() const {
+  return format_ == kHistogramFormat;
+}
+
+uint64_t SiteWriter::line_count() const {
+  return line_count_;
+}
+
+/**
+ * Writes the buffer to the output file.
+ */
+void SiteWriter::Flush() {
+  ssize_t written = 0;
+  for (size_t offset = 0; offset < buffer_.size(); offset += written) {
+    written = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+    if (written == -1 && errno == EINTR) {
+      written = 0;
+    } else if (written == -1) {
+      Die("Output file cannot be written.");
+    }
+  }
+  buffer_.clear();
+}
+
+/**
+ * Writes the buffer and syncs the output file, so its bytes survive a crash
+ * before a checkpoint refers to them.
+ *
+ * @return Size of the output file.
+ */
+off_t SiteWriter::Sync() {
+  if (fd_ == -1) {
+    Die("Only output files are synced.");
+  }
+  SiteWriter::Flush();
+  off_t size = lseek(fd_, 0, SEEK_CUR);
+  if (size == -1 || fdatasync(fd_) == -1) {
+    Die("Output file cannot be synced.");
+  }
+  return size;
+}
+
+/**
+ * Sets the output format from its name.
+ *
+ * @param  format sites, vcf, probabilities, labels, binary or histogram.
+ */
+void SiteWriter::SetFormat(const string &format) {
+  if (format == "sites") {
+    format_ = kSitesFormat;
+  } else if (format == "vcf") {
+    format_ = kVcfFormat;
+  } else if (format == "probabilities") {
+    format_ = kProbabilitiesFormat;
+  } else if (format == "labels") {
+    format_ = kLabelsFormat;
+  } else if (format == "binary") {
+    format_ = kBinaryFormat;
+  } else if (format == "histogram") {
+    format_ = kHistogramFormat;
+  } else {
+    Die("Output format must be sites, vcf, probabilities, labels, binary or "
+        "histogram.");
+  }
+}
+
+/**
+ * Formats the header lines of the output format.
+ */
+void SiteWriter::WriteHeader() {
+  if (format_ == kSitesFormat) {
+    buffer_ += "#contig\tposition\treference\tchild\tmother\tfather\t"
+               "probability\n";
+  } else if (format_ == kVcfFormat) {
+    buffer_ += "##fileformat=VCFv4.2\n"
+               "##source=pileup_driver\n"
+               "##INFO=<ID=PM,Number=1,Type=Float,"
+               "Description=\"Probability of mutation\">\n"
+               "##FORMAT=<ID=BC,Number=4,Type=Integer,"
+               "Description=\"Counts of A, C, G and T\">\n"
+               "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tchild\t"
+               "mother\tfather\n";
+  } else if (format_ == kHistogramFormat) {
+    buffer_ += "#child\tmother\tfather\treference\tprobability\tsites\n";
+  }
+}
+
+/**
+ * Formats a non-negative integer.
+ *
+ * @param  value Integer.
+ */
+void SiteWriter::AppendInt(int value) {
+  char digits[16];
+  int size = 0;
+  do {
+    digits[size++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  while (size > 0) {
+    buffer_ += digits[--size];
+  }
+}
+
+/**
+ * Formats a double with the fewest significant digits that parse back to the
+ * same double. Every double that has a representation of at most 15 digits
+ * is printed as that representation by %.15g, so at most 17 digits are
+ * tried.
+ *
+ * @param  value Double.
+ */
+void SiteWriter::AppendDouble(double value) {
+  char digits[32];
+  int size = 0;
+  for (int precision = 15; precision <= 17; ++precision) {
+    size = snprintf(digits, sizeof(digits), "%.*g", precision, value);
+    if (precision == 17 || strtod(digits, nullptr) == value) {
+      break;
+    }
+  }
+  buffer_.append(digits, size);
+}
+
+/**
+ * Formats a double with 6 significant digits like the default of ostream, as
+ * the probabilities were written by earlier versions.
+ *
+ * @param  value Double.
+ */
+void SiteWriter::AppendLegacyDouble(double value) {
+  char digits[32];
+  int size = snprintf(digits, sizeof(digits), "%g", value);
+  buffer_.append(digits, size);
+}
+
+/**
+ * Formats the counts of A, C, G and T separated by commas.
+ *
+ * @param  reads Counts of an individual.
+ */
+void SiteWriter::AppendCounts(const ReadData &reads) {
+  for (int k = 0; k < 4; ++k) {
+    if (k > 0) {
+      buffer_ += ',';
+    }
+    SiteWriter::AppendInt(reads.reads[k]);
+  }
+}
+
+/**
+ * Adds a site to the heap of top sites. Once the heap is full, the site
+ * replaces the lowest top site if it ranks above it, and the contig of the
+ * lowest top site is released.
+ *
+ * @param  site   Scored site, whose contig index is set if it is kept.
+ * @param  contig Contig of the site.
+ */
+void SiteWriter::PushTopSite(TopSite &site, const StringView &contig) {
+  if (top_sites_.size() == top_count_ &&
+      !IsHigherTopSite(site, top_sites_.front())) {
+    return;
+  }
+  site.contig_index = SiteWriter::AddTopContig(contig);
+  top_contig_counts_[site.contig_index]++;
+  if (top_sites_.size() < top_count_) {
+    top_sites_.push_back(site);
+    push_heap(top_sites_.begin(), top_sites_.end(), IsHigherTopSite);
+  } else {
+    pop_heap(top_sites_.begin(), top_sites_.end(), IsHigherTopSite);
+    SiteWriter::ReleaseTopContig(top_sites_.back().contig_index);
+    top_sites_.back() = site;
+    push_heap(top_sites_.begin(), top_sites_.end(), IsHigherTopSite);
+  }
+}
+
+/**
+ * Returns the index of the contig of a top site. Sites of the same contig
+ * usually follow each other, so the contig is compared with the contig of the
+ * last top site, and a new contig takes the index of a contig that has no top
+ * sites left.
+ *
+ * @param  contig Contig of the site.
+ * @return        Index in top_contigs_.
+ */
+int SiteWriter::AddTopContig(const StringView &contig) {
+  if (last_contig_index_ != -1) {
+    const string &last_contig = top_contigs_[last_contig_index_];
+    if (contig.Equals(StringView(last_contig.data(), last_contig.size()))) {
+      return last_contig_index_;
+    } else if (top_contig_counts_[last_contig_index_] == 0) {
+      free_contig_indices_.push_back(last_contig_index_);
+    }
+  }
+  if (free_contig_indices_.empty()) {
+    last_contig_index_ = top_contigs_.size();
+    top_contigs_.push_back(contig.ToString());
+    top_contig_counts_.push_back(0);
+  } else {
+    last_contig_index_ = free_contig_indices_.back();
+    free_contig_indices_.pop_back();
+    top_contigs_[last_contig_index_].assign(contig.data, contig.size);
+  }
+  return last_contig_index_;
+}
+
+/**
+ * Releases the contig of a top site that leaves the heap. The index of the
+ * contig is reused once no top site has the contig, unless it is the contig
+ * of the last top site, which is released when the next contig is added.
+ *
+ * @param  contig_index Index in top_contigs_.
+ */
+void SiteWriter::ReleaseTopContig(int contig_index) {
+  if (--top_contig_counts_[contig_index] == 0 &&
+      contig_index != last_contig_index_) {
+    free_contig_indices_.push_back(contig_index);
+  }
+}
+
+/**
+ * Writes the top sites in the order they were scored and stops keeping top
+ * sites.
+ */
+void SiteWriter::WriteTopSites() {
+  vector<TopSite> sites;
+  sites.swap(top_sites_);
+  sort(sites.begin(), sites.end(), IsEarlierTopSite);
+  top_count_ = 0;
+  for (const TopSite &site : sites) {
+    const string &contig = top_contigs_[site.contig_index];
+    SiteWriter::Write(StringView(contig.data(), contig.size()), site.position,
+                      site.ref_nucleotide, site.reads, site.probability,
+                      site.label);
+  }
+  vector<string>().swap(top_contigs_);
+  vector<int>().swap(top_contig_counts_);
+  vector<int>().swap(free_contig_indices_);
+  last_contig_index_ = -1;
+}
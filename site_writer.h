@@ -0,0 +1,145 @@
+/**
+ * @file site_writer.h
+ * @author Melissa Ip
+ *
+ * The SiteWriter class streams the scored sites of pileup_driver to the
+ * output file as they are scored, so memory does not grow with the number of
+ * sites. Lines are formatted into a buffer that is written with write() once
+ * it holds kWriteBufferSize bytes. Integers are formatted by hand, and
+ * probabilities are printed with the fewest significant digits that parse
+ * back to the same double, so no iostream is involved. The probabilities and
+ * labels formats keep the 6 significant digits of the ostream output of
+ * earlier versions.
+ *
+ * The output has one of these formats:
+ *
+ *   sites          Tab separated columns with a header line:
+ *                  #contig  position  reference  child  mother  father  probability
+ *                  where each individual is its counts of A, C, G and T,
+ *                  e.g. 1  10468  C  0,12,0,3  0,14,0,0  0,9,0,0  0.0523
+ *   vcf            VCF-like lines with the probability in the INFO field PM
+ *                  and the counts in the FORMAT field BC of each individual.
+ *                  ALT lists the observed nucleotides that are not the
+ *                  reference.
+ *   probabilities  One probability per line with 6 significant digits, as in
+ *                  earlier versions.
+ *   labels         The probability and the label of a simulated site per line,
+ *                  as written by simulation_driver.
+ *   binary         Columnar blocks with zone maps that result_query reads
+ *                  (see result_store.h).
+ *   histogram      Tab separated distinct trios of pileup_driver
+ *                  --distinct-trios with a header line:
+ *                  #child  mother  father  reference  probability  sites
+ *                  where reference is N unless the priors are conditioned on
+ *                  it. Lines are written with WriteDistinct().
+ *
+ * A SiteWriter that is created without a file name formats into memory, e.g.
+ * for one shard of the pileup files, and is appended to the output in file
+ * order with Append().
+ *
+ * KeepTop() keeps only the count sites with the highest probabilities in a
+ * bounded heap instead of writing every site, e.g. for triage of a genome, so
+ * memory does not grow with the number of sites that pass the threshold. The
+ * kept sites are written in the order they were scored when the writer is
+ * destroyed, and ties are broken in favor of the earlier site. Memory writers
+ * of shards keep their own heaps, which Append() merges, so the output does
+ * not depend on the number of shards. The contig of each kept site is shared
+ * by the kept sites of the contig, and is dropped with its last kept site, so
+ * memory does not grow with the number of contigs either. Once the heap is
+ * full, Threshold() returns its lowest probability, so the sites that cannot
+ * enter it are not passed to the writer. The sites are still scored, because
+ * the models have no cheaper bound that could reject a site before its
+ * probability is computed.
+ *
+ * A scan that is resumed from a checkpoint (see scan_checkpoint.h) opens the
+ * partial output with the size that was synced by Sync() before the
+ * checkpoint. The file is truncated to that size and no header is written,
+ * so the bytes after it are those of an uninterrupted scan.
+ *
+ * Example usage:
+ *
+ *   SiteWriter writer("output.txt", "sites");
+ *   writer.KeepTop(1000);  // Optional.
+ *   if (probability >= writer.Threshold(0.01)) {
+ *     writer.Write(site.contig, site.position, site.ref_nucleotide,
+ *                  site.data_vec.data(), probability);
+ *   }
+ */
+#ifndef SITE_WRITER_H
+#define SITE_WRITER_H
+
+#include <sys/types.h>
+#include <memory>
+
+#include "result_store.h"
+
+
+// Number of bytes that are buffered before they are written.
+const size_t kWriteBufferSize = 1 << 20;
+
+/**
+ * Site that is kept by SiteWriter::KeepTop() until it is written.
+ */
+struct TopSite {
+  double probability;
+  uint64_t order;  // Order in which the sites were scored.
+  int contig_index;  // Index in the contigs of the writer.
+  int position;
+  char ref_nucleotide;
+  int label;
+  ReadData reads[kIndividualCount];
+};
+
+/**
+ * SiteWriter class header. See top of file for a complete description.
+ */
+class SiteWriter {
+ public:
+  SiteWriter(const string &file_name, const string &format,
+             off_t resume_size=-1);  // Writes the header unless resumed.
+  SiteWriter(const string &format);  // Formats into memory.
+  ~SiteWriter();  // Flushes the buffer.
+  void Write(const StringView &contig, int position, char ref_nucleotide,
+             const ReadData *reads, double probability,
+             int label=-1);  // Child, mother and father reads.
+  void WriteDistinct(const ReadData *reads, char ref_nucleotide,
+                     double probability, uint64_t site_count);  // Histogram format.
+  void Append(SiteWriter &other);  // Moves the lines of a memory writer.
+  void KeepTop(size_t top_count);  // Writes only the top sites at the end.
+  double Threshold(double threshold) const;  // Raised to the lowest top site once the heap is full.
+  size_t top_count() const;  // 0 unless KeepTop() was called.
+  bool is_histogram() const;
+  uint64_t line_count() const;  // Sites and distinct trios that were written.
+  void Flush();
+  off_t Sync();  // Flushes and syncs the file, returns its size.
+
+ private:
+  SiteWriter(const SiteWriter &other);  // Not copyable.
+  SiteWriter& operator=(const SiteWriter &other);
+  void SetFormat(const string &format);
+  void WriteHeader();
+  void AppendInt(int value);
+  void AppendDouble(double value);
+  void AppendLegacyDouble(double value);
+  void AppendCounts(const ReadData &reads);
+  void PushTopSite(TopSite &site, const StringView &contig);
+  int AddTopContig(const StringView &contig);
+  void ReleaseTopContig(int contig_index);
+  void WriteTopSites();
+
+  // Instance member variables.
+  int fd_;  // -1 for a memory writer.
+  int format_;
+  string buffer_;
+  uint64_t line_count_;
+  unique_ptr<ResultStoreWriter> store_;  // Binary format only.
+  size_t top_count_;  // Number of top sites that are kept, 0 to write every site.
+  vector<TopSite> top_sites_;  // Heap with the lowest top site in front.
+  vector<string> top_contigs_;  // Contigs of top_sites_, reused once unused.
+  vector<int> top_contig_counts_;  // Number of top sites of each contig.
+  vector<int> free_contig_indices_;  // Contigs without top sites.
+  int last_contig_index_;  // Contig of the last top site, or -1.
+  uint64_t top_order_;  // Order of the next site.
+};
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file track_reader.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the TrackReader class.
+ *
+ * See top of track_reader.h for a complete description.
+ */
+#include "track_reader.h"
+
+
+/**
+ * Returns true if a line of a track file holds data, i.e. it is not empty and
+ * is not a comment line that starts with '#' or "track".
+ *
+ * @param  line Line of a track file.
+ * @return      True if the line holds data.
+ */
+bool IsTrackDataLine(const string &line) {
+  return !line.empty() && line[0] != '#' && line.compare(0, 5, "track") != 0;
+}
+
+/**
+ * Returns the contig of a data line of a track file, i.e. its first column.
+ *
+ * @param  line Data line of a track file.
+ * @return      Contig of the line.
+ */
+string TrackLineContig(const string &line) {
+  return line.substr(0, line.find_first_of(" \t"));
+}
+
+/**
+ * Constructor that opens the track file and reads the first line.
+ *
+ * @param  file_name Track file name.
+ */
+TrackReader::TrackReader(const string &file_name)
+    : fin_{file_name}, is_open_{false}, has_line_{false}, next_offset_{0},
+      scanned_offset_{0} {
+  is_open_ = fin_.is_open() && !fin_.fail();
+  if (is_open_) {
+    has_line_ = TrackReader::ReadLine();
+  }
+}
+
+bool TrackReader::is_open() const {
+  return is_open_;
+}
+
+/**
+ * Moves the track to the first line of a contig. Skips the rest of the
+ * previous contig and the lines of the contigs before the contig, including
+ * contigs that the pileup files do not have.
+ *
+ * @param  contig Contig that the queries move to.
+ * @return        False if the track does not have the contig.
+ */
+bool TrackReader::StartContig(const string &contig) {
+  if (!query_contig_.empty()) {
+    queried_contigs_.insert(query_contig_);
+  }
+  query_contig_ = contig;
+  if (passed_contigs_.count(contig) > 0) {
+    Die("Track file does not have its contigs in the same order as the pileup files.");
+  }
+
+  while (has_line_ && (queried_contigs_.count(line_contig_) > 0 ||
+                       skipped_contigs_.count(line_contig_) > 0)) {
+    has_line_ = TrackReader::ReadLine();
+  }
+  if (!has_line_ || line_contig_ == contig) {
+    return has_line_;
+  }
+
+  // The contig of the current line comes after the contig in the pileup files.
+  auto rank = contig_ranks_.find(contig);
+  auto line_rank = contig_ranks_.find(line_contig_);
+  if (rank != contig_ranks_.end() && line_rank != contig_ranks_.end() &&
+      line_rank->second > rank->second) {
+    return false;
+  }
+  int64_t offset = 0;
+  if (!TrackReader::FindContig(contig, offset)) {
+    return false;
+  }
+  TrackReader::Seek(offset);
+  return has_line_;
+}
+
+/**
+ * Reads the next line of the contig.
+ *
+ * @return  False at the end of the contig or the track.
+ */
+bool TrackReader::NextLine() {
+  has_line_ = TrackReader::ReadLine();
+  return has_line_ && line_contig_ == query_contig_;
+}
+
+const string& TrackReader::line() const {
+  return line_;
+}
+
+/**
+ * Skips the lines of a contig that comes before the first queried site, e.g.
+ * when a shard of the pileup files starts after the contig.
+ *
+ * @param  contig Contig that is not queried.
+ */
+void TrackReader::SkipContig(const string &contig) {
+  skipped_contigs_.insert(contig);
+}
+
+/**
+ * Sets the order of the contigs in the pileup files, so the track does not
+ * look ahead for a contig that comes before the contig of the current line.
+ *
+ * @param  contigs Contigs in pileup order.
+ */
+void TrackReader::SetContigOrder(const vector<string> &contigs) {
+  contig_ranks_.clear();
+  for (size_t i = 0; i < contigs.size(); ++i) {
+    contig_ranks_[contigs[i]] = i;
+  }
+}
+
+/**
+ * Reads the next data line. Dies if the line starts a contig that the track
+ * has moved past or that was queried before, i.e. the lines of a contig are
+ * not together or the contigs are not in pileup order.
+ *
+ * @return  False if there are no lines left.
+ */
+bool TrackReader::ReadLine() {
+  while (getline(fin_, line_)) {
+    next_offset_ += line_.size() + 1;
+    if (!IsTrackDataLine(line_)) {
+      continue;
+    }
+    string contig = TrackLineContig(line_);
+    if (contig != line_contig_) {
+      if (passed_contigs_.count(contig) > 0 ||
+          queried_contigs_.count(contig) > 0) {
+        Die("Track file does not have its contigs in the same order as the pileup files.");
+      }
+      if (!line_contig_.empty()) {
+        passed_contigs_.insert(line_contig_);
+      }
+      line_contig_ = contig;
+    }
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Looks ahead for the first line of a contig after the current line. The
+ * first lines of the contigs that are passed are remembered, so the lines
+ * after the current line are scanned at most once by all look aheads.
+ *
+ * @param  contig Contig that is looked for.
+ * @param  offset Set to the offset of the first line of the contig if found.
+ * @return        False if the track does not have the contig after the
+ *                current line.
+ */
+bool TrackReader::FindContig(const string &contig, int64_t &offset) {
+  auto it = contig_offsets_.find(contig);
+  if (it != contig_offsets_.end()) {
+    offset = it->second;
+    return true;
+  }
+
+  int64_t scan_offset = max(scanned_offset_, next_offset_);
+  fin_.clear();
+  fin_.seekg(scan_offset);
+  string line;
+  string last_contig;
+  bool is_found = false;
+  while (!is_found && getline(fin_, line)) {
+    const int64_t line_offset = scan_offset;
+    scan_offset += line.size() + 1;
+    if (!IsTrackDataLine(line)) {
+      continue;
+    }
+    string line_contig = TrackLineContig(line);
+    if (line_contig != last_contig) {
+      if (passed_contigs_.count(line_contig) > 0 ||
+          queried_contigs_.count(line_contig) > 0) {
+        Die("Track file does not have its contigs in the same order as the pileup files.");
+      }
+      contig_offsets_.insert({line_contig, line_offset});  // Keeps the first line.
+      last_contig = line_contig;
+    }
+    is_found = line_contig == contig;
+  }
+  scanned_offset_ = scan_offset;
+  fin_.clear();
+  fin_.seekg(next_offset_);  // Returns to the line after the current line.
+
+  if (is_found) {
+    offset = contig_offsets_[contig];
+  }
+  return is_found;
+}
+
+/**
+ * Moves the track to a line that the look ahead found. The contigs of the
+ * lines that are skipped are passed.
+ *
+ * @param  offset Offset of the line.
+ */
+void TrackReader::Seek(int64_t offset) {
+  passed_contigs_.insert(line_contig_);
+  for (const auto &contig_offset : contig_offsets_) {
+    if (contig_offset.second < offset) {
+      passed_contigs_.insert(contig_offset.first);
+    }
+  }
+  fin_.clear();
+  fin_.seekg(offset);
+  next_offset_ = offset;
+  line_contig_.clear();
+  has_line_ = TrackReader::ReadLine();
+}
@@ -0,0 +1,74 @@
+/**
+ * @file track_reader.h
+ * @author Melissa Ip
+ *
+ * The TrackReader class streams the lines of a track file, e.g. the rate track
+ * (see rate_track.h) or the frequency file (see frequency_track.h), contig by
+ * contig alongside the pileup files. The first column of each line is the
+ * contig. Empty lines and comment lines that start with '#' or "track" are
+ * skipped.
+ *
+ * The track does not need to have the same contigs as the pileup files. When
+ * the queries move to a contig, the lines of the contigs before it are
+ * skipped, including contigs that the pileup files do not have. Whether a
+ * contig of the track comes before the queried contig is decided by the contig
+ * order of the pileup files if it is known, or else by looking ahead in the
+ * track for the queried contig. The first line of every contig that the look
+ * ahead passes is remembered, so the track is read at most twice. The contigs
+ * that both have must appear in the same order in the track and the pileup
+ * files.
+ *
+ * Example usage:
+ *
+ *   TrackReader track("rates.bed");
+ *   if (track.StartContig("1")) {
+ *     do {
+ *       ParseLine(track.line());
+ *     } while (track.NextLine());  // False at the end of the contig.
+ *   }
+ */
+#ifndef TRACK_READER_H
+#define TRACK_READER_H
+
+#include <fstream>
+#include <set>
+#include <unordered_map>
+
+#include "utility.h"
+
+
+/**
+ * TrackReader class header. See top of file for a complete description.
+ */
+class TrackReader {
+ public:
+  TrackReader(const string &file_name);
+  bool is_open() const;
+  bool StartContig(const string &contig);  // False if the track does not have the contig.
+  bool NextLine();  // False at the end of the contig.
+  const string& line() const;  // Current line.
+  void SkipContig(const string &contig);  // Contig before the first query.
+  void SetContigOrder(const vector<string> &contigs);  // Contigs in pileup order.
+
+ private:
+  bool ReadLine();
+  bool FindContig(const string &contig, int64_t &offset);
+  void Seek(int64_t offset);
+
+  // Instance member variables.
+  ifstream fin_;
+  bool is_open_;
+  bool has_line_;  // False once the track is exhausted.
+  string line_;
+  string line_contig_;  // Contig of the current line.
+  int64_t next_offset_;  // Offset of the line after the current line.
+  string query_contig_;  // Contig of the last query.
+  set<string> queried_contigs_;  // Contigs of the queries before the last query.
+  set<string> skipped_contigs_;  // Contigs before the first query.
+  set<string> passed_contigs_;  // Contigs of the lines that the track has moved past.
+  unordered_map<string, int64_t> contig_offsets_;  // First line of each contig that the look ahead passed.
+  int64_t scanned_offset_;  // Offset where the look ahead stopped.
+  unordered_map<string, int> contig_ranks_;  // Contigs of the pileup files, if known.
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file trio_convert.cc
+ * @author Melissa Ip
+ *
+ * This file merges the child, mother and father pileup or SAM files, or reads
+ * them from one multi-sample pileup, once and
+ * writes their sites to a compact binary trio count file (see trio_counts.h),
+ * which pileup_driver --trio-counts scores with any parameters without parsing
+ * the files again. The number of sites and records is printed to stdout.
+ *
+ * To compile on Herschel:
+ * c++ -std=c++11 -pthread -L/usr/local/lib -I/usr/local/include -o trio_convert utility.cc read_dependent_data.cc likelihood.cc trio_model.cc pileup_parser.cc gzip_reader.cc uring_reader.cc line_reader.cc pileup_shard.cc pileup_index.cc pileup_merger.cc multi_pileup.cc sam_pileup.cc trio_counts.cc trio_convert.cc -lz
+ *
+ * To run this file, provide the following command line inputs:
+ * ./trio_convert <output>.trio <child>.pileup <mother>.pileup <father>.pileup [options]
+ * ./trio_convert <output>.trio <mpileup|-> --mpileup [--samples <c>,<m>,<f>]
+ *
+ * Options:
+ *   --inflate-threads <n>
+ *                  Inflates the blocks of BGZF compressed files with n
+ *                  threads for each file (see gzip_reader.h).
+ *   --io-backend <mmap|pread|io_uring>
+ *                  Selects the backend that reads regular files that are not
+ *                  compressed (see line_reader.h).
+ *   --sam          Counts the bases of coordinate-sorted SAM files instead of
+ *                  reading pileup files (see sam_pileup.h).
+ *   --min-mapping-quality <q>
+ *   --min-base-quality <q>
+ *                  Skips SAM alignments below mapping quality q and does not
+ *                  count SAM bases below base quality q.
+ *   --mpileup      Reads one multi-sample pileup, which may be standard input
+ *                  (-) or a FIFO (see multi_pileup.h).
+ *   --samples <child>,<mother>,<father>
+ *                  Indices of the samples of the trio in the multi-sample
+ *                  pileup, starting at 0. Defaults to 0,1,2.
+ */
+#include "multi_pileup.h"
+#include "trio_counts.h"
+#include "sam_pileup.h"
+
+
+/**
+ * Writes every site of a merger to a trio count file.
+ *
+ * @param  merger PileupMerger, SamMerger or MultiPileupReader object.
+ * @param  writer Trio count writer.
+ */
+template <typename Merger>
+void ConvertSites(Merger &merger, TrioCountWriter &writer) {
+  TrioSite site;
+  while (merger.NextSite(site)) {
+    writer.Write(site);
+  }
+}
+
+/**
+ * Parses the comma separated sample indices of the child, mother and father.
+ *
+ * @param  arg Command line argument such as 2,0,1.
+ * @return     Sample indices in order of child, mother and father.
+ */
+vector<int> ParseSamples(const string &arg) {
+  vector<int> samples;
+  stringstream str(arg);
+  string sample;
+  while (getline(str, sample, ',')) {
+    samples.push_back(stoi(sample));
+  }
+  if (samples.size() != kIndividualCount) {
+    Die("Expected one sample for each of child, mother and father.");
+  }
+  return samples;
+}
+
+int main(int argc, const char *argv[]) {
+  const bool is_mpileup = find(argv + 1, argv + argc,
+                               string("--mpileup")) != argv + argc;
+  const int input_count = is_mpileup ? 1 : kIndividualCount;
+  if (argc < 2 + input_count) {
+    Die("USAGE: trio_convert <output>.trio <child>.pileup <mother>.pileup "
+        "<father>.pileup [--inflate-threads <n>] "
+        "[--io-backend <mmap|pread|io_uring>] [--sam] "
+        "[--min-mapping-quality <q>] [--min-base-quality <q>]\n"
+        "       trio_convert <output>.trio <mpileup|-> --mpileup "
+        "[--samples <c>,<m>,<f>] [--inflate-threads <n>]");
+  }
+
+  const string file_name = argv[1];
+  ReadOptions read_options;
+  bool is_sam = false;
+  int min_mapping_quality = 0;
+  int min_base_quality = 0;
+  vector<int> samples = {0, 1, 2};
+  for (int i = 2 + input_count; i < argc; ++i) {
+    const string flag = argv[i];
+    if (flag == "--inflate-threads" && i + 1 < argc) {
+      read_options.inflate_threads = stoi(argv[++i]);
+    } else if (flag == "--io-backend" && i + 1 < argc) {
+      read_options.backend = ReadBackend(argv[++i]);
+    } else if (flag == "--sam") {
+      is_sam = true;
+    } else if (flag == "--min-mapping-quality" && i + 1 < argc) {
+      min_mapping_quality = stoi(argv[++i]);
+    } else if (flag == "--min-base-quality" && i + 1 < argc) {
+      min_base_quality = stoi(argv[++i]);
+    } else if (flag == "--mpileup") {
+      continue;
+    } else if (flag == "--samples" && i + 1 < argc) {
+      samples = ParseSamples(argv[++i]);
+    } else {
+      Die("Unknown option.");
+    }
+  }
+
+  if (is_mpileup) {
+    if (is_sam) {
+      Die("A multi-sample pileup is read without --sam.");
+    }
+    LineReader reader(argv[2], read_options);
+    if (!reader.is_open()) {
+      Die("Input file cannot be read.");
+    }
+    TrioCountWriter writer(file_name);
+    MultiPileupReader pileup(reader, samples);
+    ConvertSites(pileup, writer);
+    writer.Close();
+    cout << writer.site_count() << " sites in " << writer.record_count()
+         << " records." << endl;
+    return 0;
+  }
+
+  LineReader child(argv[2], read_options);
+  LineReader mother(argv[3], read_options);
+  LineReader father(argv[4], read_options);
+  if (!child.is_open() || !mother.is_open() || !father.is_open()) {
+    Die("Input file cannot be read.");
+  }
+  TrioCountWriter writer(file_name);
+  if (is_sam) {
+    SamPileup child_sam(child, min_mapping_quality, min_base_quality);
+    SamPileup mother_sam(mother, min_mapping_quality, min_base_quality);
+    SamPileup father_sam(father, min_mapping_quality, min_base_quality);
+    SamMerger merger(child_sam, mother_sam, father_sam);
+    ConvertSites(merger, writer);
+  } else {
+    PileupMerger merger(child, mother, father);
+    vector<string> contigs;
+    PileupContigOrder({argv[2], argv[3], argv[4]}, contigs);
+    merger.SetContigOrder(contigs);
+    ConvertSites(merger, writer);
+  }
+  writer.Close();
+  cout << writer.site_count() << " sites in " << writer.record_count()
+       << " records." << endl;
+
+  return 0;
+}
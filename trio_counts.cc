@@ -0,0 +1,286 @@
+/**
+ * @file trio_counts.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the TrioCountWriter and
+ * TrioCountReader classes.
+ *
+ * See top of trio_counts.h for a complete description.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trio_counts.h"
+
+// Number of bytes that are buffered before they are written.
+const size_t kTrioCountBufferSize = 1 << 20;
+
+
+/**
+ * Constructor that opens the output file and writes kTrioCountMagic.
+ *
+ * @param  file_name Output file name.
+ */
+TrioCountWriter::TrioCountWriter(const string &file_name)
+    : fd_{-1}, site_count_{0}, record_count_{0}, offset_{0} {
+  fd_ = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ == -1) {
+    Die("Output file cannot be written.");
+  }
+  memset(&record_, 0, sizeof(record_));
+  buffer_.reserve(kTrioCountBufferSize + sizeof(TrioCountRecord));
+  buffer_.append(kTrioCountMagic, kTrioCountMagicSize);
+}
+
+/**
+ * Destructor that writes the footer if the file is not closed yet.
+ */
+TrioCountWriter::~TrioCountWriter() {
+  if (fd_ != -1) {
+    TrioCountWriter::Close();
+  }
+}
+
+/**
+ * Adds a site to the current run if it is the next position of the run with
+ * the same reference nucleotide and reads. Otherwise the run is finished and
+ * the site starts a new run.
+ *
+ * @param  site Merged site of the trio.
+ */
+void TrioCountWriter::Write(const TrioSite &site) {
+  site_count_++;
+  if (record_.run_length > 0 &&
+      site.position == record_.position +
+                       static_cast<int>(record_.run_length) &&
+      site.ref_nucleotide == record_.ref_nucleotide &&
+      site.data_vec[0].key == record_.keys[0] &&
+      site.data_vec[1].key == record_.keys[1] &&
+      site.data_vec[2].key == record_.keys[2]) {
+    const string &contig = contigs_[record_.contig_index];
+    if (site.contig.Equals(StringView(contig.data(), contig.size()))) {
+      record_.run_length++;
+      return;
+    }
+  }
+
+  TrioCountWriter::FinishRecord();
+  if (contigs_.empty() ||
+      !site.contig.Equals(StringView(contigs_.back().data(),
+                                     contigs_.back().size()))) {
+    contigs_.push_back(site.contig.ToString());
+  }
+  record_.contig_index = contigs_.size() - 1;
+  record_.position = site.position;
+  record_.ref_nucleotide = site.ref_nucleotide;
+  record_.run_length = 1;
+  for (int i = 0; i < kIndividualCount; ++i) {
+    record_.keys[i] = site.data_vec[i].key;
+  }
+}
+
+/**
+ * Finishes the current run and writes the footer, i.e. the contig names, the
+ * offset of the footer and kTrioCountMagic, and closes the file.
+ */
+void TrioCountWriter::Close() {
+  TrioCountWriter::FinishRecord();
+  const int64_t footer_offset = offset_ + buffer_.size();
+  const uint32_t contig_count = contigs_.size();
+  buffer_.append(reinterpret_cast<const char*>(&contig_count),
+                 sizeof(contig_count));
+  for (const string &contig : contigs_) {
+    const uint32_t size = contig.size();
+    buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    buffer_ += contig;
+  }
+  buffer_.append(reinterpret_cast<const char*>(&footer_offset),
+                 sizeof(footer_offset));
+  buffer_.append(kTrioCountMagic, kTrioCountMagicSize);
+  TrioCountWriter::WriteBuffer();
+  if (close(fd_) == -1) {
+    Die("Output file cannot be written.");
+  }
+  fd_ = -1;
+}
+
+uint64_t TrioCountWriter::site_count() const {
+  return site_count_;
+}
+
+uint64_t TrioCountWriter::record_count() const {
+  return record_count_;
+}
+
+/**
+ * Moves the current run to the buffer, which is written once it holds
+ * kTrioCountBufferSize bytes.
+ */
+void TrioCountWriter::FinishRecord() {
+  if (record_.run_length == 0) {
+    return;
+  }
+  buffer_.append(reinterpret_cast<const char*>(&record_), sizeof(record_));
+  record_count_++;
+  record_.run_length = 0;
+  if (buffer_.size() >= kTrioCountBufferSize) {
+    TrioCountWriter::WriteBuffer();
+  }
+}
+
+/**
+ * Writes the buffer to the output file.
+ */
+void TrioCountWriter::WriteBuffer() {
+  ssize_t written = 0;
+  for (size_t offset = 0; offset < buffer_.size(); offset += written) {
+    written = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+    if (written == -1 && errno == EINTR) {
+      written = 0;
+    } else if (written == -1) {
+      Die("Output file cannot be written.");
+    }
+  }
+  offset_ += buffer_.size();
+  buffer_.clear();
+}
+
+/**
+ * Constructor that maps a trio count file into memory and reads its footer.
+ * The reader returns every record until SetRange() is called.
+ *
+ * @param  file_name Trio count file name.
+ */
+TrioCountReader::TrioCountReader(const string &file_name)
+    : fd_{-1}, map_{nullptr}, map_size_{0}, records_{nullptr},
+      record_count_{0}, next_record_{0}, end_record_{0}, run_offset_{0},
+      contig_index_{-1} {
+  fd_ = open(file_name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd_ == -1 || fstat(fd_, &file_stat) == -1) {
+    Die("Trio count file cannot be read.");
+  }
+  map_size_ = file_stat.st_size;
+  const size_t trailer_size = sizeof(int64_t) + kTrioCountMagicSize;
+  if (map_size_ < kTrioCountMagicSize + trailer_size) {
+    Die("Input file is not a trio count file.");
+  }
+  void *map = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (map == MAP_FAILED) {
+    Die("Trio count file cannot be mapped.");
+  }
+  map_ = static_cast<const char*>(map);
+  madvise(map, map_size_, MADV_SEQUENTIAL);
+
+  int64_t footer_offset = 0;
+  memcpy(&footer_offset, map_ + map_size_ - trailer_size,
+         sizeof(footer_offset));
+  if (memcmp(map_, kTrioCountMagic, kTrioCountMagicSize) != 0 ||
+      memcmp(map_ + map_size_ - kTrioCountMagicSize, kTrioCountMagic,
+             kTrioCountMagicSize) != 0 ||
+      footer_offset < static_cast<int64_t>(kTrioCountMagicSize) ||
+      static_cast<size_t>(footer_offset) > map_size_ - trailer_size ||
+      (footer_offset - kTrioCountMagicSize) % sizeof(TrioCountRecord) != 0) {
+    Die("Input file is not a trio count file.");
+  }
+  records_ = reinterpret_cast<const TrioCountRecord*>(
+    map_ + kTrioCountMagicSize
+  );
+  record_count_ = (footer_offset - kTrioCountMagicSize) /
+                  sizeof(TrioCountRecord);
+  end_record_ = record_count_;
+
+  const char *footer = map_ + footer_offset;
+  const char *footer_end = map_ + map_size_ - trailer_size;
+  uint32_t contig_count = 0;
+  if (footer + sizeof(contig_count) > footer_end) {
+    Die("Trio count footer is truncated.");
+  }
+  memcpy(&contig_count, footer, sizeof(contig_count));
+  footer += sizeof(contig_count);
+  for (uint32_t i = 0; i < contig_count; ++i) {
+    uint32_t size = 0;
+    if (footer + sizeof(size) > footer_end) {
+      Die("Trio count footer is truncated.");
+    }
+    memcpy(&size, footer, sizeof(size));
+    footer += sizeof(size);
+    if (footer + size > footer_end) {
+      Die("Trio count footer is truncated.");
+    }
+    contigs_.emplace_back(footer, size);
+    footer += size;
+  }
+}
+
+/**
+ * Destructor that unmaps and closes the file.
+ */
+TrioCountReader::~TrioCountReader() {
+  if (map_ != nullptr) {
+    munmap(const_cast<char*>(map_), map_size_);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+}
+
+/**
+ * Restricts the reader to a range of records, e.g. a shard.
+ *
+ * @param  first_record Index of the first record.
+ * @param  last_record  Index after the last record.
+ */
+void TrioCountReader::SetRange(size_t first_record, size_t last_record) {
+  next_record_ = min(first_record, record_count_);
+  end_record_ = min(last_record, record_count_);
+  run_offset_ = 0;
+}
+
+/**
+ * Returns the next site of the runs of the records.
+ *
+ * @param  site Site that is read. Its contig is valid as long as the reader.
+ * @return      False once the range is exhausted.
+ */
+bool TrioCountReader::NextSite(TrioSite &site) {
+  if (next_record_ >= end_record_) {
+    return false;
+  }
+  const TrioCountRecord &record = records_[next_record_];
+  if (record.contig_index >= contigs_.size()) {
+    Die("Trio count record has an unknown contig.");
+  }
+  contig_index_ = record.contig_index;
+  site.contig = StringView(contigs_[contig_index_].data(),
+                           contigs_[contig_index_].size());
+  site.position = record.position + run_offset_;
+  site.ref_nucleotide = record.ref_nucleotide;
+  site.data_vec.resize(kIndividualCount);
+  for (int i = 0; i < kIndividualCount; ++i) {
+    site.data_vec[i].key = record.keys[i];
+  }
+  if (++run_offset_ >= record.run_length) {
+    next_record_++;
+    run_offset_ = 0;
+  }
+  return true;
+}
+
+const string& TrioCountReader::contig() const {
+  return contigs_[contig_index_];
+}
+
+size_t TrioCountReader::record_count() const {
+  return record_count_;
+}
+
+const vector<string>& TrioCountReader::contigs() const {
+  return contigs_;
+}
+
+int TrioCountReader::contig_index(size_t record) const {
+  return records_[record].contig_index;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file trio_counts.h
+ * @author Melissa Ip
+ *
+ * The TrioCountWriter class writes the merged sites of the child, mother and
+ * father pileup or SAM files to a compact binary file, and the TrioCountReader
+ * class maps the file into memory and returns its sites as TrioSite objects,
+ * so pileup_driver can rescore a genome with new parameters without parsing
+ * the pileups again (see trio_convert.cc).
+ *
+ * The file holds fixed-width TrioCountRecord records of 40 bytes, each the
+ * contig index, first position, reference nucleotide and the ReadData::key of
+ * each individual of a run of sites. Consecutive sites of a contig with the
+ * same reference nucleotide and reads are run-length encoded in one record,
+ * e.g. the many sites of equal coverage:
+ *
+ *   1  100  A  {0,12,0,0} {0,14,0,0} {0,9,0,0}
+ *   1  101  A  {0,12,0,0} {0,14,0,0} {0,9,0,0}  ->  1  100  A  run 2  keys
+ *
+ * The file starts with kTrioCountMagic and ends with a footer of the contig
+ * names, followed by the offset of the footer and kTrioCountMagic again.
+ * Numbers are in the byte order of the machine that writes the file.
+ *
+ * SetRange() restricts a reader to a range of records, so the records can be
+ * split into shards that are scored in parallel. Contig indices follow the
+ * order in which the contigs first appear, so the contigs before a shard are
+ * those with a smaller index than its first record.
+ *
+ * Example usage:
+ *
+ *   TrioCountWriter writer("trio.counts");
+ *   while (merger.NextSite(site)) {
+ *     writer.Write(site);
+ *   }
+ *   writer.Close();
+ *
+ *   TrioCountReader reader("trio.counts");
+ *   while (reader.NextSite(site)) {
+ *     double probability = params.MutationProbability(site.data_vec);
+ *   }
+ */
+#ifndef TRIO_COUNTS_H
+#define TRIO_COUNTS_H
+
+#include "pileup_merger.h"
+
+
+// Identifies trio count files, at the start and at the end of the file.
+const char kTrioCountMagic[] = "NMTRIO01";
+const size_t kTrioCountMagicSize = 8;
+
+/**
+ * Run of sites with the same reference nucleotide and reads.
+ */
+struct TrioCountRecord {
+  uint64_t keys[kIndividualCount];  // ReadData::key of child, mother and father.
+  int32_t position;  // 1-based position of the first site of the run.
+  uint32_t run_length;  // Number of consecutive positions.
+  uint32_t contig_index;  // Index of the contig in the footer.
+  char ref_nucleotide;
+  char padding[3];
+};
+
+/**
+ * TrioCountWriter class header. See top of file for a complete description.
+ */
+class TrioCountWriter {
+ public:
+  TrioCountWriter(const string &file_name);
+  ~TrioCountWriter();  // Closes the file.
+  void Write(const TrioSite &site);
+  void Close();  // Writes the footer.
+  uint64_t site_count() const;  // Get functions.
+  uint64_t record_count() const;
+
+ private:
+  TrioCountWriter(const TrioCountWriter &other);  // Not copyable.
+  TrioCountWriter& operator=(const TrioCountWriter &other);
+  void FinishRecord();
+  void WriteBuffer();
+
+  // Instance member variables.
+  int fd_;
+  string buffer_;
+  vector<string> contigs_;
+  TrioCountRecord record_;  // Current run.
+  uint64_t site_count_;
+  uint64_t record_count_;
+  int64_t offset_;  // Offset of the start of buffer_ in the file.
+};
+
+/**
+ * TrioCountReader class header. See top of file for a complete description.
+ */
+class TrioCountReader {
+ public:
+  TrioCountReader(const string &file_name);
+  ~TrioCountReader();  // Unmaps the file.
+  void SetRange(size_t first_record, size_t last_record);  // [first, last).
+  bool NextSite(TrioSite &site);  // False once the range is exhausted.
+  const string& contig() const;  // Contig of the last site.
+  size_t record_count() const;
+  const vector<string>& contigs() const;
+  int contig_index(size_t record) const;
+
+ private:
+  TrioCountReader(const TrioCountReader &other);  // Not copyable.
+  TrioCountReader& operator=(const TrioCountReader &other);
+
+  // Instance member variables.
+  int fd_;
+  const char *map_;
+  size_t map_size_;
+  const TrioCountRecord *records_;
+  size_t record_count_;
+  size_t next_record_;
+  size_t end_record_;
+  uint32_t run_offset_;  // Sites of the next record that were returned.
+  vector<string> contigs_;
+  int contig_index_;  // Contig of the last site.
+};
+
+#endif
@@ -2,7 +2,9 @@
  * @file trio_model.cc
  * @author Melissa Ip
  *
- * This file contains the implementation of the TrioModel class.
+ * This file contains the implementation of the GenericTrioModel class template.
+ * The template is explicitly instantiated for every scalar type and Likelihood
+ * policy at the bottom of this file.
  *
  * See top of trio_model.h for a complete description.
  */
@@ -16,22 +18,27 @@
  * or dirichlet_dispersion_ is changed when MutationProbability() or
  * SetReadDependentData() is called.
  */
-TrioModel::TrioModel()
+template <typename T, template <typename> class Likelihood>
+GenericTrioModel<T, Likelihood>::GenericTrioModel()
     : population_mutation_rate_{0.001},
       germline_mutation_rate_{2e-8},
       somatic_mutation_rate_{2e-8},
       sequencing_error_rate_{0.005},
       dirichlet_dispersion_{1000.0},
-      nucleotide_frequencies_{0.25, 0.25, 0.25, 0.25} {
-  population_priors_ = TrioModel::PopulationPriors();
-  population_priors_single_ = TrioModel::PopulationPriorsSingle();
-  TrioModel::SetGermlineMutationProbabilities();
-  germline_probability_mat_single_ = TrioModel::GermlineProbabilityMatSingle();
-  germline_probability_mat_ = TrioModel::GermlineProbabilityMat();
-  germline_probability_mat_num_ = TrioModel::GermlineProbabilityMat(true);
-  somatic_probability_mat_ = TrioModel::SomaticProbabilityMat();
-  somatic_probability_mat_diag_ = TrioModel::SomaticProbabilityMatDiag();
-  alphas_ = TrioModel::Alphas();
+      nucleotide_frequencies_{0.25, 0.25, 0.25, 0.25},
+      reference_weight_{1.0},
+      reference_idx_{-1},
+      has_site_priors_{false},
+      frequency_cache_{kFrequencyCacheCapacity},
+      germline_cache_{kGermlineCacheCapacity} {
+  GenericTrioModel::SetPopulationPriors();
+  GenericTrioModel::SetGermlineMutationProbabilities();
+  germline_probability_mat_single_ = GenericTrioModel::GermlineProbabilityMatSingle();
+  germline_probability_mat_ = GenericTrioModel::GermlineProbabilityMat();
+  germline_probability_mat_num_ = GenericTrioModel::GermlineProbabilityMat(true);
+  somatic_probability_mat_ = GenericTrioModel::SomaticProbabilityMat();
+  somatic_probability_mat_diag_ = GenericTrioModel::SomaticProbabilityMatDiag();
+  GenericTrioModel::SetAlphas();
 }
 
 /**
@@ -47,27 +54,32 @@ TrioModel::TrioModel()
  *                                  distribution of mutated nucleotides in the
  *                                  population priors.
  */
-TrioModel::TrioModel(double population_mutation_rate,
-                     double germline_mutation_rate,
-                     double somatic_mutation_rate,
-                     double sequencing_error_rate,
-                     double dirichlet_dispersion,
-                     const RowVector4d &nucleotide_frequencies)
+template <typename T, template <typename> class Likelihood>
+GenericTrioModel<T, Likelihood>::GenericTrioModel(T population_mutation_rate,
+                                                  T germline_mutation_rate,
+                                                  T somatic_mutation_rate,
+                                                  T sequencing_error_rate,
+                                                  T dirichlet_dispersion,
+                                                  const RowVector4T<T> &nucleotide_frequencies)
     : population_mutation_rate_{population_mutation_rate},
       germline_mutation_rate_{germline_mutation_rate},
       somatic_mutation_rate_{somatic_mutation_rate},
       sequencing_error_rate_{sequencing_error_rate},
       dirichlet_dispersion_{dirichlet_dispersion},
-      nucleotide_frequencies_{nucleotide_frequencies} {
-  population_priors_ = TrioModel::PopulationPriors();
-  population_priors_single_ = TrioModel::PopulationPriorsSingle();
-  TrioModel::SetGermlineMutationProbabilities();
-  germline_probability_mat_single_ = TrioModel::GermlineProbabilityMatSingle();
-  germline_probability_mat_ = TrioModel::GermlineProbabilityMat();
-  germline_probability_mat_num_ = TrioModel::GermlineProbabilityMat(true);
-  somatic_probability_mat_ = TrioModel::SomaticProbabilityMat();
-  somatic_probability_mat_diag_ = TrioModel::SomaticProbabilityMatDiag();
-  alphas_ = TrioModel::Alphas();
+      nucleotide_frequencies_{nucleotide_frequencies},
+      reference_weight_{1.0},
+      reference_idx_{-1},
+      has_site_priors_{false},
+      frequency_cache_{kFrequencyCacheCapacity},
+      germline_cache_{kGermlineCacheCapacity} {
+  GenericTrioModel::SetPopulationPriors();
+  GenericTrioModel::SetGermlineMutationProbabilities();
+  germline_probability_mat_single_ = GenericTrioModel::GermlineProbabilityMatSingle();
+  germline_probability_mat_ = GenericTrioModel::GermlineProbabilityMat();
+  germline_probability_mat_num_ = GenericTrioModel::GermlineProbabilityMat(true);
+  somatic_probability_mat_ = GenericTrioModel::SomaticProbabilityMat();
+  somatic_probability_mat_diag_ = GenericTrioModel::SomaticProbabilityMatDiag();
+  GenericTrioModel::SetAlphas();
 }
 
 /**
@@ -105,8 +117,30 @@ TrioModel::TrioModel(double population_mutation_rate,
  * @param   data_vec Read counts in order of child, mother and father.
  * @return           Probability of mutation given read data and parameters.
  */
-double TrioModel::MutationProbability(const ReadDataVector &data_vec) {
-  TrioModel::SetReadDependentData(data_vec);
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::MutationProbability(const ReadDataVector &data_vec) {
+  GenericTrioModel::SetReadDependentData(data_vec);
+
+  return 1 - (read_dependent_data_.numerator.sum /
+              read_dependent_data_.denominator.sum);
+}
+
+/**
+ * Implements the trio model for a single site with a site-specific germline
+ * mutation rate instead of germline_mutation_rate_. The germline transition
+ * matrices are taken from SiteGermlineOperators(), so the other parameters
+ * and matrices are not changed.
+ *
+ * @param   data_vec               Read counts in order of child, mother and
+ *                                 father.
+ * @param   germline_mutation_rate Germline mutation rate of this site.
+ * @return                         Probability of mutation given read data and
+ *                                 parameters.
+ */
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::MutationProbability(const ReadDataVector &data_vec,
+                                                       T germline_mutation_rate) {
+  GenericTrioModel::SetReadDependentData(data_vec, germline_mutation_rate);
 
   return 1 - (read_dependent_data_.numerator.sum /
               read_dependent_data_.denominator.sum);
@@ -121,14 +155,127 @@ double TrioModel::MutationProbability(const ReadDataVector &data_vec) {
  *
  * @param   data_vec Read counts in order of child, mother and father.
  */
-void TrioModel::SetReadDependentData(const ReadDataVector &data_vec) {
-  read_dependent_data_ = ReadDependentData(data_vec);  // First intialized.
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetReadDependentData(const ReadDataVector &data_vec) {
+  read_dependent_data_ = GenericReadDependentData<T>(data_vec);  // First intialized.
 
-  TrioModel::SequencingProbabilityMat();
-  TrioModel::SomaticTransition();
-  TrioModel::GermlineTransition();
-  TrioModel::SomaticTransition(true);
-  TrioModel::GermlineTransition(true);
+  GenericTrioModel::Peel(germline_probability_mat_, germline_probability_mat_num_);
+}
+
+/**
+ * Initializes and updates read_dependent_data_ like SetReadDependentData()
+ * with the germline transition matrices of a site-specific germline mutation
+ * rate.
+ *
+ * @param   data_vec               Read counts in order of child, mother and
+ *                                 father.
+ * @param   germline_mutation_rate Germline mutation rate of this site.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetReadDependentData(const ReadDataVector &data_vec,
+                                                           T germline_mutation_rate) {
+  read_dependent_data_ = GenericReadDependentData<T>(data_vec);  // First intialized.
+
+  if (germline_mutation_rate == germline_mutation_rate_) {
+    GenericTrioModel::Peel(germline_probability_mat_, germline_probability_mat_num_);
+  } else {
+    const GermlineOperators<Matrix16_256T<T>> &operators = (
+      GenericTrioModel::SiteGermlineOperators(germline_mutation_rate)
+    );
+    GenericTrioModel::Peel(operators.germline_probability_mat,
+                           operators.germline_probability_mat_num);
+  }
+}
+
+/**
+ * Returns the germline transition matrices of a site-specific germline
+ * mutation rate. The rate is quantized with QuantizeRate() and the matrices of
+ * the quantized rate are built on the first request and kept in germline_cache_
+ * for later sites. The least recently used rate is evicted once
+ * kGermlineCacheCapacity rates are cached.
+ *
+ * The reference is valid until the next call with a rate that is not cached.
+ *
+ * @param  rate Germline mutation rate of a site.
+ * @return      Germline transition matrices of the quantized rate.
+ */
+template <typename T, template <typename> class Likelihood>
+const GermlineOperators<Matrix16_256T<T>>& GenericTrioModel<T, Likelihood>::SiteGermlineOperators(T rate) {
+  long key = QuantizeRate(rate);
+  GermlineOperators<Matrix16_256T<T>> *cached = germline_cache_.Find(key);
+  if (cached != nullptr) {
+    return *cached;
+  }
+
+  // Builds the matrices at the quantized rate and restores the global rate.
+  T global_rate = germline_mutation_rate_;
+  germline_mutation_rate_ = QuantizedRate(key);
+  GenericTrioModel::SetGermlineMutationProbabilities();
+  GermlineOperators<Matrix16_256T<T>> operators;
+  operators.germline_probability_mat = GenericTrioModel::GermlineProbabilityMat();
+  operators.germline_probability_mat_num = GenericTrioModel::GermlineProbabilityMat(true);
+  germline_mutation_rate_ = global_rate;
+  GenericTrioModel::SetGermlineMutationProbabilities();
+
+  return germline_cache_.Insert(key, operators);
+}
+
+/**
+ * Peels the tree from the sequencing probabilities to the root for both the
+ * denominator and the numerator. Assume read_dependent_data_ is initialized.
+ * Float models flush subnormal numbers to zero (see FlushSubnormals).
+ *
+ * @param  germline_probability_mat     Germline transition matrix of the
+ *                                      denominator.
+ * @param  germline_probability_mat_num Germline transition matrix of the
+ *                                      numerator.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::Peel(const Matrix16_256T<T> &germline_probability_mat,
+                                           const Matrix16_256T<T> &germline_probability_mat_num) {
+  FlushSubnormals flush(is_same<T, float>::value);
+  GenericTrioModel::SequencingProbabilityMat();
+  GenericTrioModel::SomaticTransition();
+  GenericTrioModel::GermlineTransition(germline_probability_mat);
+  GenericTrioModel::SomaticTransition(true);
+  GenericTrioModel::GermlineTransition(germline_probability_mat_num, true);
+}
+
+/**
+ * Sets population_priors_, population_priors_single_ and the population
+ * priors of every reference nucleotide. Drops the cached priors of site
+ * frequencies, which depend on the population mutation rate.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetPopulationPriors() {
+  population_priors_ = GenericTrioModel::PopulationPriors(nucleotide_frequencies_);
+  population_priors_single_ = GenericTrioModel::PopulationPriorsSingle();
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    reference_population_priors_[i] = GenericTrioModel::PopulationPriors(
+      nucleotide_frequencies_,
+      i
+    );
+  }
+  frequency_cache_.Clear();
+  has_site_priors_ = false;
+}
+
+/**
+ * Returns the population priors of the current site. These are the priors of
+ * the frequencies selected by SetSiteFrequencies() or otherwise conditioned on
+ * the reference nucleotide selected by SetReference().
+ *
+ * @return  1 x 256 Eigen probability RowVector.
+ */
+template <typename T, template <typename> class Likelihood>
+const RowVector256T<T>& GenericTrioModel<T, Likelihood>::SitePopulationPriors() const {
+  if (has_site_priors_) {
+    return site_population_priors_;
+  } else if (reference_idx_ == -1) {
+    return population_priors_;
+  } else {
+    return reference_population_priors_[reference_idx_];
+  }
 }
 
 /**
@@ -140,12 +287,22 @@ void TrioModel::SetReadDependentData(const ReadDataVector &data_vec) {
  *
  * Resizes the original 16 x 16 matrix to 1 x 256.
  *
- * @return  1 x 256 Eigen probability RowVector in log e space where the i
- *          element is a unique parent pair genotype.
+ * @param  nucleotide_frequencies Nucleotide frequencies of the population.
+ * @param  reference_idx          Index of reference nucleotide or -1 by
+ *                                default for priors that are not conditioned
+ *                                on the reference.
+ * @return                        1 x 256 Eigen probability RowVector in log e
+ *                                space where the i element is a unique parent
+ *                                pair genotype.
  */
-RowVector256d TrioModel::PopulationPriors() {
-  RowVector256d population_priors_flattened;
-  Matrix16_16d population_priors_expanded = TrioModel::PopulationPriorsExpanded();
+template <typename T, template <typename> class Likelihood>
+RowVector256T<T> GenericTrioModel<T, Likelihood>::PopulationPriors(const RowVector4T<T> &nucleotide_frequencies,
+                                                                   int reference_idx) {
+  RowVector256T<T> population_priors_flattened;
+  Matrix16_16T<T> population_priors_expanded = GenericTrioModel::PopulationPriorsExpanded(
+    nucleotide_frequencies,
+    reference_idx
+  );
   for (int i = 0; i < kGenotypeCount; ++i) {
     for (int j = 0; j < kGenotypeCount; ++j) {
       int idx = i * kGenotypeCount + j;
@@ -172,15 +329,29 @@ RowVector256d TrioModel::PopulationPriors() {
  * nucleotide_frequencies_ << 0.25, 0.25, 0.25, 0.25;
  * nucleotide_counts = {4, 0, 0, 0};
  *
- * @return  16 x 16 Eigen matrix in log e space where the (i, j) element is the
- *          probability that the mother has genotype i and the father has
- *          genotype j.
+ * If a reference nucleotide is given, reference_weight_ is added to its
+ * alpha, which is the prior of the four parent alleles having been drawn from
+ * a population that carries the reference allele.
+ *
+ * @param  nucleotide_frequencies Nucleotide frequencies of the population.
+ * @param  reference_idx          Index of reference nucleotide or -1 by
+ *                                default for priors that are not conditioned
+ *                                on the reference.
+ * @return                        16 x 16 Eigen matrix in log e space where the
+ *                                (i, j) element is the probability that the
+ *                                mother has genotype i and the father has
+ *                                genotype j.
  */
-Matrix16_16d TrioModel::PopulationPriorsExpanded() {
+template <typename T, template <typename> class Likelihood>
+Matrix16_16T<T> GenericTrioModel<T, Likelihood>::PopulationPriorsExpanded(const RowVector4T<T> &nucleotide_frequencies,
+                                                                          int reference_idx) {
   // Calculates nucleotide mutation frequencies using given mutation rate.
-  RowVector4d nucleotide_mutation_frequencies = (nucleotide_frequencies_ *
+  RowVector4T<T> nucleotide_mutation_frequencies = (nucleotide_frequencies *
     population_mutation_rate_);
-  Matrix16_16d population_priors = Matrix16_16d::Zero();
+  if (reference_idx != -1) {
+    nucleotide_mutation_frequencies(reference_idx) += reference_weight_;
+  }
+  Matrix16_16T<T> population_priors = Matrix16_16T<T>::Zero();
   const Matrix16_16_4d kTwoParentCounts = TwoParentCounts();
 
   for (int i = 0; i < kGenotypeCount; ++i) {
@@ -192,7 +363,7 @@ Matrix16_16d TrioModel::PopulationPriorsExpanded() {
         nucleotide_read.reads[k] = nucleotide_counts(k);
       }
       // Calculates probability using the Dirichlet multinomial in normal space.
-      double log_probability = DirichletMultinomialLog(
+      T log_probability = DirichletMultinomialLog(
         nucleotide_mutation_frequencies,
         nucleotide_read
       );
@@ -206,8 +377,49 @@ Matrix16_16d TrioModel::PopulationPriorsExpanded() {
 /**
  * Returns 1 x 16 Eigen RowVector population priors for a single parent.
  */
-RowVector16d TrioModel::PopulationPriorsSingle() {
-  return TrioModel::PopulationPriorsExpanded().rowwise().sum();
+template <typename T, template <typename> class Likelihood>
+RowVector16T<T> GenericTrioModel<T, Likelihood>::PopulationPriorsSingle() {
+  return GenericTrioModel::PopulationPriorsExpanded(nucleotide_frequencies_).rowwise().sum();
+}
+
+/**
+ * Returns 1 x 256 Eigen probability RowVector of the parent genotypes at a
+ * known polymorphic site. Each parent allele is drawn independently from the
+ * population allele frequencies (Hardy-Weinberg proportions), e.g. a parent
+ * has genotype AC with probability f_A * f_C.
+ *
+ * The frequencies are mixed with the genome-wide nucleotide frequencies
+ * weighted by the population mutation rate (theta), so an allele that is not
+ * seen in the population stays possible with probability on the order of
+ * theta, as in PopulationPriors().
+ *
+ * @param  allele_frequencies Allele frequencies of A, C, G and T at the site
+ *                            that sum to 1.
+ * @return                    1 x 256 Eigen probability RowVector where the
+ *                            i * 16 + j element is the probability that the
+ *                            mother has genotype i and the father has
+ *                            genotype j.
+ */
+template <typename T, template <typename> class Likelihood>
+RowVector256T<T> GenericTrioModel<T, Likelihood>::AlleleFrequencyPriors(const RowVector4T<T> &allele_frequencies) {
+  RowVector4T<T> frequencies = (allele_frequencies +
+    nucleotide_frequencies_ * population_mutation_rate_);
+  frequencies /= frequencies.sum();
+
+  RowVector16T<T> genotype_priors;
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    for (int j = 0; j < kNucleotideCount; ++j) {
+      genotype_priors(i * kNucleotideCount + j) = frequencies(i) * frequencies(j);
+    }
+  }
+  RowVector256T<T> population_priors;
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    for (int j = 0; j < kGenotypeCount; ++j) {
+      population_priors(i * kGenotypeCount + j) = genotype_priors(i) * genotype_priors(j);
+    }
+  }
+
+  return population_priors;
 }
 
 /**
@@ -215,11 +427,14 @@ RowVector16d TrioModel::PopulationPriorsSingle() {
  * mutation rate. Weighted based on if parent genotype is homozygous or
  * heterozygous.
  */
-void TrioModel::SetGermlineMutationProbabilities() {
-  double exp_term = exp(-4.0/3.0 * germline_mutation_rate_);
-  homozygous_match_ = 0.25 + 0.75 * exp_term;
-  heterozygous_match_ = 0.25 + 0.25 * exp_term;
-  mismatch_ = 0.25 - 0.25 * exp_term;
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetGermlineMutationProbabilities() {
+  // 1 - exp(-4/3 * rate) is computed with expm1, because exp rounds to exactly
+  // 1 in float precision and the mismatch would vanish.
+  T mutation_term = -expm1(-4.0/3.0 * germline_mutation_rate_);
+  homozygous_match_ = 1.0 - 0.75 * mutation_term;  // 0.25 + 0.75 * exp_term
+  heterozygous_match_ = 0.5 - 0.25 * mutation_term;  // 0.25 + 0.25 * exp_term
+  mismatch_ = 0.25 * mutation_term;  // 0.25 - 0.25 * exp_term
 }
 
 /**
@@ -233,9 +448,10 @@ void TrioModel::SetGermlineMutationProbabilities() {
  *                              probability of no mutation.
  * @return                      Probability of germline mutation.
  */
-double TrioModel::GermlineMutation(int child_nucleotide_idx,
-                                   int parent_genotype_idx,
-                                   bool no_mutation_flag) {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::GermlineMutation(int child_nucleotide_idx,
+                                                    int parent_genotype_idx,
+                                                    bool no_mutation_flag) {
   // Determines if the comparison is homozygous, heterozygous or no match.
   if (IsAlleleInParentGenotype(child_nucleotide_idx, parent_genotype_idx)) {
     if (parent_genotype_idx % 5 == 0) {  // Homozygous genotypes are divisible by 5
@@ -267,8 +483,9 @@ double TrioModel::GermlineMutation(int child_nucleotide_idx,
  *                          probability of no mutation.
  * @return                  16 x 256 Eigen probability matrix.
  */
-Matrix16_256d TrioModel::GermlineProbabilityMat(bool no_mutation_flag) {
-  return KroneckerProduct(TrioModel::GermlineProbabilityMatSingle(no_mutation_flag));
+template <typename T, template <typename> class Likelihood>
+Matrix16_256T<T> GenericTrioModel<T, Likelihood>::GermlineProbabilityMat(bool no_mutation_flag) {
+  return KroneckerProduct(GenericTrioModel::GermlineProbabilityMatSingle(no_mutation_flag));
 }
 
 /**
@@ -285,11 +502,12 @@ Matrix16_256d TrioModel::GermlineProbabilityMat(bool no_mutation_flag) {
  *                          probability of no mutation.
  * @return                  4 x 16 Eigen probability matrix.
  */
-Matrix4_16d TrioModel::GermlineProbabilityMatSingle(bool no_mutation_flag) {
-  Matrix4_16d germline_probability_mat = Matrix4_16d::Zero();
+template <typename T, template <typename> class Likelihood>
+Matrix4_16T<T> GenericTrioModel<T, Likelihood>::GermlineProbabilityMatSingle(bool no_mutation_flag) {
+  Matrix4_16T<T> germline_probability_mat = Matrix4_16T<T>::Zero();
   for (int i = 0; i < kNucleotideCount; ++i) {
     for (int j = 0; j < kGenotypeCount; ++j) {
-      double probability = TrioModel::GermlineMutation(i, j, no_mutation_flag);
+      T probability = GenericTrioModel::GermlineMutation(i, j, no_mutation_flag);
       germline_probability_mat(i, j) = probability;
     }
   }
@@ -304,12 +522,13 @@ Matrix4_16d TrioModel::GermlineProbabilityMatSingle(bool no_mutation_flag) {
  * @param  other_nucleotide_idx Index of another nucleotide to be compared.
  * @return                      Probability of somatic mutation.
  */
-double TrioModel::SomaticMutation(int nucleotide_idx, int other_nucleotide_idx) {
-  double exp_term = exp(-4.0/3.0 * somatic_mutation_rate_);
-  double term = 0.25 * (1 - exp_term);
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::SomaticMutation(int nucleotide_idx, int other_nucleotide_idx) {
+  T mutation_term = -expm1(-4.0/3.0 * somatic_mutation_rate_);  // 1 - exp_term
+  T term = 0.25 * mutation_term;
 
   if (nucleotide_idx == other_nucleotide_idx) {  // Indicator function.
-    return term + exp_term;
+    return 1.0 - 0.75 * mutation_term;  // term + exp_term
   } else {
     return term;
   }
@@ -327,11 +546,12 @@ double TrioModel::SomaticMutation(int nucleotide_idx, int other_nucleotide_idx)
  *          original somatic genotypes and the second dimension is the mutated 
  *          genotype.
  */
-Matrix16_16d TrioModel::SomaticProbabilityMat() {
-  Matrix4d somatic_probability_mat = Matrix4d::Zero();
+template <typename T, template <typename> class Likelihood>
+Matrix16_16T<T> GenericTrioModel<T, Likelihood>::SomaticProbabilityMat() {
+  Matrix4T<T> somatic_probability_mat = Matrix4T<T>::Zero();
   for (int i = 0; i < kNucleotideCount; ++i) {
     for (int j = 0; j < kNucleotideCount; ++j) {
-      double probability = TrioModel::SomaticMutation(i, j);
+      T probability = GenericTrioModel::SomaticMutation(i, j);
       somatic_probability_mat(i, j) = probability;
     }
   }
@@ -344,49 +564,95 @@ Matrix16_16d TrioModel::SomaticProbabilityMat() {
  *
  * @return  16 x 16 Eigen matrix diagonal of somatic_probability_mat_.
  */
-Matrix16_16d TrioModel::SomaticProbabilityMatDiag() {
+template <typename T, template <typename> class Likelihood>
+Matrix16_16T<T> GenericTrioModel<T, Likelihood>::SomaticProbabilityMatDiag() {
   return somatic_probability_mat_.diagonal().asDiagonal();
 }
 
 /**
- * Calculates the probability of sequencing error for all read data. Assume
- * data contains 3 reads (child, mother, father). Assume the ReadDataVector is
- * already initialized in read_dependent_data_. Assume each chromosome is
- * equally likely to be sequenced.
+ * Calculates the probability of sequencing error for all read data using the
+ * Likelihood policy of each individual. Assume data contains 3 reads (child,
+ * mother, father).
+ * Assume the ReadDataVector is already initialized in read_dependent_data_.
+ * Assume each chromosome is equally likely to be sequenced.
  *
- * Adds the max element of all reads in ReadDataVector to
+ * Adds the max element of each read in ReadDataVector to
  * read_dependent_data_.max_elements before rescaling to normal space.
  */
-void TrioModel::SequencingProbabilityMat() {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SequencingProbabilityMat() {
+  const int bin_count = quality_error_rates_.size();
   for (int read = 0; read < 3; ++read) {
+    if (bin_count > 0) {
+      GenericTrioModel::BinnedSequencingProbability(read);
+      continue;
+    }
+    const ReadData &data = read_dependent_data_.read_data_vec[read];
+    const Likelihood<T> &likelihood = likelihoods_[read];
     for (int genotype_idx = 0; genotype_idx < kGenotypeCount; ++genotype_idx) {
-      auto alpha = alphas_.row(genotype_idx);
-      const ReadData &data = read_dependent_data_.read_data_vec[read];
-      double log_probability = DirichletMultinomialLog(alpha, data);
+      T log_probability = likelihood.Log(genotype_idx, data);
       read_dependent_data_.sequencing_probability_mat(read, genotype_idx) = log_probability;
     }
   }
   
-  // Rescales to normal space and records max element of all 3 reads together.
-  double max_element = read_dependent_data_.sequencing_probability_mat.maxCoeff();
-  read_dependent_data_.max_elements.push_back(max_element);
-
-  // Calculates sequencing_probability_mat and splits into individual child
-  // mother, and father vectors.
-  read_dependent_data_.sequencing_probability_mat = exp(
-    read_dependent_data_.sequencing_probability_mat.array() - max_element
-  );
+  // Rescales each read to normal space by its own max element. The factor of
+  // each individual cancels in MutationProbability(), and rescaling the reads
+  // separately keeps a poorly fitting individual from underflowing to zero,
+  // which happens quickly in float precision.
+  //
+  // Entries below the smallest normal value are flushed to zero. They are at
+  // least 1e-38 of the max element and do not change the probability, but
+  // subnormal operands make every product in the tree peeling take the slow
+  // path of the FPU, which made float models slower than double.
+  const T min_normal = numeric_limits<T>::min();
+  for (int read = 0; read < 3; ++read) {
+    T max_element = read_dependent_data_.sequencing_probability_mat.row(read).maxCoeff();
+    read_dependent_data_.max_elements.push_back(max_element);
+    read_dependent_data_.sequencing_probability_mat.row(read) = exp(
+      read_dependent_data_.sequencing_probability_mat.row(read).array() - max_element
+    );
+    read_dependent_data_.sequencing_probability_mat.row(read) = (
+      read_dependent_data_.sequencing_probability_mat.row(read).array() < min_normal
+    ).select(0, read_dependent_data_.sequencing_probability_mat.row(read));
+  }
+
+  // Splits sequencing_probability_mat into individual child, mother, and
+  // father vectors.
   read_dependent_data_.child_somatic_probability = read_dependent_data_.sequencing_probability_mat.row(0);
   read_dependent_data_.mother_somatic_probability = read_dependent_data_.sequencing_probability_mat.row(1);
   read_dependent_data_.father_somatic_probability = read_dependent_data_.sequencing_probability_mat.row(2);
 }
 
+/**
+ * Sets the log likelihoods of a read that is binned by base quality, which are
+ * the sums of the log likelihoods of its bins. Bins without reads add nothing
+ * and are skipped.
+ *
+ * @param  read Index of the read: 0 child, 1 mother, 2 father.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::BinnedSequencingProbability(int read) {
+  const int bin_count = quality_error_rates_.size();
+  read_dependent_data_.sequencing_probability_mat.row(read).setZero();
+  for (int bin = 0; bin < bin_count; ++bin) {
+    const ReadData &data = read_dependent_data_.read_data_vec[read * bin_count + bin];
+    if (data.key == 0) {
+      continue;
+    }
+    const Likelihood<T> &likelihood = quality_likelihoods_[read * bin_count + bin];
+    for (int genotype_idx = 0; genotype_idx < kGenotypeCount; ++genotype_idx) {
+      read_dependent_data_.sequencing_probability_mat(read, genotype_idx) += likelihood.Log(genotype_idx, data);
+    }
+  }
+}
+
 /**
  * Multiplies sequencing probability vectors by somatic transition matrix.
  *
  * @param  is_numerator True if calculating probability of numerator.
  */
-void TrioModel::SomaticTransition(bool is_numerator) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SomaticTransition(bool is_numerator) {
   if (!is_numerator) {
     read_dependent_data_.denominator.child_zygotic_probability = (
       read_dependent_data_.child_somatic_probability * somatic_probability_mat_
@@ -414,19 +680,24 @@ void TrioModel::SomaticTransition(bool is_numerator) {
  * Calculates denominator, probability of the observed data or numerator,
  * probability of no mutation.
  *
- * @param  is_numerator True if calculating probability of numerator.
+ * @param  germline_probability_mat Germline transition matrix of the
+ *                                  denominator or the numerator.
+ * @param  is_numerator             True if calculating probability of
+ *                                  numerator.
  */
-void TrioModel::GermlineTransition(bool is_numerator) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::GermlineTransition(const Matrix16_256T<T> &germline_probability_mat,
+                                                         bool is_numerator) {
   if (!is_numerator) {
     read_dependent_data_.denominator.child_germline_probability = (
       read_dependent_data_.denominator.child_zygotic_probability *
-      germline_probability_mat_
+      germline_probability_mat
     );
     read_dependent_data_.denominator.parent_probability = KroneckerProduct(
       read_dependent_data_.denominator.mother_zygotic_probability,
       read_dependent_data_.denominator.father_zygotic_probability
     );
-    read_dependent_data_.denominator.root_mat = TrioModel::GetRootMat(
+    read_dependent_data_.denominator.root_mat = GenericTrioModel::GetRootMat(
       read_dependent_data_.denominator.child_germline_probability,
       read_dependent_data_.denominator.parent_probability
     );
@@ -434,13 +705,13 @@ void TrioModel::GermlineTransition(bool is_numerator) {
   } else {
     read_dependent_data_.numerator.child_germline_probability = (
       read_dependent_data_.numerator.child_zygotic_probability *
-      germline_probability_mat_num_
+      germline_probability_mat
     );
     read_dependent_data_.numerator.parent_probability = KroneckerProduct(
       read_dependent_data_.numerator.mother_zygotic_probability,
       read_dependent_data_.numerator.father_zygotic_probability
     );
-    read_dependent_data_.numerator.root_mat = TrioModel::GetRootMat(
+    read_dependent_data_.numerator.root_mat = GenericTrioModel::GetRootMat(
       read_dependent_data_.numerator.child_germline_probability,
       read_dependent_data_.numerator.parent_probability
     );
@@ -455,10 +726,11 @@ void TrioModel::GermlineTransition(bool is_numerator) {
  * @param  parent_probability         Kronecker product of both parent vectors.
  * @return                            1 x 256 final matrix at the root of tree.
  */
-RowVector256d TrioModel::GetRootMat(const RowVector256d &child_germline_probability,
-                                    const RowVector256d &parent_probability) {
+template <typename T, template <typename> class Likelihood>
+RowVector256T<T> GenericTrioModel<T, Likelihood>::GetRootMat(const RowVector256T<T> &child_germline_probability,
+                                                             const RowVector256T<T> &parent_probability) {
   return child_germline_probability.cwiseProduct(
-    parent_probability).cwiseProduct(population_priors_);
+    parent_probability).cwiseProduct(GenericTrioModel::SitePopulationPriors());
 }
 
 /**
@@ -468,16 +740,22 @@ RowVector256d TrioModel::GetRootMat(const RowVector256d &child_germline_probabil
  * 
  * Current values are placeholders until they are estimated in Spring 2014.
  *
- * @return  16 x 4 Eigen matrix of Dirichlet multinomial alpha parameters
- *          alpha = (alpha_1, ..., alpha_K) for a K-category Dirichlet
- *          distribution (where K = 4 = kNucleotideCount) that vary with each
- *          combination of parental genotype and reference nucleotide.
+ * @param  sequencing_error_rate Sequencing error rate.
+ * @param  dirichlet_dispersion  Dirichlet dispersion.
+ * @return                       16 x 4 Eigen matrix of Dirichlet multinomial
+ *                               alpha parameters alpha = (alpha_1, ...,
+ *                               alpha_K) for a K-category Dirichlet
+ *                               distribution (where K = 4 = kNucleotideCount)
+ *                               that vary with each combination of parental
+ *                               genotype and reference nucleotide.
  */
-Matrix16_4d TrioModel::Alphas() {
-  Matrix16_4d alphas;
-  double homozygous = 1.0 - sequencing_error_rate_;
-  double mismatch = sequencing_error_rate_ / 3.0;
-  double heterozygous = 0.5 - mismatch;
+template <typename T, template <typename> class Likelihood>
+Matrix16_4T<T> GenericTrioModel<T, Likelihood>::Alphas(T sequencing_error_rate,
+                                                       T dirichlet_dispersion) const {
+  Matrix16_4T<T> alphas;
+  T homozygous = 1.0 - sequencing_error_rate;
+  T mismatch = sequencing_error_rate / 3.0;
+  T heterozygous = 0.5 - mismatch;
 
   for (int i = 0; i < kGenotypeCount; ++i) {
     for (int j = 0; j < kNucleotideCount; ++j) {
@@ -493,7 +771,56 @@ Matrix16_4d TrioModel::Alphas() {
     }
   }
 
-  return alphas * dirichlet_dispersion_;
+  return alphas * dirichlet_dispersion;
+}
+
+/**
+ * Sets alphas_ and the alphas and likelihood tables of all individuals to
+ * sequencing_error_rate_ and dirichlet_dispersion_.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetAlphas() {
+  alphas_ = GenericTrioModel::Alphas(sequencing_error_rate_, dirichlet_dispersion_);
+  for (int individual = 0; individual < kIndividualCount; ++individual) {
+    individual_sequencing_error_rates_[individual] = sequencing_error_rate_;
+    individual_dirichlet_dispersions_[individual] = dirichlet_dispersion_;
+    individual_alphas_[individual] = alphas_;
+    likelihoods_[individual].SetAlphas(alphas_);
+    GenericTrioModel::SetQualityAlphas(individual);
+  }
+}
+
+/**
+ * Sets the alphas and likelihood tables of one individual to its own
+ * sequencing error rate and dirichlet dispersion.
+ *
+ * @param  individual Index of individual: 0 child, 1 mother, 2 father.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetIndividualAlphas(int individual) {
+  individual_alphas_[individual] = GenericTrioModel::Alphas(
+    individual_sequencing_error_rates_[individual],
+    individual_dirichlet_dispersions_[individual]
+  );
+  likelihoods_[individual].SetAlphas(individual_alphas_[individual]);
+  GenericTrioModel::SetQualityAlphas(individual);
+}
+
+/**
+ * Sets the likelihood tables of each base quality bin of one individual to the
+ * alphas of the bin.
+ *
+ * @param  individual Index of individual: 0 child, 1 mother, 2 father.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetQualityAlphas(int individual) {
+  const int bin_count = quality_error_rates_.size();
+  quality_likelihoods_.resize(kIndividualCount * bin_count);
+  for (int bin = 0; bin < bin_count; ++bin) {
+    quality_likelihoods_[individual * bin_count + bin].SetAlphas(
+      GenericTrioModel::quality_alphas(individual, bin)
+    );
+  }
 }
 
 /**
@@ -506,8 +833,9 @@ Matrix16_4d TrioModel::Alphas() {
  * @param  other TrioModel object to be compared.
  * @return       True if the two TrioModel objects are equal to each other.
  */
-bool TrioModel::Equals(const TrioModel &other) {
-  bool attr_table[12] = {
+template <typename T, template <typename> class Likelihood>
+bool GenericTrioModel<T, Likelihood>::Equals(const GenericTrioModel &other) {
+  bool attr_table[15] = {
     Equal(population_mutation_rate_, other.population_mutation_rate_),
     Equal(germline_mutation_rate_, other.germline_mutation_rate_),
     Equal(somatic_mutation_rate_, other.germline_mutation_rate_),
@@ -523,6 +851,9 @@ bool TrioModel::Equals(const TrioModel &other) {
         other.germline_probability_mat_,
         kEpsilon),
     somatic_probability_mat_.isApprox(other.somatic_probability_mat_, kEpsilon),
+    individual_alphas_[0].isApprox(other.individual_alphas_[0], kEpsilon),
+    individual_alphas_[1].isApprox(other.individual_alphas_[1], kEpsilon),
+    individual_alphas_[2].isApprox(other.individual_alphas_[2], kEpsilon),
     read_dependent_data_.sequencing_probability_mat.isApprox(
         other.read_dependent_data_.sequencing_probability_mat,
         kEpsilon)
@@ -535,20 +866,23 @@ bool TrioModel::Equals(const TrioModel &other) {
   }
 }
 
-double TrioModel::population_mutation_rate() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::population_mutation_rate() const {
   return population_mutation_rate_;
 }
 
 /**
- * Sets population_mutation_rate_, population_priors_single_ and population_priors_.
+ * Sets population_mutation_rate_, population_priors_single_, population_priors_
+ * and the population priors of every reference nucleotide.
  */
-void TrioModel::set_population_mutation_rate(double rate) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_population_mutation_rate(T rate) {
   population_mutation_rate_ = rate;
-  population_priors_ = TrioModel::PopulationPriors();
-  population_priors_single_ = TrioModel::PopulationPriorsSingle();
+  GenericTrioModel::SetPopulationPriors();
 }
 
-double TrioModel::germline_mutation_rate() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::germline_mutation_rate() const {
   return germline_mutation_rate_;
 }
 
@@ -556,27 +890,32 @@ double TrioModel::germline_mutation_rate() const {
  * Sets germline_mutation_rate_, germline_probability_mat_single,
  * germline_probability_mat_ and germline_probability_mat_num_.
  */
-void TrioModel::set_germline_mutation_rate(double rate) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_germline_mutation_rate(T rate) {
   germline_mutation_rate_ = rate;
-  TrioModel::SetGermlineMutationProbabilities();
-  germline_probability_mat_single_ = TrioModel::GermlineProbabilityMatSingle();
-  germline_probability_mat_ = TrioModel::GermlineProbabilityMat();
-  germline_probability_mat_num_ = TrioModel::GermlineProbabilityMat(true);
+  GenericTrioModel::SetGermlineMutationProbabilities();
+  germline_probability_mat_single_ = GenericTrioModel::GermlineProbabilityMatSingle();
+  germline_probability_mat_ = GenericTrioModel::GermlineProbabilityMat();
+  germline_probability_mat_num_ = GenericTrioModel::GermlineProbabilityMat(true);
 }
 
-double TrioModel::homozygous_match() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::homozygous_match() const {
   return homozygous_match_;
 }
 
-double TrioModel::heterozygous_match() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::heterozygous_match() const {
   return heterozygous_match_;
 }
 
-double TrioModel::mismatch() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::mismatch() const {
   return mismatch_;
 }
 
-double TrioModel::somatic_mutation_rate() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::somatic_mutation_rate() const {
   return somatic_mutation_rate_;
 }
 
@@ -584,85 +923,273 @@ double TrioModel::somatic_mutation_rate() const {
  * Sets somatic_mutation_rate_, somatic_probability_mat_ and
  * somatic_probability_mat_diag_.
  */
-void TrioModel::set_somatic_mutation_rate(double rate) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_somatic_mutation_rate(T rate) {
   somatic_mutation_rate_ = rate;
-  somatic_probability_mat_ = TrioModel::SomaticProbabilityMat();
-  somatic_probability_mat_diag_ = TrioModel::SomaticProbabilityMatDiag();
+  somatic_probability_mat_ = GenericTrioModel::SomaticProbabilityMat();
+  somatic_probability_mat_diag_ = GenericTrioModel::SomaticProbabilityMatDiag();
 }
 
-double TrioModel::sequencing_error_rate() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::sequencing_error_rate() const {
   return sequencing_error_rate_;
 }
 
 /**
- * Sets sequencing_error_rate_ and alphas_.
+ * Sets sequencing_error_rate_, alphas_ and the sequencing error rate and alphas
+ * of all individuals.
  */
-void TrioModel::set_sequencing_error_rate(double rate) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_sequencing_error_rate(T rate) {
   sequencing_error_rate_ = rate;
-  alphas_ = TrioModel::Alphas();
+  GenericTrioModel::SetAlphas();
 }
 
-double TrioModel::dirichlet_dispersion() const {
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::sequencing_error_rate(int individual) const {
+  return individual_sequencing_error_rates_[individual];
+}
+
+/**
+ * Sets the sequencing error rate and alphas of one individual.
+ *
+ * @param  individual Index of individual: 0 child, 1 mother, 2 father.
+ * @param  rate       Sequencing error rate of the individual.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_sequencing_error_rate(int individual, T rate) {
+  individual_sequencing_error_rates_[individual] = rate;
+  GenericTrioModel::SetIndividualAlphas(individual);
+}
+
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::dirichlet_dispersion() const {
   return dirichlet_dispersion_;
 }
 
 /**
- * Sets dirichlet_dispersion_ and alphas_.
+ * Sets dirichlet_dispersion_, alphas_ and the dirichlet dispersion and alphas
+ * of all individuals.
  */
-void TrioModel::set_dirichlet_dispersion(double dispersion) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_dirichlet_dispersion(T dispersion) {
   dirichlet_dispersion_ = dispersion;
-  alphas_ = TrioModel::Alphas();
+  GenericTrioModel::SetAlphas();
+}
+
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::dirichlet_dispersion(int individual) const {
+  return individual_dirichlet_dispersions_[individual];
+}
+
+/**
+ * Sets the dirichlet dispersion and alphas of one individual.
+ *
+ * @param  individual Index of individual: 0 child, 1 mother, 2 father.
+ * @param  dispersion Dirichlet dispersion of the individual.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_dirichlet_dispersion(int individual, T dispersion) {
+  individual_dirichlet_dispersions_[individual] = dispersion;
+  GenericTrioModel::SetIndividualAlphas(individual);
 }
 
-RowVector4d TrioModel::nucleotide_frequencies() const {
+template <typename T, template <typename> class Likelihood>
+RowVector4T<T> GenericTrioModel<T, Likelihood>::nucleotide_frequencies() const {
   return nucleotide_frequencies_;
 }
 
 /**
- * Sets nucleotide_frequencies_, population_priors_ and population_priors_single_.
+ * Sets nucleotide_frequencies_, population_priors_, population_priors_single_
+ * and the population priors of every reference nucleotide.
  */
-void TrioModel::set_nucleotide_frequencies(const RowVector4d &frequencies) {
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_nucleotide_frequencies(const RowVector4T<T> &frequencies) {
   nucleotide_frequencies_ = frequencies;
-  population_priors_ = TrioModel::PopulationPriors();
-  population_priors_single_ = TrioModel::PopulationPriorsSingle();
+  GenericTrioModel::SetPopulationPriors();
 }
 
-RowVector16d TrioModel::population_priors_single() const {
+template <typename T, template <typename> class Likelihood>
+RowVector16T<T> GenericTrioModel<T, Likelihood>::population_priors_single() const {
   return population_priors_single_;
 }
 
-RowVector256d TrioModel::population_priors() const {
+template <typename T, template <typename> class Likelihood>
+RowVector256T<T> GenericTrioModel<T, Likelihood>::population_priors() const {
   return population_priors_;
 }
 
-Matrix4_16d TrioModel::germline_probability_mat_single() const {
+template <typename T, template <typename> class Likelihood>
+RowVector256T<T> GenericTrioModel<T, Likelihood>::population_priors(int reference_idx) const {
+  return reference_population_priors_[reference_idx];
+}
+
+template <typename T, template <typename> class Likelihood>
+T GenericTrioModel<T, Likelihood>::reference_weight() const {
+  return reference_weight_;
+}
+
+/**
+ * Sets reference_weight_ and the population priors of every reference
+ * nucleotide.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_reference_weight(T weight) {
+  reference_weight_ = weight;
+  GenericTrioModel::SetPopulationPriors();
+}
+
+template <typename T, template <typename> class Likelihood>
+int GenericTrioModel<T, Likelihood>::reference() const {
+  return reference_idx_;
+}
+
+/**
+ * Selects the precomputed population priors that are conditioned on the
+ * reference nucleotide of the next sites. Nothing is recomputed.
+ *
+ * @param  reference_idx Index of reference nucleotide or -1 to use the
+ *                       priors that are not conditioned on the reference.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetReference(int reference_idx) {
+  reference_idx_ = reference_idx;
+}
+
+/**
+ * Selects the population priors of the population allele frequencies of the
+ * next sites. They are taken from FrequencyPopulationPriors() and take
+ * precedence over the priors of the reference nucleotide.
+ *
+ * @param  frequencies Nucleotide frequencies of A, C, G and T at the site.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::SetSiteFrequencies(const RowVector4d &frequencies) {
+  site_population_priors_ = GenericTrioModel::FrequencyPopulationPriors(frequencies);
+  has_site_priors_ = true;
+}
+
+/**
+ * Returns to the genome-wide or reference population priors.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::ClearSiteFrequencies() {
+  has_site_priors_ = false;
+}
+
+/**
+ * Returns the population priors of population allele frequencies. The
+ * frequencies are quantized with QuantizeFrequencies() and the priors of the
+ * quantized frequencies are computed on the first request and kept in
+ * frequency_cache_ for later sites.
+ *
+ * The reference is valid until the next call with frequencies that are not
+ * cached.
+ *
+ * @param  frequencies Nucleotide frequencies of A, C, G and T.
+ * @return             1 x 256 Eigen probability RowVector.
+ */
+template <typename T, template <typename> class Likelihood>
+const RowVector256T<T>& GenericTrioModel<T, Likelihood>::FrequencyPopulationPriors(const RowVector4d &frequencies) {
+  long key = QuantizeFrequencies(frequencies);
+  RowVector256T<T> *cached = frequency_cache_.Find(key);
+  if (cached != nullptr) {
+    return *cached;
+  }
+  RowVector4T<T> quantized_frequencies = QuantizedFrequencies(key).template cast<T>();
+  return frequency_cache_.Insert(
+    key,
+    GenericTrioModel::AlleleFrequencyPriors(quantized_frequencies)
+  );
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix4_16T<T> GenericTrioModel<T, Likelihood>::germline_probability_mat_single() const {
   return germline_probability_mat_single_;
 }
 
-Matrix16_256d TrioModel::germline_probability_mat() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_256T<T> GenericTrioModel<T, Likelihood>::germline_probability_mat() const {
   return germline_probability_mat_;
 }
 
-Matrix16_256d TrioModel::germline_probability_mat_num() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_256T<T> GenericTrioModel<T, Likelihood>::germline_probability_mat_num() const {
   return germline_probability_mat_num_;
 }
 
-Matrix16_16d TrioModel::somatic_probability_mat() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_16T<T> GenericTrioModel<T, Likelihood>::somatic_probability_mat() const {
   return somatic_probability_mat_;
 }
 
-Matrix16_16d TrioModel::somatic_probability_mat_diag() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_16T<T> GenericTrioModel<T, Likelihood>::somatic_probability_mat_diag() const {
   return somatic_probability_mat_diag_;
 }
 
-Matrix3_16d TrioModel::sequencing_probability_mat() const {
+template <typename T, template <typename> class Likelihood>
+Matrix3_16T<T> GenericTrioModel<T, Likelihood>::sequencing_probability_mat() const {
   return read_dependent_data_.sequencing_probability_mat;
 }
 
-Matrix16_4d TrioModel::alphas() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_4T<T> GenericTrioModel<T, Likelihood>::alphas() const {
   return alphas_;
 }
 
-ReadDependentData TrioModel::read_dependent_data() const {
+template <typename T, template <typename> class Likelihood>
+Matrix16_4T<T> GenericTrioModel<T, Likelihood>::alphas(int individual) const {
+  return individual_alphas_[individual];
+}
+
+template <typename T, template <typename> class Likelihood>
+const vector<T>& GenericTrioModel<T, Likelihood>::quality_error_rates() const {
+  return quality_error_rates_;
+}
+
+/**
+ * Sets the error rates of the base quality bins and the likelihood tables of
+ * each bin of every individual. MutationProbability() then takes the reads of
+ * each bin of each individual. An empty vector scores reads without bins.
+ *
+ * @param  rates Error rate of each bin.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericTrioModel<T, Likelihood>::set_quality_error_rates(const vector<T> &rates) {
+  quality_error_rates_ = rates;
+  for (int individual = 0; individual < kIndividualCount; ++individual) {
+    GenericTrioModel::SetQualityAlphas(individual);
+  }
+}
+
+/**
+ * Returns the alphas of a base quality bin of an individual, whose error rate
+ * is the error rate of the bin but at least the sequencing error rate of the
+ * individual, which also covers errors that base qualities miss.
+ *
+ * @param  individual Index of individual: 0 child, 1 mother, 2 father.
+ * @param  bin        Index of the base quality bin.
+ * @return            16 x 4 Eigen matrix of Dirichlet multinomial alphas.
+ */
+template <typename T, template <typename> class Likelihood>
+Matrix16_4T<T> GenericTrioModel<T, Likelihood>::quality_alphas(int individual,
+                                                               int bin) const {
+  return GenericTrioModel::Alphas(
+    max(quality_error_rates_[bin], individual_sequencing_error_rates_[individual]),
+    individual_dirichlet_dispersions_[individual]
+  );
+}
+
+template <typename T, template <typename> class Likelihood>
+GenericReadDependentData<T> GenericTrioModel<T, Likelihood>::read_dependent_data() const {
   return read_dependent_data_;
 }
+
+// Explicit instantiations for every scalar type and Likelihood policy.
+template class GenericTrioModel<float, DirichletMultinomialLikelihood>;
+template class GenericTrioModel<double, DirichletMultinomialLikelihood>;
+template class GenericTrioModel<long double, DirichletMultinomialLikelihood>;
+template class GenericTrioModel<float, MultinomialLikelihood>;
+template class GenericTrioModel<double, MultinomialLikelihood>;
+template class GenericTrioModel<long double, MultinomialLikelihood>;
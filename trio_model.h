@@ -13,7 +13,22 @@
  * http://www.ncbi.nlm.nih.gov/pmc/articles/PMC3728889/
  *
  * This is the implementation for an improved trio model with
- * Dirichlet-multinomial approximations.
+ * Dirichlet-multinomial approximations. The model is templated on the scalar
+ * type T of its matrices and on the likelihood of the sequencing reads, which
+ * is a compile-time policy (see likelihood.h). The Dirichlet multinomial and
+ * the multinomial variants in float, double and long double share the
+ * tree-peeling code:
+ *
+ *   TrioModel             GenericTrioModel<double, DirichletMultinomialLikelihood>
+ *   MultinomialTrioModel  GenericTrioModel<double, MultinomialLikelihood>
+ *   FloatTrioModel        GenericTrioModel<float, DirichletMultinomialLikelihood>
+ *   LongDoubleTrioModel   GenericTrioModel<long double, DirichletMultinomialLikelihood>
+ *
+ * Float models halve the memory of the matrices for bulk screening. They flush
+ * subnormal numbers to zero while they peel the tree, because the products of
+ * poorly fitting reads otherwise stay subnormal and run several times slower
+ * than double. Long double models are a high-precision reference for
+ * validating the fast paths.
  *
  * Example usage:
  *
@@ -27,92 +42,249 @@
  *   double probability = params.MutationProbability(data);
  *   data.set_germline_mutation_rate(0.000001);
  *   double new_probability = params.MutationProbability(data);
+ *
+ * Germline mutation rates that vary from site to site, e.g. between CpG and
+ * non-CpG contexts, are passed to MutationProbability() directly. The germline
+ * transition matrices of each rate are built once and kept in an LruCache keyed
+ * on the quantized rate (see QuantizeRate()), instead of being rebuilt by
+ * set_germline_mutation_rate() at every site:
+ *
+ *   double cpg_probability = params.MutationProbability(data, 2e-7);
+ *
+ * Family members are often sequenced on different runs, so the sequencing
+ * error rate and the Dirichlet dispersion can be set for each individual. The
+ * individual is the index of its reads in the ReadDataVector (0 child,
+ * 1 mother, 2 father), and each individual has its own alphas and cached
+ * likelihood tables. The setters without an individual set all three:
+ *
+ *   params.set_sequencing_error_rate(1, 0.01);  // Mother only.
+ *
+ * The population priors can be conditioned on the reference nucleotide of the
+ * site, which adds reference_weight_ to the alpha of the reference allele and
+ * makes reference homozygous parents far more likely. The priors of all four
+ * reference nucleotides are precomputed, so SetReference() only selects one:
+ *
+ *   params.SetReference(2);  // Reference G. -1 uses the unconditioned priors.
+ *   double g_probability = params.MutationProbability(data);
+ *
+ * Known polymorphic sites can use priors from their population allele
+ * frequencies instead. Each parent genotype is drawn from the allele
+ * frequencies in Hardy-Weinberg proportions (see AlleleFrequencyPriors()), so
+ * e.g. a heterozygous parent is as likely as the frequencies say, instead of
+ * theta times as likely as a homozygous parent. The priors are computed once
+ * per quantized frequency vector (see QuantizeFrequencies()) and kept in an
+ * LruCache. Site frequencies take precedence over the reference:
+ *
+ *   params.SetSiteFrequencies(frequencies);
+ *   double known_probability = params.MutationProbability(data);
+ *   params.ClearSiteFrequencies();
+ *
+ * Low-quality bases are the main source of false positives, so the reads can
+ * be scored by base quality bin instead (see CountBinnedBases() in
+ * pileup_parser.h). Each bin has an error rate, and each individual has alphas
+ * and likelihood tables for each bin, whose error rate is at least that of the
+ * individual. The reads are then passed as the counts of each bin of each
+ * individual, data_vec[individual * bins + bin], and the log likelihoods of
+ * the bins of an individual are added:
+ *
+ *   params.set_quality_error_rates({0.1, 0.003, 0.001});  // Q < 20, < 30, 30+.
+ *   double binned_probability = params.MutationProbability(binned_vec);
  */
 #ifndef TRIO_MODEL_H
 #define TRIO_MODEL_H
 
+#include <type_traits>
+#ifdef __SSE__
+#include <xmmintrin.h>  // Control register of the float models.
+#endif
+
+#include "likelihood.h"
+#include "lru_cache.h"
 #include "read_dependent_data.h"
 
 
+// Maximum number of germline mutation rates whose matrices are cached.
+const int kGermlineCacheCapacity = 64;
+
+// Maximum number of quantized frequency vectors whose priors are cached.
+const int kFrequencyCacheCapacity = 256;
+
+// Number of individuals in a trio: child, mother and father.
+const int kIndividualCount = 3;
+
+// FTZ and DAZ bits of the SSE control register, which flush subnormal results
+// and operands to zero.
+const unsigned int kFlushSubnormalsMask = 0x8040;
+
+/**
+ * Flushes subnormal numbers to zero in the calling thread while in scope and
+ * restores the control register when it goes out of scope. Does nothing if it
+ * is not enabled or the target does not have SSE.
+ */
+class FlushSubnormals {
+ public:
+  FlushSubnormals(bool is_enabled) : is_enabled_{is_enabled}, control_{0} {
+#ifdef __SSE__
+    if (is_enabled_) {
+      control_ = _mm_getcsr();
+      _mm_setcsr(control_ | kFlushSubnormalsMask);
+    }
+#endif
+  }
+
+  ~FlushSubnormals() {
+#ifdef __SSE__
+    if (is_enabled_) {
+      _mm_setcsr(control_);
+    }
+#endif
+  }
+
+ private:
+  bool is_enabled_;
+  unsigned int control_;  // Control register before the scope.
+};
+
+/**
+ * Germline transition matrices of the denominator and the numerator that are
+ * derived from the same germline mutation rate.
+ */
+template <typename Mat>
+struct GermlineOperators {
+  Mat germline_probability_mat;
+  Mat germline_probability_mat_num;
+};
+
 /**
- * TrioModel class header. See top of file for a complete description.
+ * GenericTrioModel class template header. See top of file for a complete
+ * description.
  */
-class TrioModel {
+template <typename T, template <typename> class Likelihood>
+class GenericTrioModel {
  public:
-  TrioModel();  // Default constructor and constructor to customize parameters.
-  TrioModel(double population_mutation_rate,
-            double germline_mutation_rate,
-            double somatic_mutation_rate,
-            double sequencing_error_rate,
-            double dirichlet_dispersion,
-            const RowVector4d &nucleotide_frequencies);
-  double MutationProbability(const ReadDataVector &data_vec);  // Calculates probability of mutation given input read data.
+  GenericTrioModel();  // Default constructor and constructor to customize parameters.
+  GenericTrioModel(T population_mutation_rate,
+                   T germline_mutation_rate,
+                   T somatic_mutation_rate,
+                   T sequencing_error_rate,
+                   T dirichlet_dispersion,
+                   const RowVector4T<T> &nucleotide_frequencies);
+  T MutationProbability(const ReadDataVector &data_vec);  // Calculates probability of mutation given input read data.
+  T MutationProbability(const ReadDataVector &data_vec, T germline_mutation_rate);  // Uses a site-specific germline mutation rate.
   void SetReadDependentData(const ReadDataVector &data_vec);
-  bool Equals(const TrioModel &other);  // True if the two TrioModel objects are equal to each other.
-  double population_mutation_rate() const;  // Get and set functions.
-  void set_population_mutation_rate(double rate);
-  double germline_mutation_rate() const;
-  void set_germline_mutation_rate(double rate);
-  double homozygous_match() const;
-  double heterozygous_match() const;
-  double mismatch() const;
-  double somatic_mutation_rate() const;
-  void set_somatic_mutation_rate(double rate);
-  double sequencing_error_rate() const;
-  void set_sequencing_error_rate(double rate);
-  double dirichlet_dispersion() const;
-  void set_dirichlet_dispersion(double dispersion);
-  RowVector4d nucleotide_frequencies() const;
-  void set_nucleotide_frequencies(const RowVector4d &frequencies);
-  RowVector16d population_priors_single() const;
-  RowVector256d population_priors() const;
-  Matrix4_16d germline_probability_mat_single() const;
-  Matrix16_256d germline_probability_mat() const;
-  Matrix16_256d germline_probability_mat_num() const;
-  Matrix16_16d somatic_probability_mat() const;
-  Matrix16_16d somatic_probability_mat_diag() const;
-  Matrix3_16d sequencing_probability_mat() const;
-  Matrix16_4d alphas() const;
-  ReadDependentData read_dependent_data() const;
+  void SetReadDependentData(const ReadDataVector &data_vec, T germline_mutation_rate);
+  const GermlineOperators<Matrix16_256T<T>>& SiteGermlineOperators(T rate);  // Cached matrices of a site-specific rate.
+  bool Equals(const GenericTrioModel &other);  // True if the two TrioModel objects are equal to each other.
+  T population_mutation_rate() const;  // Get and set functions.
+  void set_population_mutation_rate(T rate);
+  T germline_mutation_rate() const;
+  void set_germline_mutation_rate(T rate);
+  T homozygous_match() const;
+  T heterozygous_match() const;
+  T mismatch() const;
+  T somatic_mutation_rate() const;
+  void set_somatic_mutation_rate(T rate);
+  T sequencing_error_rate() const;
+  void set_sequencing_error_rate(T rate);  // Sets all individuals.
+  T sequencing_error_rate(int individual) const;
+  void set_sequencing_error_rate(int individual, T rate);
+  T dirichlet_dispersion() const;
+  void set_dirichlet_dispersion(T dispersion);  // Sets all individuals.
+  T dirichlet_dispersion(int individual) const;
+  void set_dirichlet_dispersion(int individual, T dispersion);
+  RowVector4T<T> nucleotide_frequencies() const;
+  void set_nucleotide_frequencies(const RowVector4T<T> &frequencies);
+  RowVector16T<T> population_priors_single() const;
+  RowVector256T<T> population_priors() const;
+  RowVector256T<T> population_priors(int reference_idx) const;
+  T reference_weight() const;
+  void set_reference_weight(T weight);
+  int reference() const;
+  void SetReference(int reference_idx);  // Selects the precomputed priors of the site.
+  void SetSiteFrequencies(const RowVector4d &frequencies);  // Selects the cached priors of the site.
+  void ClearSiteFrequencies();
+  const RowVector256T<T>& FrequencyPopulationPriors(const RowVector4d &frequencies);
+  Matrix4_16T<T> germline_probability_mat_single() const;
+  Matrix16_256T<T> germline_probability_mat() const;
+  Matrix16_256T<T> germline_probability_mat_num() const;
+  Matrix16_16T<T> somatic_probability_mat() const;
+  Matrix16_16T<T> somatic_probability_mat_diag() const;
+  Matrix3_16T<T> sequencing_probability_mat() const;
+  Matrix16_4T<T> alphas() const;
+  Matrix16_4T<T> alphas(int individual) const;
+  GenericReadDependentData<T> read_dependent_data() const;
+  const vector<T>& quality_error_rates() const;
+  void set_quality_error_rates(const vector<T> &rates);  // Scores binned reads if not empty.
+  Matrix16_4T<T> quality_alphas(int individual, int bin) const;
 
  private:
-  void GermlineTransition(bool is_numerator=false);  // Helper functions for MutationProbability.
+  void Peel(const Matrix16_256T<T> &germline_probability_mat,
+            const Matrix16_256T<T> &germline_probability_mat_num);  // Helper functions for MutationProbability.
+  void GermlineTransition(const Matrix16_256T<T> &germline_probability_mat,
+                          bool is_numerator=false);
   void SomaticTransition(bool is_numerator=false);
-  RowVector256d GetRootMat(const RowVector256d &child_germline_probability,
-                           const RowVector256d &parent_probability);
-  RowVector256d PopulationPriors();  // Functions for setting up the model and relevant arrays.
-  Matrix16_16d PopulationPriorsExpanded();
-  RowVector16d PopulationPriorsSingle();
+  RowVector256T<T> GetRootMat(const RowVector256T<T> &child_germline_probability,
+                              const RowVector256T<T> &parent_probability);
+  const RowVector256T<T>& SitePopulationPriors() const;
+  void SetPopulationPriors();  // Functions for setting up the model and relevant arrays.
+  RowVector256T<T> PopulationPriors(const RowVector4T<T> &nucleotide_frequencies,
+                                    int reference_idx=-1);
+  Matrix16_16T<T> PopulationPriorsExpanded(const RowVector4T<T> &nucleotide_frequencies,
+                                           int reference_idx=-1);
+  RowVector16T<T> PopulationPriorsSingle();
+  RowVector256T<T> AlleleFrequencyPriors(const RowVector4T<T> &allele_frequencies);
   void SetGermlineMutationProbabilities();
-  double GermlineMutation(int child_nucleotide_idx, int parent_genotype_idx,
-                          bool no_mutation_flag);
-  Matrix4_16d GermlineProbabilityMatSingle(bool no_mutation_flag=false);
-  Matrix16_256d GermlineProbabilityMat(bool no_mutation_flag=false);
-  double SomaticMutation(int nucleotide_idx, int other_nucleotide_idx);
-  Matrix16_16d SomaticProbabilityMat();
-  Matrix16_16d SomaticProbabilityMatDiag();
+  T GermlineMutation(int child_nucleotide_idx, int parent_genotype_idx,
+                     bool no_mutation_flag);
+  Matrix4_16T<T> GermlineProbabilityMatSingle(bool no_mutation_flag=false);
+  Matrix16_256T<T> GermlineProbabilityMat(bool no_mutation_flag=false);
+  T SomaticMutation(int nucleotide_idx, int other_nucleotide_idx);
+  Matrix16_16T<T> SomaticProbabilityMat();
+  Matrix16_16T<T> SomaticProbabilityMatDiag();
   void SequencingProbabilityMat();
-  Matrix16_4d Alphas();
+  void BinnedSequencingProbability(int read);
+  Matrix16_4T<T> Alphas(T sequencing_error_rate, T dirichlet_dispersion) const;
+  void SetAlphas();
+  void SetIndividualAlphas(int individual);
+  void SetQualityAlphas(int individual);
 
   // Instance member variables.
-  double population_mutation_rate_;
-  double homozygous_match_;
-  double heterozygous_match_;
-  double mismatch_;
-  double germline_mutation_rate_;
-  double somatic_mutation_rate_;
-  double sequencing_error_rate_;
-  double dirichlet_dispersion_;
-  RowVector4d nucleotide_frequencies_;
-  Matrix16_4d alphas_;
-  RowVector16d population_priors_single_;  // Unused.
-  RowVector256d population_priors_;
-  Matrix4_16d germline_probability_mat_single_;
-  Matrix16_256d germline_probability_mat_;
-  Matrix16_256d germline_probability_mat_num_;
-  Matrix16_16d somatic_probability_mat_;
-  Matrix16_16d somatic_probability_mat_diag_;
-  ReadDependentData read_dependent_data_;  // Contains TreePeel class.
+  T population_mutation_rate_;
+  T homozygous_match_;
+  T heterozygous_match_;
+  T mismatch_;
+  T germline_mutation_rate_;
+  T somatic_mutation_rate_;
+  T sequencing_error_rate_;  // Last value set for all individuals.
+  T dirichlet_dispersion_;
+  T individual_sequencing_error_rates_[kIndividualCount];
+  T individual_dirichlet_dispersions_[kIndividualCount];
+  RowVector4T<T> nucleotide_frequencies_;
+  Matrix16_4T<T> alphas_;  // Alphas of sequencing_error_rate_ and dirichlet_dispersion_.
+  Matrix16_4T<T> individual_alphas_[kIndividualCount];
+  Likelihood<T> likelihoods_[kIndividualCount];  // Caches the tables of each individual whenever its alphas change.
+  vector<T> quality_error_rates_;  // Error rate of each base quality bin, empty if reads are not binned.
+  vector<Likelihood<T>, Eigen::aligned_allocator<Likelihood<T>>> quality_likelihoods_;  // individual * bins + bin.
+  RowVector16T<T> population_priors_single_;  // Unused.
+  RowVector256T<T> population_priors_;
+  T reference_weight_;
+  RowVector256T<T> reference_population_priors_[kNucleotideCount];
+  int reference_idx_;  // Reference nucleotide of the site or -1.
+  bool has_site_priors_;  // True if site_population_priors_ are used.
+  RowVector256T<T> site_population_priors_;  // Priors of the site frequencies.
+  LruCache<long, RowVector256T<T>> frequency_cache_;  // Keyed on QuantizeFrequencies().
+  Matrix4_16T<T> germline_probability_mat_single_;
+  Matrix16_256T<T> germline_probability_mat_;
+  Matrix16_256T<T> germline_probability_mat_num_;
+  Matrix16_16T<T> somatic_probability_mat_;
+  Matrix16_16T<T> somatic_probability_mat_diag_;
+  GenericReadDependentData<T> read_dependent_data_;  // Contains TreePeel class.
+  LruCache<long, GermlineOperators<Matrix16_256T<T>>> germline_cache_;  // Keyed on QuantizeRate().
 };
 
+typedef GenericTrioModel<double, DirichletMultinomialLikelihood> TrioModel;
+typedef GenericTrioModel<double, MultinomialLikelihood> MultinomialTrioModel;
+typedef GenericTrioModel<float, DirichletMultinomialLikelihood> FloatTrioModel;
+typedef GenericTrioModel<long double, DirichletMultinomialLikelihood> LongDoubleTrioModel;
+
 #endif
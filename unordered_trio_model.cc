@@ -0,0 +1,424 @@
+/**
+ * @file unordered_trio_model.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the GenericUnorderedTrioModel class
+ * template. The template is explicitly instantiated for every scalar type and
+ * Likelihood policy at the bottom of this file.
+ *
+ * See top of unordered_trio_model.h for a complete description.
+ */
+#include "unordered_trio_model.h"
+
+
+/**
+ * Default constructor. Folds a TrioModel with default parameters.
+ */
+template <typename T, template <typename> class Likelihood>
+GenericUnorderedTrioModel<T, Likelihood>::GenericUnorderedTrioModel()
+    : reference_idx_{-1}, has_site_priors_{false},
+      frequency_cache_{kFrequencyCacheCapacity},
+      germline_cache_{kGermlineCacheCapacity} {
+  GenericUnorderedTrioModel::SetParameters(GenericTrioModel<T, Likelihood>());
+}
+
+/**
+ * Constructor that folds the matrices of a customized TrioModel.
+ *
+ * @param  params TrioModel whose parameters are used.
+ */
+template <typename T, template <typename> class Likelihood>
+GenericUnorderedTrioModel<T, Likelihood>::GenericUnorderedTrioModel(const GenericTrioModel<T, Likelihood> &params)
+    : reference_idx_{-1}, has_site_priors_{false},
+      frequency_cache_{kFrequencyCacheCapacity},
+      germline_cache_{kGermlineCacheCapacity} {
+  GenericUnorderedTrioModel::SetParameters(params);
+}
+
+/**
+ * Implements the trio model for a single site on the unordered genotype basis.
+ * Follows the model diagram in TrioModel::MutationProbability().
+ *
+ * @param   data_vec Read counts in order of child, mother and father.
+ * @return           Probability of mutation given read data and parameters.
+ */
+template <typename T, template <typename> class Likelihood>
+T GenericUnorderedTrioModel<T, Likelihood>::MutationProbability(const ReadDataVector &data_vec) {
+  GenericUnorderedTrioModel::SequencingProbabilityMat(data_vec);
+  T denominator = GenericUnorderedTrioModel::Peel(
+    somatic_probability_mat_,
+    germline_probability_mat_
+  );
+  T numerator = GenericUnorderedTrioModel::Peel(
+    somatic_probability_mat_diag_,
+    germline_probability_mat_num_
+  );
+  return 1 - numerator / denominator;
+}
+
+/**
+ * Implements the trio model for a single site with a site-specific germline
+ * mutation rate. The 16 x 256 matrices of the quantized rate are taken from
+ * TrioModel::SiteGermlineOperators() and folded once, and the folded matrices
+ * are kept in germline_cache_ for later sites with the same quantized rate.
+ *
+ * @param   data_vec               Read counts in order of child, mother and
+ *                                 father.
+ * @param   germline_mutation_rate Germline mutation rate of this site.
+ * @return                         Probability of mutation given read data and
+ *                                 parameters.
+ */
+template <typename T, template <typename> class Likelihood>
+T GenericUnorderedTrioModel<T, Likelihood>::MutationProbability(const ReadDataVector &data_vec,
+                                                                T germline_mutation_rate) {
+  if (germline_mutation_rate == params_.germline_mutation_rate()) {
+    return GenericUnorderedTrioModel::MutationProbability(data_vec);
+  }
+
+  long key = QuantizeRate(germline_mutation_rate);
+  GermlineOperators<Matrix10_100T<T>> *operators = germline_cache_.Find(key);
+  if (operators == nullptr) {
+    const GermlineOperators<Matrix16_256T<T>> &ordered_operators = (
+      params_.SiteGermlineOperators(germline_mutation_rate)
+    );
+    GermlineOperators<Matrix10_100T<T>> folded_operators;
+    folded_operators.germline_probability_mat = GenericUnorderedTrioModel::GermlineProbabilityMat(
+      ordered_operators.germline_probability_mat
+    );
+    folded_operators.germline_probability_mat_num = GenericUnorderedTrioModel::GermlineProbabilityMat(
+      ordered_operators.germline_probability_mat_num
+    );
+    operators = &germline_cache_.Insert(key, folded_operators);
+  }
+
+  GenericUnorderedTrioModel::SequencingProbabilityMat(data_vec);
+  T denominator = GenericUnorderedTrioModel::Peel(
+    somatic_probability_mat_,
+    operators->germline_probability_mat
+  );
+  T numerator = GenericUnorderedTrioModel::Peel(
+    somatic_probability_mat_diag_,
+    operators->germline_probability_mat_num
+  );
+  return 1 - numerator / denominator;
+}
+
+/**
+ * Folds all matrices of the given TrioModel into the unordered genotype basis.
+ * Must be called again whenever a parameter of the TrioModel changes. Keeps a
+ * copy of the TrioModel for site-specific germline mutation rates and
+ * population priors, and drops the matrices and priors that were folded from
+ * the previous TrioModel.
+ *
+ * @param  params TrioModel whose parameters are used.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericUnorderedTrioModel<T, Likelihood>::SetParameters(const GenericTrioModel<T, Likelihood> &params) {
+  alphas_ = GenericUnorderedTrioModel::Alphas(params.alphas());
+  for (int individual = 0; individual < kIndividualCount; ++individual) {
+    individual_alphas_[individual] = GenericUnorderedTrioModel::Alphas(
+      params.alphas(individual)
+    );
+    likelihoods_[individual].SetAlphas(params.alphas(individual));
+  }
+  quality_bin_count_ = params.quality_error_rates().size();
+  quality_likelihoods_.resize(kIndividualCount * quality_bin_count_);
+  for (int individual = 0; individual < kIndividualCount; ++individual) {
+    for (int bin = 0; bin < quality_bin_count_; ++bin) {
+      quality_likelihoods_[individual * quality_bin_count_ + bin].SetAlphas(
+        params.quality_alphas(individual, bin)
+      );
+    }
+  }
+  population_priors_ = GenericUnorderedTrioModel::PopulationPriors(
+    params.population_priors()
+  );
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    reference_population_priors_[i] = GenericUnorderedTrioModel::PopulationPriors(
+      params.population_priors(i)
+    );
+  }
+  germline_probability_mat_ = GenericUnorderedTrioModel::GermlineProbabilityMat(
+    params.germline_probability_mat()
+  );
+  germline_probability_mat_num_ = GenericUnorderedTrioModel::GermlineProbabilityMat(
+    params.germline_probability_mat_num()
+  );
+  somatic_probability_mat_ = GenericUnorderedTrioModel::SomaticProbabilityMat(
+    params.somatic_probability_mat()
+  );
+  somatic_probability_mat_diag_ = GenericUnorderedTrioModel::SomaticProbabilityMat(
+    params.somatic_probability_mat_diag()
+  );
+  sequencing_probability_mat_ = Matrix3_10T<T>::Zero();
+  params_ = params;
+  germline_cache_.Clear();
+  frequency_cache_.Clear();
+  has_site_priors_ = false;
+}
+
+/**
+ * Folds the 1 x 256 population priors into 1 x 100 population priors. The
+ * (a, b) element is the sum of all ordered parent pairs where the mother
+ * genotype belongs to a and the father genotype belongs to b.
+ *
+ * @param  priors 1 x 256 Eigen probability RowVector.
+ * @return        1 x 100 Eigen probability RowVector.
+ */
+template <typename T, template <typename> class Likelihood>
+RowVector100T<T> GenericUnorderedTrioModel<T, Likelihood>::PopulationPriors(const RowVector256T<T> &priors) {
+  RowVector100T<T> population_priors = RowVector100T<T>::Zero();
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    for (int j = 0; j < kGenotypeCount; ++j) {
+      int idx = (UnorderedGenotypeIndex(i) * kUnorderedGenotypeCount +
+                 UnorderedGenotypeIndex(j));
+      population_priors(idx) += priors(i * kGenotypeCount + j);
+    }
+  }
+  return population_priors;
+}
+
+/**
+ * Folds a 16 x 256 germline transition matrix into a 10 x 100 matrix. Rows are
+ * summed over child genotypes that belong to the same unordered genotype.
+ * Columns are read at the representative genotype of each parent because the
+ * germline probabilities do not depend on the order of the parent alleles.
+ *
+ * @param  mat 16 x 256 Eigen probability matrix.
+ * @return     10 x 100 Eigen probability matrix.
+ */
+template <typename T, template <typename> class Likelihood>
+Matrix10_100T<T> GenericUnorderedTrioModel<T, Likelihood>::GermlineProbabilityMat(const Matrix16_256T<T> &mat) {
+  Matrix10_100T<T> germline_probability_mat = Matrix10_100T<T>::Zero();
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    int row = UnorderedGenotypeIndex(i);
+    for (int a = 0; a < kUnorderedGenotypeCount; ++a) {
+      for (int b = 0; b < kUnorderedGenotypeCount; ++b) {
+        int col = (OrderedGenotypeIndex(a) * kGenotypeCount +
+                   OrderedGenotypeIndex(b));
+        germline_probability_mat(row, a * kUnorderedGenotypeCount + b) += mat(i, col);
+      }
+    }
+  }
+  return germline_probability_mat;
+}
+
+/**
+ * Folds a 16 x 16 somatic transition matrix into a 10 x 10 matrix. Rows are
+ * summed over somatic genotypes that belong to the same unordered genotype.
+ * Columns are read at the representative zygotic genotype. This also folds the
+ * diagonal matrix used for the numerator.
+ *
+ * @param  mat 16 x 16 Eigen probability matrix.
+ * @return     10 x 10 Eigen probability matrix.
+ */
+template <typename T, template <typename> class Likelihood>
+Matrix10_10T<T> GenericUnorderedTrioModel<T, Likelihood>::SomaticProbabilityMat(const Matrix16_16T<T> &mat) {
+  Matrix10_10T<T> somatic_probability_mat = Matrix10_10T<T>::Zero();
+  for (int i = 0; i < kGenotypeCount; ++i) {
+    int row = UnorderedGenotypeIndex(i);
+    for (int j = 0; j < kUnorderedGenotypeCount; ++j) {
+      somatic_probability_mat(row, j) += mat(i, OrderedGenotypeIndex(j));
+    }
+  }
+  return somatic_probability_mat;
+}
+
+/**
+ * Selects the alpha frequencies of the representative ordered genotypes. AC
+ * and CA already share the same alphas.
+ *
+ * @param  alphas 16 x 4 Eigen matrix of Dirichlet multinomial alphas.
+ * @return        10 x 4 Eigen matrix of Dirichlet multinomial alphas.
+ */
+template <typename T, template <typename> class Likelihood>
+Matrix10_4T<T> GenericUnorderedTrioModel<T, Likelihood>::Alphas(const Matrix16_4T<T> &alphas) {
+  Matrix10_4T<T> unordered_alphas;
+  for (int i = 0; i < kUnorderedGenotypeCount; ++i) {
+    unordered_alphas.row(i) = alphas.row(OrderedGenotypeIndex(i));
+  }
+  return unordered_alphas;
+}
+
+/**
+ * Calculates the probability of sequencing error for all read data using the
+ * Likelihood policy of each individual at the representative ordered
+ * genotypes, and rescales each read to normal space by its own max element the
+ * same way as TrioModel::SequencingProbabilityMat().
+ *
+ * Reads binned by base quality add the log likelihoods of their non-empty bins.
+ *
+ * @param  data_vec Read counts in order of child, mother and father, or of
+ *                  each bin of each of them.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericUnorderedTrioModel<T, Likelihood>::SequencingProbabilityMat(const ReadDataVector &data_vec) {
+  for (int read = 0; read < 3; ++read) {
+    if (quality_bin_count_ > 0) {
+      sequencing_probability_mat_.row(read).setZero();
+      for (int bin = 0; bin < quality_bin_count_; ++bin) {
+        const int idx = read * quality_bin_count_ + bin;
+        if (data_vec[idx].key == 0) {
+          continue;
+        }
+        for (int genotype_idx = 0; genotype_idx < kUnorderedGenotypeCount; ++genotype_idx) {
+          sequencing_probability_mat_(read, genotype_idx) += quality_likelihoods_[idx].Log(
+            OrderedGenotypeIndex(genotype_idx),
+            data_vec[idx]
+          );
+        }
+      }
+      continue;
+    }
+    for (int genotype_idx = 0; genotype_idx < kUnorderedGenotypeCount; ++genotype_idx) {
+      sequencing_probability_mat_(read, genotype_idx) = likelihoods_[read].Log(
+        OrderedGenotypeIndex(genotype_idx),
+        data_vec[read]
+      );
+    }
+  }
+  for (int read = 0; read < 3; ++read) {
+    T max_element = sequencing_probability_mat_.row(read).maxCoeff();
+    sequencing_probability_mat_.row(read) = exp(
+      sequencing_probability_mat_.row(read).array() - max_element
+    );
+  }
+}
+
+/**
+ * Peels the tree from the sequencing probabilities to the root and returns the
+ * sum of the root matrix. Used for both the denominator and the numerator.
+ *
+ * @param  somatic_probability_mat  Somatic transition matrix.
+ * @param  germline_probability_mat Germline transition matrix.
+ * @return                          Sum of the 1 x 100 root matrix.
+ */
+template <typename T, template <typename> class Likelihood>
+T GenericUnorderedTrioModel<T, Likelihood>::Peel(
+    const Matrix10_10T<T> &somatic_probability_mat,
+    const Matrix10_100T<T> &germline_probability_mat) {
+  RowVector10T<T> child_zygotic_probability = (
+    sequencing_probability_mat_.row(0) * somatic_probability_mat
+  );
+  RowVector10T<T> mother_zygotic_probability = (
+    sequencing_probability_mat_.row(1) * somatic_probability_mat
+  );
+  RowVector10T<T> father_zygotic_probability = (
+    sequencing_probability_mat_.row(2) * somatic_probability_mat
+  );
+  RowVector100T<T> child_germline_probability = (
+    child_zygotic_probability * germline_probability_mat
+  );
+  RowVector100T<T> parent_probability = KroneckerProduct(
+    mother_zygotic_probability,
+    father_zygotic_probability
+  );
+  const RowVector100T<T> &population_priors = (
+    has_site_priors_ ? site_population_priors_ :
+    reference_idx_ == -1 ? population_priors_ : reference_population_priors_[reference_idx_]
+  );
+  return child_germline_probability.cwiseProduct(
+    parent_probability).cwiseProduct(population_priors).sum();
+}
+
+/**
+ * Selects the folded population priors that are conditioned on the reference
+ * nucleotide of the next sites. Nothing is recomputed.
+ *
+ * @param  reference_idx Index of reference nucleotide or -1 to use the
+ *                       priors that are not conditioned on the reference.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericUnorderedTrioModel<T, Likelihood>::SetReference(int reference_idx) {
+  reference_idx_ = reference_idx;
+}
+
+/**
+ * Selects the population priors of the population allele frequencies of the
+ * next sites. The priors of each quantized frequency vector are taken from
+ * TrioModel::FrequencyPopulationPriors() and folded once, and the folded
+ * priors are kept in frequency_cache_.
+ *
+ * @param  frequencies Nucleotide frequencies of A, C, G and T at the site.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericUnorderedTrioModel<T, Likelihood>::SetSiteFrequencies(const RowVector4d &frequencies) {
+  long key = QuantizeFrequencies(frequencies);
+  RowVector100T<T> *cached = frequency_cache_.Find(key);
+  if (cached == nullptr) {
+    cached = &frequency_cache_.Insert(
+      key,
+      GenericUnorderedTrioModel::PopulationPriors(
+        params_.FrequencyPopulationPriors(frequencies)
+      )
+    );
+  }
+  site_population_priors_ = *cached;
+  has_site_priors_ = true;
+}
+
+/**
+ * Returns to the genome-wide or reference population priors.
+ */
+template <typename T, template <typename> class Likelihood>
+void GenericUnorderedTrioModel<T, Likelihood>::ClearSiteFrequencies() {
+  has_site_priors_ = false;
+}
+
+template <typename T, template <typename> class Likelihood>
+RowVector100T<T> GenericUnorderedTrioModel<T, Likelihood>::population_priors() const {
+  return population_priors_;
+}
+
+template <typename T, template <typename> class Likelihood>
+RowVector100T<T> GenericUnorderedTrioModel<T, Likelihood>::population_priors(int reference_idx) const {
+  return reference_population_priors_[reference_idx];
+}
+
+template <typename T, template <typename> class Likelihood>
+int GenericUnorderedTrioModel<T, Likelihood>::reference() const {
+  return reference_idx_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_100T<T> GenericUnorderedTrioModel<T, Likelihood>::germline_probability_mat() const {
+  return germline_probability_mat_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_100T<T> GenericUnorderedTrioModel<T, Likelihood>::germline_probability_mat_num() const {
+  return germline_probability_mat_num_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_10T<T> GenericUnorderedTrioModel<T, Likelihood>::somatic_probability_mat() const {
+  return somatic_probability_mat_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_10T<T> GenericUnorderedTrioModel<T, Likelihood>::somatic_probability_mat_diag() const {
+  return somatic_probability_mat_diag_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix3_10T<T> GenericUnorderedTrioModel<T, Likelihood>::sequencing_probability_mat() const {
+  return sequencing_probability_mat_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_4T<T> GenericUnorderedTrioModel<T, Likelihood>::alphas() const {
+  return alphas_;
+}
+
+template <typename T, template <typename> class Likelihood>
+Matrix10_4T<T> GenericUnorderedTrioModel<T, Likelihood>::alphas(int individual) const {
+  return individual_alphas_[individual];
+}
+
+// Explicit instantiations for every scalar type and Likelihood policy.
+template class GenericUnorderedTrioModel<float, DirichletMultinomialLikelihood>;
+template class GenericUnorderedTrioModel<double, DirichletMultinomialLikelihood>;
+template class GenericUnorderedTrioModel<long double, DirichletMultinomialLikelihood>;
+template class GenericUnorderedTrioModel<float, MultinomialLikelihood>;
+template class GenericUnorderedTrioModel<double, MultinomialLikelihood>;
+template class GenericUnorderedTrioModel<long double, MultinomialLikelihood>;
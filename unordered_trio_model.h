@@ -0,0 +1,108 @@
+/**
+ * @file unordered_trio_model.h
+ * @author Melissa Ip
+ *
+ * The UnorderedTrioModel class is an alternative engine for the trio model
+ * that works on the 10 unordered genotypes instead of the 16 ordered
+ * genotypes. Sequencing reads cannot tell AC and CA apart, so the ordered
+ * model computes every heterozygous likelihood twice and carries 256 parent
+ * pairs where 100 would do.
+ *
+ * Every matrix is folded from a TrioModel. A row of an ordered transition
+ * matrix is summed over the ordered genotypes that belong to the same
+ * unordered genotype, and a column is read at a representative ordered
+ * genotype. The probabilities are equal to those of the TrioModel up to
+ * floating point rounding. Like GenericTrioModel, the engine is templated on
+ * the scalar type and the Likelihood policy:
+ *
+ *   UnorderedTrioModel             GenericUnorderedTrioModel<double, DirichletMultinomialLikelihood>
+ *   MultinomialUnorderedTrioModel  GenericUnorderedTrioModel<double, MultinomialLikelihood>
+ *
+ * Example usage:
+ *
+ *   TrioModel params;
+ *   UnorderedTrioModel unordered(params);  // Derives matrices from params.
+ *   double probability = unordered.MutationProbability(data);
+ *
+ *   params.set_germline_mutation_rate(0.000001);
+ *   unordered.SetParameters(params);  // Must be refolded after any change.
+ *
+ *   // Site-specific germline mutation rate, folded once per quantized rate.
+ *   double cpg_probability = unordered.MutationProbability(data, 2e-7);
+ *
+ *   // Population priors conditioned on the reference nucleotide G.
+ *   unordered.SetReference(2);
+ *
+ *   // Population priors of known allele frequencies, folded once per
+ *   // quantized frequency vector.
+ *   unordered.SetSiteFrequencies(frequencies);
+ *
+ * The base quality bins of the TrioModel are folded with the other
+ * parameters, so reads binned by base quality are scored the same way.
+ */
+#ifndef UNORDERED_TRIO_MODEL_H
+#define UNORDERED_TRIO_MODEL_H
+
+#include "trio_model.h"
+
+
+/**
+ * GenericUnorderedTrioModel class template header. See top of file for a
+ * complete description.
+ */
+template <typename T, template <typename> class Likelihood>
+class GenericUnorderedTrioModel {
+ public:
+  GenericUnorderedTrioModel();  // Folds a TrioModel with default parameters.
+  GenericUnorderedTrioModel(const GenericTrioModel<T, Likelihood> &params);
+  T MutationProbability(const ReadDataVector &data_vec);  // Calculates probability of mutation given input read data.
+  T MutationProbability(const ReadDataVector &data_vec, T germline_mutation_rate);  // Uses a site-specific germline mutation rate.
+  void SetParameters(const GenericTrioModel<T, Likelihood> &params);  // Refolds all matrices.
+  void SetReference(int reference_idx);  // Selects the folded priors of the site.
+  void SetSiteFrequencies(const RowVector4d &frequencies);
+  void ClearSiteFrequencies();
+  RowVector100T<T> population_priors() const;  // Get functions.
+  RowVector100T<T> population_priors(int reference_idx) const;
+  int reference() const;
+  Matrix10_100T<T> germline_probability_mat() const;
+  Matrix10_100T<T> germline_probability_mat_num() const;
+  Matrix10_10T<T> somatic_probability_mat() const;
+  Matrix10_10T<T> somatic_probability_mat_diag() const;
+  Matrix3_10T<T> sequencing_probability_mat() const;
+  Matrix10_4T<T> alphas() const;
+  Matrix10_4T<T> alphas(int individual) const;
+
+ private:
+  RowVector100T<T> PopulationPriors(const RowVector256T<T> &priors);  // Folding functions.
+  Matrix10_100T<T> GermlineProbabilityMat(const Matrix16_256T<T> &mat);
+  Matrix10_10T<T> SomaticProbabilityMat(const Matrix16_16T<T> &mat);
+  Matrix10_4T<T> Alphas(const Matrix16_4T<T> &alphas);
+  void SequencingProbabilityMat(const ReadDataVector &data_vec);
+  T Peel(const Matrix10_10T<T> &somatic_probability_mat,
+              const Matrix10_100T<T> &germline_probability_mat);
+
+  // Instance member variables.
+  Matrix10_4T<T> alphas_;
+  Matrix10_4T<T> individual_alphas_[kIndividualCount];
+  Likelihood<T> likelihoods_[kIndividualCount];  // Evaluated at the representative ordered genotypes.
+  int quality_bin_count_;  // Number of base quality bins, 0 if reads are not binned.
+  vector<Likelihood<T>, Eigen::aligned_allocator<Likelihood<T>>> quality_likelihoods_;  // individual * bins + bin.
+  RowVector100T<T> population_priors_;
+  RowVector100T<T> reference_population_priors_[kNucleotideCount];
+  int reference_idx_;  // Reference nucleotide of the site or -1.
+  bool has_site_priors_;  // True if site_population_priors_ are used.
+  RowVector100T<T> site_population_priors_;  // Priors of the site frequencies.
+  LruCache<long, RowVector100T<T>> frequency_cache_;  // Keyed on QuantizeFrequencies().
+  Matrix10_100T<T> germline_probability_mat_;
+  Matrix10_100T<T> germline_probability_mat_num_;
+  Matrix10_10T<T> somatic_probability_mat_;
+  Matrix10_10T<T> somatic_probability_mat_diag_;
+  Matrix3_10T<T> sequencing_probability_mat_;  // P(R|somatic genotype) of the last site.
+  GenericTrioModel<T, Likelihood> params_;  // Builds the matrices of site-specific rates.
+  LruCache<long, GermlineOperators<Matrix10_100T<T>>> germline_cache_;  // Keyed on QuantizeRate().
+};
+
+typedef GenericUnorderedTrioModel<double, DirichletMultinomialLikelihood> UnorderedTrioModel;
+typedef GenericUnorderedTrioModel<double, MultinomialLikelihood> MultinomialUnorderedTrioModel;
+
+#endif
@@ -0,0 +1,271 @@
+/**
+ * @file uring_reader.cc
+ * @author Melissa Ip
+ *
+ * This file contains the implementation of the UringReader class.
+ *
+ * See top of uring_reader.h for a complete description.
+ */
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "uring_reader.h"
+
+
+/**
+ * Sets up an io_uring instance with the io_uring_setup system call.
+ *
+ * @param  entries Number of entries of the submission queue.
+ * @param  params  Parameters that the kernel fills in.
+ * @return         File descriptor of the ring or -1.
+ */
+int IoUringSetup(unsigned entries, io_uring_params *params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+/**
+ * Submits queued reads and waits for completions with the io_uring_enter
+ * system call.
+ *
+ * @param  ring_fd      File descriptor of the ring.
+ * @param  to_submit    Number of entries that are submitted.
+ * @param  min_complete Number of completions to wait for.
+ * @param  flags        IORING_ENTER_GETEVENTS to wait.
+ * @return              Number of entries that were submitted or -1.
+ */
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+/**
+ * Constructor that sets up the ring and maps its queues. No reads are
+ * submitted before the first call to NextBlock(), so a reader can be moved to
+ * another range first.
+ *
+ * @param  fd    File descriptor of a regular file.
+ * @param  begin Offset of the first byte.
+ * @param  end   Offset after the last byte. Must not be past the end of the
+ *               file.
+ */
+UringReader::UringReader(int fd, off_t begin, off_t end)
+    : fd_{fd}, ring_fd_{-1}, sq_ring_{MAP_FAILED}, sq_ring_size_{0},
+      cq_ring_{MAP_FAILED}, cq_ring_size_{0}, sqes_{nullptr}, sqes_size_{0},
+      next_submit_{0}, next_return_{0}, pending_count_{0},
+      submit_offset_{begin}, end_{end} {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(kUringQueueDepth, &params);
+  if (ring_fd_ == -1) {
+    return;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes +
+                  params.cq_entries * sizeof(io_uring_cqe);
+  const bool is_single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (is_single_map) {
+    sq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    return;
+  }
+  if (is_single_map) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  char *sq = static_cast<char*>(sq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char *cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  data_.reset(new char[kUringQueueDepth * kUringBlockSize]);
+}
+
+/**
+ * Destructor that waits for the pending reads, unmaps the queues and closes
+ * the ring.
+ */
+UringReader::~UringReader() {
+  if (sqes_ != nullptr) {
+    UringReader::Drain();
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ != -1) {
+    close(ring_fd_);
+  }
+}
+
+/**
+ * Returns the next block of the range. The block of the previous call is
+ * reused for a read ahead.
+ *
+ * @param  block View of the next block, valid until the next call.
+ * @return       False if there are no blocks left.
+ */
+bool UringReader::NextBlock(StringView &block) {
+  UringReader::Submit();
+  if (next_return_ == next_submit_) {
+    return false;
+  }
+  const int slot = next_return_ % kUringQueueDepth;
+  UringReader::Reap();
+  while (block_sizes_[slot] == -1) {
+    UringReader::Wait();
+  }
+  next_return_++;
+  block = StringView(data_.get() + slot * kUringBlockSize, block_sizes_[slot]);
+  return block.size > 0;  // The file is shorter than the range.
+}
+
+/**
+ * Moves the reader to another byte range of the file. The blocks that were
+ * read ahead are dropped once their reads complete.
+ *
+ * @param  begin Offset of the first byte.
+ * @param  end   Offset after the last byte. Must not be past the end of the
+ *               file.
+ */
+void UringReader::Seek(off_t begin, off_t end) {
+  UringReader::Drain();
+  next_submit_ = 0;
+  next_return_ = 0;
+  submit_offset_ = begin;
+  end_ = end;
+}
+
+bool UringReader::is_open() const {
+  return sqes_ != nullptr;
+}
+
+/**
+ * Queues a read for every free block of the ring and submits them with a
+ * single system call. Reads use IORING_OP_READV, which every kernel with
+ * io_uring supports.
+ */
+void UringReader::Submit() {
+  unsigned tail = *sq_tail_;  // Only this thread writes the tail.
+  unsigned count = 0;
+  while (next_submit_ - next_return_ < kUringQueueDepth &&
+         submit_offset_ < end_) {
+    const int slot = next_submit_ % kUringQueueDepth;
+    const size_t size = min<off_t>(kUringBlockSize, end_ - submit_offset_);
+    block_offsets_[slot] = submit_offset_;
+    block_requests_[slot] = size;
+    block_sizes_[slot] = -1;
+    block_iovecs_[slot].iov_base = data_.get() + slot * kUringBlockSize;
+    block_iovecs_[slot].iov_len = size;
+
+    const unsigned index = tail & *sq_mask_;
+    io_uring_sqe &sqe = sqes_[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READV;
+    sqe.fd = fd_;
+    sqe.off = submit_offset_;
+    sqe.addr = reinterpret_cast<uint64_t>(&block_iovecs_[slot]);
+    sqe.len = 1;
+    sqe.user_data = slot;
+    sq_array_[index] = index;
+    tail++;
+    count++;
+    submit_offset_ += size;
+    next_submit_++;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+  pending_count_ += count;
+  int submitted = 0;
+  do {
+    submitted = IoUringEnter(ring_fd_, count, 0, 0);
+  } while (submitted == -1 && errno == EINTR);
+  if (submitted != (int) count) {
+    Die("Input file cannot be read.");
+  }
+}
+
+/**
+ * Records the sizes of the reads that completed. A read that returns fewer
+ * bytes than requested before the end of the file is finished with pread().
+ */
+void UringReader::Reap() {
+  unsigned head = *cq_head_;  // Only this thread writes the head.
+  const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+    const int slot = cqe.user_data;
+    if (cqe.res < 0) {
+      Die("Input file cannot be read.");
+    }
+    size_t size = cqe.res;
+    char *data = data_.get() + slot * kUringBlockSize;
+    while (size < block_requests_[slot]) {
+      ssize_t bytes = pread(fd_, data + size, block_requests_[slot] - size,
+                            block_offsets_[slot] + size);
+      if (bytes == -1 && errno == EINTR) {
+        continue;
+      } else if (bytes == -1) {
+        Die("Input file cannot be read.");
+      } else if (bytes == 0) {
+        break;
+      }
+      size += bytes;
+    }
+    block_sizes_[slot] = size;
+    pending_count_--;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Waits for at least one read to complete and records it.
+ */
+void UringReader::Wait() {
+  int result = 0;
+  do {
+    result = IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+  } while (result == -1 && errno == EINTR);
+  if (result == -1) {
+    Die("Input file cannot be read.");
+  }
+  UringReader::Reap();
+}
+
+/**
+ * Waits for every pending read, so the blocks can be reused or freed.
+ */
+void UringReader::Drain() {
+  UringReader::Reap();
+  while (pending_count_ > 0) {
+    UringReader::Wait();
+  }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file uring_reader.h
+ * @author Melissa Ip
+ *
+ * The UringReader class reads a byte range of a regular file in blocks with
+ * io_uring, which LineReader splits into lines. A ring of kUringQueueDepth
+ * blocks of kUringBlockSize bytes each is kept in flight ahead of the parser,
+ * so a deep queue of reads is pending at the device at all times, e.g. on
+ * NVMe drives or network filesystems where a single synchronous pread() cannot
+ * keep the device busy. The reads complete in any order, but the blocks are
+ * returned in file order.
+ *
+ * The ring is set up with the io_uring system calls directly, so liburing is
+ * not needed. If the kernel does not support io_uring, e.g. before Linux 5.1
+ * or in a container that blocks it, is_open() is false and LineReader reads
+ * the file with pread() instead.
+ *
+ * Example usage:
+ *
+ *   UringReader reader(fd, 0, file_size);
+ *   StringView block;
+ *   while (reader.NextBlock(block)) {  // Valid until the next call.
+ *     ...
+ *   }
+ */
+#ifndef URING_READER_H
+#define URING_READER_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <memory>
+
+#include <linux/io_uring.h>
+
+#include "utility.h"
+
+
+// Number of blocks that are read ahead of the parser.
+const int kUringQueueDepth = 32;
+
+// Number of bytes of each read.
+const size_t kUringBlockSize = 1 << 19;
+
+/**
+ * UringReader class header. See top of file for a complete description.
+ */
+class UringReader {
+ public:
+  UringReader(int fd, off_t begin, off_t end);  // Bytes in [begin, end).
+  ~UringReader();
+  bool NextBlock(StringView &block);  // False at the end of the range.
+  void Seek(off_t begin, off_t end);  // Drops the blocks that were read ahead.
+  bool is_open() const;  // False if io_uring is not supported.
+
+ private:
+  UringReader(const UringReader &other);  // Not copyable.
+  UringReader& operator=(const UringReader &other);
+  void Submit();
+  void Reap();
+  void Wait();
+  void Drain();
+
+  // Instance member variables.
+  int fd_;
+  int ring_fd_;
+  void *sq_ring_;  // Submission queue ring.
+  size_t sq_ring_size_;
+  void *cq_ring_;  // Completion queue ring, the same mapping as sq_ring_ if the kernel maps both at once.
+  size_t cq_ring_size_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  io_uring_cqe *cqes_;
+  unique_ptr<char[]> data_;  // kUringQueueDepth blocks, not zeroed.
+  off_t block_offsets_[kUringQueueDepth];
+  size_t block_requests_[kUringQueueDepth];  // Bytes that are requested.
+  ssize_t block_sizes_[kUringQueueDepth];  // Bytes that were read, -1 while the read is pending.
+  iovec block_iovecs_[kUringQueueDepth];  // Buffers of the pending reads.
+  size_t next_submit_;  // Sequence numbers of blocks.
+  size_t next_return_;
+  int pending_count_;  // Reads that have not completed.
+  off_t submit_offset_;  // Offset of the next read.
+  off_t end_;
+};
+
+#endif
@@ -346,16 +346,17 @@ bool IsAlleleInParentGenotype(int child_nucleotide_idx, int parent_genotype_idx)
  *     \Pi_{i = A, C, G, T} \frac{\gamma(\alpha_i * \theta + n_i)}
  *                               {\gamma(\alpha_i * \theta}
  *
- * @param  alpha RowVector of doubles representing frequencies for each
+ * @param  alpha RowVector of scalars representing frequencies for each
  *               category in the Dirichlet multinomial.
  * @param  data  Read counts or samples for each category in the multinomial.
  * @return       log_e(P) where P is the value calculated from the pdf.
  */
-double DirichletMultinomialLog(const RowVector4d &alpha, const ReadData &data) {
-  double a = alpha.sum();
+template <typename T>
+T DirichletMultinomialLog(const RowVector4T<T> &alpha, const ReadData &data) {
+  T a = alpha.sum();
   int n = data.reads[0] + data.reads[1] + data.reads[2] + data.reads[3];
-  double constant_term = lgamma(a) - lgamma(n + a);
-  double product_term = 0.0;
+  T constant_term = lgamma(a) - lgamma(n + a);
+  T product_term = 0.0;
   for (int i = 0; i < kNucleotideCount; ++i) {
     product_term += lgamma(alpha(i) + data.reads[i]) - lgamma(alpha(i));
   }
@@ -370,8 +371,9 @@ double DirichletMultinomialLog(const RowVector4d &alpha, const ReadData &data) {
  * @param  arr 4 x 16 Eigen matrix.
  * @return     16 x 256 Eigen matrix.
  */
-Matrix16_256d KroneckerProduct(const Matrix4_16d &mat) {
-  Matrix16_256d kronecker_product;
+template <typename T>
+Matrix16_256T<T> KroneckerProduct(const Matrix4_16T<T> &mat) {
+  Matrix16_256T<T> kronecker_product;
   for (int i = 0; i < 4; ++i) {
     for (int j = 0; j < 16; ++j) {
       for (int k = 0; k < 4; ++k) {
@@ -392,8 +394,9 @@ Matrix16_256d KroneckerProduct(const Matrix4_16d &mat) {
  * @param  arr 4 x 4 Eigen matrix.
  * @return     16 x 16 Eigen matrix.
  */
-Matrix16_16d KroneckerProduct(const Matrix4d &mat) {
-  Matrix16_16d kronecker_product;
+template <typename T>
+Matrix16_16T<T> KroneckerProduct(const Matrix4T<T> &mat) {
+  Matrix16_16T<T> kronecker_product;
   for (int i = 0; i < 4; ++i) {
     for (int j = 0; j < 4; ++j) {
       for (int k = 0; k < 4; ++k) {
@@ -415,9 +418,10 @@ Matrix16_16d KroneckerProduct(const Matrix4d &mat) {
  * @param  arr2 1 x 16 Eigen RowVector.
  * @return      1 x 256 Eigen RowVector.
  */
-RowVector256d KroneckerProduct(const RowVector16d &vec1,
-                               const RowVector16d &vec2) {
-  RowVector256d kronecker_product;
+template <typename T>
+RowVector256T<T> KroneckerProduct(const RowVector16T<T> &vec1,
+                                  const RowVector16T<T> &vec2) {
+  RowVector256T<T> kronecker_product;
   for (int i = 0; i < 16; ++i) {
     for (int j = 0; j < 16; ++j) {
       kronecker_product(i*16 + j) = vec1(i) * vec2(j);
@@ -426,6 +430,141 @@ RowVector256d KroneckerProduct(const RowVector16d &vec1,
   return kronecker_product;
 }
 
+/**
+ * Calculates the Kronecker product of two RowVectors in the unordered genotype
+ * basis.
+ *
+ * Matrix sizes are specific to the unordered parent probability matrix.
+ *
+ * @param  arr1 1 x 10 Eigen RowVector.
+ * @param  arr2 1 x 10 Eigen RowVector.
+ * @return      1 x 100 Eigen RowVector.
+ */
+template <typename T>
+RowVector100T<T> KroneckerProduct(const RowVector10T<T> &vec1,
+                                  const RowVector10T<T> &vec2) {
+  RowVector100T<T> kronecker_product;
+  for (int i = 0; i < kUnorderedGenotypeCount; ++i) {
+    for (int j = 0; j < kUnorderedGenotypeCount; ++j) {
+      kronecker_product(i*kUnorderedGenotypeCount + j) = vec1(i) * vec2(j);
+    }
+  }
+  return kronecker_product;
+}
+
+/**
+ * Returns the index of the unordered genotype that an ordered genotype belongs
+ * to. AC and CA both map to AC. Unordered genotypes are numbered in
+ * lexicographical order with the first allele never greater than the second:
+ *
+ * INDEX  0   1   2   3   4   5   6   7   8   9
+ *        AA  AC  AG  AT  CC  CG  CT  GG  GT  TT
+ *
+ * @param  genotype_idx Index of ordered genotype [0, 16).
+ * @return              Index of unordered genotype [0, 10).
+ */
+int UnorderedGenotypeIndex(int genotype_idx) {
+  int allele1 = genotype_idx / kNucleotideCount;
+  int allele2 = genotype_idx % kNucleotideCount;
+  if (allele1 > allele2) {
+    swap(allele1, allele2);
+  }
+  // Skips the allele1 rows above, which hold 4, 3, 2, ... genotypes each.
+  int offset = allele1 * kNucleotideCount - allele1 * (allele1 - 1) / 2;
+  return offset + allele2 - allele1;
+}
+
+/**
+ * Returns the index of the ordered genotype that represents an unordered
+ * genotype, that is the ordered genotype whose first allele is not greater
+ * than its second allele. Inverse of UnorderedGenotypeIndex() on those
+ * representatives.
+ *
+ * @param  unordered_genotype_idx Index of unordered genotype [0, 10).
+ * @return                        Index of ordered genotype [0, 16).
+ */
+int OrderedGenotypeIndex(int unordered_genotype_idx) {
+  for (int allele1 = kNucleotideCount - 1; allele1 >= 0; --allele1) {
+    int offset = allele1 * kNucleotideCount - allele1 * (allele1 - 1) / 2;
+    if (unordered_genotype_idx >= offset) {
+      return allele1 * kNucleotideCount + allele1 + unordered_genotype_idx - offset;
+    }
+  }
+  return -1;  // ERROR: Index out of range.
+}
+
+/**
+ * Quantizes a positive rate on a logarithmic grid whose neighboring rates
+ * differ by kRateQuantizationStep relative to each other. Rates that differ by
+ * less than half a step share the same key, which is used to cache matrices
+ * that are derived from site-specific rates.
+ *
+ * @param  rate Rate such as a germline mutation rate.
+ * @return      Integer key of the nearest rate on the grid or kZeroRateKey if
+ *              rate is not positive.
+ */
+long QuantizeRate(double rate) {
+  if (rate <= 0.0) {
+    return kZeroRateKey;
+  }
+  return lround(log(rate) / log1p(kRateQuantizationStep));
+}
+
+/**
+ * Returns the rate on the grid of QuantizeRate() that belongs to a key.
+ *
+ * @param  key Integer key returned by QuantizeRate().
+ * @return     Quantized rate.
+ */
+double QuantizedRate(long key) {
+  if (key == kZeroRateKey) {
+    return 0.0;
+  }
+  return exp(key * log1p(kRateQuantizationStep));
+}
+
+/**
+ * Quantizes nucleotide frequencies on a square root scale, i.e. the square
+ * root of each frequency in steps of 1 / kFrequencyQuantizationLevels, and
+ * packs the four levels into an integer key. Frequencies that round to the
+ * same levels share the same key, which is used to cache population priors.
+ *
+ * The square root scale keeps rare alleles apart from absent ones: the
+ * smallest nonzero level is a frequency of 0.01%, and the steps grow from
+ * 0.2% at a frequency of 1% to 1% at 25% and 2% near 100%.
+ *
+ * @param  frequencies Frequencies of A, C, G and T that sum to 1.
+ * @return             Integer key of the quantized frequencies.
+ */
+long QuantizeFrequencies(const RowVector4d &frequencies) {
+  long key = 0;
+  for (int i = 0; i < kNucleotideCount; ++i) {
+    key = key * (kFrequencyQuantizationLevels + 1) + lround(
+      sqrt(frequencies(i) / frequencies.sum()) * kFrequencyQuantizationLevels
+    );
+  }
+  return key;
+}
+
+/**
+ * Returns the frequencies that belong to a key of QuantizeFrequencies(). An
+ * allele that is absent from the population stays absent, because
+ * AlleleFrequencyPriors() already mixes in the genome-wide nucleotide
+ * frequencies weighted by theta.
+ *
+ * @param  key Integer key returned by QuantizeFrequencies().
+ * @return     Quantized frequencies of A, C, G and T that sum to 1.
+ */
+RowVector4d QuantizedFrequencies(long key) {
+  RowVector4d frequencies;
+  for (int i = kNucleotideCount - 1; i >= 0; --i) {
+    const double level = key % (kFrequencyQuantizationLevels + 1);
+    frequencies(i) = pow(level / kFrequencyQuantizationLevels, 2);
+    key /= kFrequencyQuantizationLevels + 1;
+  }
+  return frequencies / frequencies.sum();
+}
+
 /**
  * Returns true if the two given doubles are equal to each other within epsilon
  * precision.
@@ -451,3 +590,18 @@ void Die(const char *msg) {
   }
   exit(EXIT_FAILURE);
 }
+
+// Explicit instantiations for every scalar type of the trio models.
+#define INSTANTIATE_UTILITY(T) \
+  template T DirichletMultinomialLog(const RowVector4T<T> &alpha, \
+                                     const ReadData &data); \
+  template Matrix16_256T<T> KroneckerProduct(const Matrix4_16T<T> &mat); \
+  template Matrix16_16T<T> KroneckerProduct(const Matrix4T<T> &mat); \
+  template RowVector256T<T> KroneckerProduct(const RowVector16T<T> &vec1, \
+                                             const RowVector16T<T> &vec2); \
+  template RowVector100T<T> KroneckerProduct(const RowVector10T<T> &vec1, \
+                                             const RowVector10T<T> &vec2);
+INSTANTIATE_UTILITY(float)
+INSTANTIATE_UTILITY(double)
+INSTANTIATE_UTILITY(long double)
+#undef INSTANTIATE_UTILITY
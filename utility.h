@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -30,15 +31,55 @@ union ReadData {
   uint64_t key;
 };
 
-typedef Matrix<double, 1, 16> RowVector16d;
-typedef Matrix<double, 1, 256> RowVector256d;
+/**
+ * Non-owning view of characters in a line, a pointer and a length, because
+ * C++11 has no std::string_view.
+ */
+struct StringView {
+  StringView() : data{nullptr}, size{0} {}
+  StringView(const char *data, size_t size) : data{data}, size{size} {}
+  string ToString() const { return string(data, size); }
+  bool Equals(const StringView &other) const {
+    return size == other.size && memcmp(data, other.data, size) == 0;
+  }
+  const char *data;
+  size_t size;
+};
+
+// Matrix types are templated on the scalar type so the trio models can be
+// instantiated for float, double and long double. The d suffix typedefs are
+// the double versions.
+template <typename T> using RowVector4T = Matrix<T, 1, 4>;
+template <typename T> using RowVector10T = Matrix<T, 1, 10>;  // Unordered genotype basis.
+template <typename T> using RowVector16T = Matrix<T, 1, 16>;
+template <typename T> using RowVector100T = Matrix<T, 1, 100>;
+template <typename T> using RowVector256T = Matrix<T, 1, 256>;
+template <typename T> using Matrix4T = Matrix<T, 4, 4>;
+template <typename T> using Matrix3_10T = Matrix<T, 3, 10, RowMajor>;
+template <typename T> using Matrix3_16T = Matrix<T, 3, 16, RowMajor>;
+template <typename T> using Matrix4_16T = Matrix<T, 4, 16, RowMajor>;
+template <typename T> using Matrix10_4T = Matrix<T, 10, 4, RowMajor>;
+template <typename T> using Matrix10_10T = Matrix<T, 10, 10, RowMajor>;
+template <typename T> using Matrix10_100T = Matrix<T, 10, 100, RowMajor>;
+template <typename T> using Matrix16_4T = Matrix<T, 16, 4, RowMajor>;
+template <typename T> using Matrix16_16T = Matrix<T, 16, 16, RowMajor>;
+template <typename T> using Matrix16_256T = Matrix<T, 16, 256, RowMajor>;
+
+typedef RowVector16T<double> RowVector16d;
+typedef RowVector256T<double> RowVector256d;
 typedef Matrix<int, 16, 2, RowMajor> Matrix16_2i;
-typedef Matrix<double, 3, 16, RowMajor> Matrix3_16d;
-typedef Matrix<double, 4, 16, RowMajor> Matrix4_16d;
-typedef Matrix<double, 16, 4, RowMajor> Matrix16_4d;
-typedef Matrix<double, 16, 16, RowMajor> Matrix16_16d;
-typedef Matrix<double, 16, 256, RowMajor> Matrix16_256d;
+typedef Matrix3_16T<double> Matrix3_16d;
+typedef Matrix4_16T<double> Matrix4_16d;
+typedef Matrix16_4T<double> Matrix16_4d;
+typedef Matrix16_16T<double> Matrix16_16d;
+typedef Matrix16_256T<double> Matrix16_256d;
 typedef Matrix<RowVector4d, 16, 16, RowMajor> Matrix16_16_4d;
+typedef RowVector10T<double> RowVector10d;
+typedef RowVector100T<double> RowVector100d;
+typedef Matrix3_10T<double> Matrix3_10d;
+typedef Matrix10_4T<double> Matrix10_4d;
+typedef Matrix10_10T<double> Matrix10_10d;
+typedef Matrix10_100T<double> Matrix10_100d;
 typedef vector<ReadData> ReadDataVector;  // Contains child, mother, and father sequencing reads.
 typedef vector<ReadDataVector> TrioVector;
 
@@ -60,11 +101,24 @@ ReadDataVector GetUniqueReadDataVector(const MatrixXi &mat);
 int IndexOfReadDataVector(const ReadDataVector &data_vec, TrioVector trio_vec);
 bool IsInVector(const RowVector4d &vec, double elem);
 bool IsAlleleInParentGenotype(int child_nucleotide_idx, int parent_genotype_idx);
-double DirichletMultinomialLog(const RowVector4d &alpha, const ReadData &data);
-Matrix16_256d KroneckerProduct(const Matrix4_16d &mat);
-Matrix16_16d KroneckerProduct(const Matrix4d &mat);
-RowVector256d KroneckerProduct(const RowVector16d &vec1,
-                               const RowVector16d &vec2);
+long QuantizeRate(double rate);
+double QuantizedRate(long key);
+long QuantizeFrequencies(const RowVector4d &frequencies);
+RowVector4d QuantizedFrequencies(long key);
+template <typename T>
+T DirichletMultinomialLog(const RowVector4T<T> &alpha, const ReadData &data);
+template <typename T>
+Matrix16_256T<T> KroneckerProduct(const Matrix4_16T<T> &mat);
+template <typename T>
+Matrix16_16T<T> KroneckerProduct(const Matrix4T<T> &mat);
+template <typename T>
+RowVector256T<T> KroneckerProduct(const RowVector16T<T> &vec1,
+                                  const RowVector16T<T> &vec2);
+template <typename T>
+RowVector100T<T> KroneckerProduct(const RowVector10T<T> &vec1,
+                                  const RowVector10T<T> &vec2);
+int UnorderedGenotypeIndex(int genotype_idx);
+int OrderedGenotypeIndex(int unordered_genotype_idx);
 bool Equal(double a, double b);
 void Die(const char *msg);
 
@@ -94,7 +148,12 @@ const int kNucleotideCount = 4;
 const int kGenotypeCount = 16;
 const int kGenotypePairCount = 256;
 const int kTrioCount = 42875;
+const int kUnorderedGenotypeCount = 10;  // AA, AC, AG, AT, CC, CG, CT, GG, GT, TT.
+const int kUnorderedGenotypePairCount = 100;
 const double kEpsilon = numeric_limits<double>::epsilon();
+const double kRateQuantizationStep = 0.01;  // Relative spacing of quantized rates.
+const long kZeroRateKey = numeric_limits<long>::min();  // QuantizeRate() of rates <= 0.
+const int kFrequencyQuantizationLevels = 100;  // Square roots of nucleotide frequencies in steps of 1%.
 // const Matrix16_2i kGenotypeNumIndex = GenotypeNumIndex();
 // const Matrix16_16_4d kTwoParentCounts = TwoParentCounts();
 